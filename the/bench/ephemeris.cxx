@@ -0,0 +1,94 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "the/lib/common/frames.hxx"
+#include "the/lib/common/logging.hxx"
+#include "the/lib/common/planets.hxx"
+#include "the/lib/common/precnut.hxx"
+#include "the/lib/common/sun.hxx"
+
+namespace chrono = std::chrono;
+
+namespace {
+
+/// Frames of the sky a second over a day, as starsky draws them.
+std::size_t constexpr kFrames = 60 * 60 * 24;
+/// Epochs of a batch, a year of minutes.
+std::size_t constexpr kEpochs = 60 * 24 * 366;
+
+/// Runs fn over count epochs and prints nanoseconds an epoch.
+template <typename Fn>
+double Measure(char const *name, std::size_t const count, Fn &&fn) {
+  auto const startedAt = chrono::steady_clock::now();
+  fn();
+  auto const took = chrono::duration<double>(chrono::steady_clock::now() - startedAt).count();
+  double const ns = took / double(count) * 1e9;
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setw(10) << std::setprecision(1) << ns << " ns/epoch"
+            << std::setw(12) << count << " epochs\n";
+  return ns;
+}
+
+}
+
+// Usage: ephemeris
+// Compares the cost of the sun alone with that of the sun and the planets
+// of an EphemerisFrame, a frame at a time and over a batch of epochs, and
+// that of a precession matrix computed with that of one of a FrameCache.
+int main() {
+  double checksum = 0.0;
+  double const T0 = 0.26;
+  double const dT = 1.0 / 36525.0 / 86400.0;
+
+  auto const sun = Measure("SunPos, a frame at a time", kFrames, [&] {
+    for (std::size_t i = 0; i < kFrames; ++i)
+      checksum += the::SunPos(T0 + dT * double(i))[0];
+  });
+  the::EphemerisFrame frame;
+  auto const all = Measure("EphemerisFrame, a frame at a time", kFrames, [&] {
+    for (std::size_t i = 0; i < kFrames; ++i) {
+      double const T = T0 + dT * double(i);
+      frame.Update({&T, 1});
+      checksum += frame.Geocentric(the::Planet::Pluto)[0][0];
+    }
+  });
+  Measure("EphemerisFrame, planets of a sun given", kFrames, [&] {
+    the::Vec3 const given = the::SunPos(T0);
+    for (std::size_t i = 0; i < kFrames; ++i) {
+      double const T = T0 + dT * double(i);
+      frame.Update({&T, 1}, {&given, 1});
+      checksum += frame.Geocentric(the::Planet::Pluto)[0][0];
+    }
+  });
+  INFO() << "the sun and " << the::kPlanets << " planets cost " << all / sun << " times the sun alone";
+
+  std::vector<double> T(kEpochs);
+  for (std::size_t i = 0; i < kEpochs; ++i)
+    T[i] = T0 + 60.0 * dT * double(i);
+  std::vector<the::Vec3> out(kEpochs);
+  auto const sunBatch = Measure("SunPos, a batch", kEpochs, [&] {
+    the::SunPos(T, out);
+    checksum += out.back()[0];
+  });
+  auto const allBatch = Measure("EphemerisFrame, a batch", kEpochs, [&] {
+    frame.Update(T);
+    checksum += frame.Geocentric(the::Planet::Pluto)[frame.Size() - 1][0];
+  });
+  INFO() << "the sun and " << the::kPlanets << " planets cost " << allBatch / sunBatch << " times the sun alone";
+
+  auto const made = Measure("PrecMatrixEcl, a frame at a time", kFrames, [&] {
+    for (std::size_t i = 0; i < kFrames; ++i)
+      checksum += the::PrecMatrixEcl(0.0, T0 + dT * double(i))[0][1];
+  });
+  auto const cached = Measure("FrameCache, a frame at a time", kFrames, [&] {
+    for (std::size_t i = 0; i < kFrames; ++i)
+      checksum += the::FrameCache::Shared().At(the::Frame::PrecEcl, T0 + dT * double(i))[0][1];
+  });
+  INFO() << "matrices of the cache cost " << cached / made << " times those computed";
+
+  DEBUG() << "checksum=" << checksum;
+
+  return 0;
+}
@@ -0,0 +1,178 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "the/lib/common/logging.hxx"
+#include "the/lib/common/ppmxlingest.hxx"
+#include "the/lib/common/ppmxlparser.hxx"
+#include "the/lib/common/ppmxlreader.hxx"
+#include "the/lib/common/utils.hxx"
+
+namespace chrono = std::chrono;
+
+using the::PPMXLParser;
+using the::PPMXLReader;
+
+namespace {
+
+// Builds rows looking like PPMXL ones, every tenth of them without 2MASS magnitudes.
+std::string MakeRows(std::size_t const count) {
+  std::string text;
+  text.reserve(count * 200);
+  std::uint64_t ipix = 161387954652791ull;
+  for (std::size_t i = 0; i < count; ++i, ipix += 7919) {
+    std::ostringstream ss;
+    ss << ipix << '|' << std::fixed << std::setprecision(6)
+       << (i * 0.0137) - static_cast<int>(i * 0.0137 / 360.0) * 360.0 << '|'
+       << (i % 180) - 89.5 + 0.000123 * (i % 1000) << '|'
+       << "2.31e-05|2.31e-05|-4.9444e-07|-1.3944e-06|1.17e-06|1.17e-06|6|1984.55|1984.55|";
+    if (i % 10 == 0) {
+      ss << "None|None|None|None|None|None|";
+    } else {
+      ss << std::setprecision(3) << 5.0 + (i % 1500) * 0.01 << "|0.047|15.238|0.094|15.264|0.170|";
+    }
+    ss << "18.29|18.22|16.57|16.77|16.64|02137|0|-1.3633e-07|-1.0106e-07\n";
+    text += ss.str();
+  }
+  return text;
+}
+
+// Compresses the text the same way gzip does.
+std::string Gzip(std::string const &text) {
+  z_stream zs = {};
+  deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&zs, text.size()), '\0');
+  zs.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+  zs.avail_in  = static_cast<uInt>(text.size());
+  zs.next_out  = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return out;
+}
+
+template <typename Fn>
+void Measure(char const *name, std::size_t const bytes, Fn &&fn) {
+  auto const startedAt = chrono::steady_clock::now();
+  std::size_t const rows = fn();
+  auto const took = chrono::duration<double>(chrono::steady_clock::now() - startedAt).count();
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+            << std::setw(10) << std::setprecision(1) << bytes / took / 1e6 << " MB/s"
+            << std::setw(12) << std::setprecision(2) << rows / took / 1e6 << " Mrows/s"
+            << std::setw(12) << rows << " rows\n";
+}
+
+}
+
+// Usage: ppmxlparser [FILE]
+// Compares throughput of PPMXLReader::Row::Fill and PPMXLParser on the rows
+// of FILE, or on generated rows if no file is given.
+int main(int argc, char *argv[]) {
+  std::string text;
+  if (argc > 1) {
+    auto const data = the::LoadFile(argv[1]);
+    text.assign(data.begin(), data.end());
+  } else {
+    text = MakeRows(1000000);
+  }
+  auto const bytes = text.size();
+  INFO() << "benchmarking on " << bytes << " bytes";
+
+  double checksum = 0.0;
+
+  Measure("getline + Row::Fill", bytes, [&] {
+    std::istringstream is{text};
+    PPMXLReader reader{is};
+    PPMXLReader::Row row;
+    std::size_t rows = 0;
+    while (reader >> row) {
+      checksum += row.RaJ2000;
+      ++rows;
+    }
+    return rows;
+  });
+
+  Measure("PPMXLParser (Fill columns)", bytes, [&] {
+    PPMXLParser const parser{the::kPositionPPMXLColumns};
+    std::size_t rows = 0;
+    parser.Parse(text.data(), text.data() + text.size(), [&](PPMXLReader::Row const &row) {
+      checksum += row.RaJ2000;
+      ++rows;
+      return true;
+    });
+    return rows;
+  });
+
+  Measure("PPMXLParser (all columns)", bytes, [&] {
+    PPMXLParser const parser;
+    std::size_t rows = 0;
+    parser.Parse(text.data(), text.data() + text.size(), [&](PPMXLReader::Row const &row) {
+      checksum += row.RaJ2000;
+      ++rows;
+      return true;
+    });
+    return rows;
+  });
+
+  Measure("PPMXLParser (Jmag <= 5.01)", bytes, [&] {
+    PPMXLParser const parser{the::kPositionPPMXLColumns,
+                             the::PPMXLFilter{}.Magnitude(the::PPMXLColumn::Jmag, 0.0, 5.01)};
+    std::size_t rows = 0;
+    parser.Parse(text.data(), text.data() + text.size(), [&](PPMXLReader::Row const &row) {
+      checksum += row.RaJ2000;
+      ++rows;
+      return true;
+    });
+    return rows;
+  });
+
+  Measure("PPMXLParser (Ipix range)", bytes, [&] {
+    PPMXLParser const parser{the::kPositionPPMXLColumns, the::PPMXLFilter{}.Ipix(0, 161387954652791ull + 7919)};
+    std::size_t rows = 0;
+    parser.Parse(text.data(), text.data() + text.size(), [&](PPMXLReader::Row const &row) {
+      checksum += row.RaJ2000;
+      ++rows;
+      return true;
+    });
+    return rows;
+  });
+
+  Measure("PPMXLReader::Read (stream)", bytes, [&] {
+    std::istringstream is{text};
+    PPMXLReader reader{is};
+    return reader.Read(PPMXLParser{the::kPositionPPMXLColumns}, [&](PPMXLReader::Row const &row) {
+      checksum += row.RaJ2000;
+    });
+  });
+
+  Measure("IngestPPMXL (all cores)", bytes, [&] {
+    return the::IngestPPMXL(the::PPMXLParser{the::kPositionPPMXLColumns},
+                            {text.data(), static_cast<std::ptrdiff_t>(text.size())}, 0, 0,
+                            [&](PPMXLReader::Row const &row) {
+                              checksum += row.RaJ2000;
+                            });
+  });
+
+  auto const gz = Gzip(text);
+  the::PPMXLIngestStats stats;
+  Measure("PPMXLReader::ReadGzip", bytes, [&] {
+    std::istringstream is{gz};
+    PPMXLReader reader{is};
+    auto const rows = reader.ReadGzip(PPMXLParser{the::kPositionPPMXLColumns}, 0, [&](PPMXLReader::Row const &row) {
+      checksum += row.RaJ2000;
+    }, &stats);
+    return rows ? *rows : 0;
+  });
+  INFO() << "ReadGzip: " << stats;
+
+  DEBUG() << "checksum=" << checksum;
+
+  return 0;
+}
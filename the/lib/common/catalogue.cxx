@@ -0,0 +1,219 @@
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "catalogue.hxx"
+
+namespace the {
+
+namespace {
+
+std::uint64_t AlignUp(std::uint64_t const offset) {
+  return (offset + kCatalogueAlignment - 1) / kCatalogueAlignment * kCatalogueAlignment;
+}
+
+bool WritePadding(std::FILE *file, std::uint64_t const from, std::uint64_t const to) {
+  static char const zeros[kCatalogueAlignment] = {};
+  return to == from || std::fwrite(zeros, 1, to - from, file) == to - from;
+}
+
+}
+
+CatalogueType CatalogueColumnType(PPMXLColumn const column) {
+  switch (column) {
+    case PPMXLColumn::Ipix:
+      return CatalogueType::UInt64;
+    case PPMXLColumn::NObs:
+      return CatalogueType::UInt32;
+    default:
+      return CatalogueType::Float64;
+  }
+}
+
+std::size_t CatalogueTypeWidth(CatalogueType const type) {
+  switch (type) {
+    case CatalogueType::UInt64:  return sizeof(std::uint64_t);
+    case CatalogueType::Float64: return sizeof(double);
+    case CatalogueType::Float32: return sizeof(float);
+    case CatalogueType::UInt32:  return sizeof(std::uint32_t);
+  }
+  return 0;
+}
+
+Fallible<Catalogue> Catalogue::Open(char const *fpath) {
+  Catalogue cat;
+
+  if (auto rv = MappedFile::Open(fpath); !rv) {
+    return {RuntimeError{std::string{"could not open catalogue: "} + fpath}};
+  } else {
+    cat.file_ = std::move(*rv);
+  }
+
+  auto const size = cat.file_.size();
+  if (size < sizeof(CatalogueHeader))
+    return {RuntimeError{"catalogue is truncated"}};
+
+  auto const *header = reinterpret_cast<CatalogueHeader const *>(cat.file_.data());
+  if (std::memcmp(header->Magic, kCatalogueMagic, sizeof(kCatalogueMagic)) != 0)
+    return {RuntimeError{"not a catalogue file"}};
+  if (header->Version != kCatalogueVersion)
+    return {RuntimeError{"unsupported catalogue version " + std::to_string(header->Version)}};
+  if (size < sizeof(CatalogueHeader) + header->Columns * sizeof(CatalogueColumn))
+    return {RuntimeError{"catalogue column descriptors are truncated"}};
+
+  auto const *columns = reinterpret_cast<CatalogueColumn const *>(header + 1);
+  for (std::uint32_t i = 0; i < header->Columns; ++i) {
+    auto const &col = columns[i];
+    // Rows comes from the file, so the column size is divided rather than
+    // Rows multiplied to keep a crafted header from wrapping around.
+    if (col.Width == 0 || col.Width != CatalogueTypeWidth(col.Type) ||
+        col.Size % col.Width != 0 || col.Size / col.Width != header->Rows ||
+        col.Offset % kCatalogueAlignment != 0 ||
+        col.Offset > size || col.Size > size - col.Offset) {
+      return {RuntimeError{"catalogue column #" + std::to_string(i) + " is malformed"}};
+    }
+  }
+
+  cat.header_  = header;
+  cat.columns_ = columns;
+
+  return {std::move(cat)};
+}
+
+CatalogueColumn const * Catalogue::Find(PPMXLColumn const column) const {
+  for (auto const &col : Columns()) {
+    if (col.Id == static_cast<std::uint16_t>(column))
+      return &col;
+  }
+  return nullptr;
+}
+
+CatalogueWriter::CatalogueWriter(CatalogueWriter &&other) noexcept
+    : fpath_{std::move(other.fpath_)}
+    , out_{std::exchange(other.out_, nullptr)}
+    , spools_{std::move(other.spools_)}
+    , rows_{std::exchange(other.rows_, 0)}
+{
+  other.spools_.clear();
+}
+
+CatalogueWriter::~CatalogueWriter() {
+  for (auto &spool : spools_)
+    std::fclose(spool.file);
+  if (out_)
+    std::fclose(out_);
+}
+
+Fallible<CatalogueWriter> CatalogueWriter::Create(char const *fpath,
+                                                  gsl::span<PPMXLColumn const> columns) {
+  CatalogueWriter writer;
+  writer.fpath_ = fpath;
+
+  writer.out_ = std::fopen(fpath, "wb");
+  if (!writer.out_)
+    return {RuntimeError{std::string{"could not create catalogue "} + fpath}};
+
+  for (auto const column : columns) {
+    if (column == PPMXLColumn::MagSurveys || column == PPMXLColumn::Flags)
+      return {RuntimeError{std::string{"column is not numeric: "} + PPMXLColumnName(column)}};
+
+    auto const spoolPath = writer.fpath_ + '.' + PPMXLColumnName(column) + ".tmp";
+    std::FILE *file = std::fopen(spoolPath.c_str(), "w+b");
+    if (!file)
+      return {RuntimeError{"could not create temporary file " + spoolPath}};
+    // The file stays accessible through the handle until it is closed.
+    std::remove(spoolPath.c_str());
+
+    writer.spools_.push_back({column, CatalogueColumnType(column), file});
+  }
+
+  return {std::move(writer)};
+}
+
+void CatalogueWriter::Append(PPMXLReader::Row const &row) {
+  for (auto const &spool : spools_) {
+    switch (spool.type) {
+      case CatalogueType::UInt64: {
+        std::uint64_t const value = row.Ipix;
+        std::fwrite(&value, sizeof(value), 1, spool.file);
+        break;
+      }
+      case CatalogueType::UInt32: {
+        std::uint32_t const value = row.NObs;
+        std::fwrite(&value, sizeof(value), 1, spool.file);
+        break;
+      }
+      case CatalogueType::Float64: {
+        double const value = row.Value(spool.column);
+        std::fwrite(&value, sizeof(value), 1, spool.file);
+        break;
+      }
+      case CatalogueType::Float32: {
+        float const value = static_cast<float>(row.Value(spool.column));
+        std::fwrite(&value, sizeof(value), 1, spool.file);
+        break;
+      }
+    }
+  }
+  ++rows_;
+}
+
+Fallible<> CatalogueWriter::Finish() {
+  if (!out_)
+    return {RuntimeError{"catalogue is already finished"}};
+
+  CatalogueHeader header = {};
+  std::memcpy(header.Magic, kCatalogueMagic, sizeof(kCatalogueMagic));
+  header.Version = kCatalogueVersion;
+  header.Columns = static_cast<std::uint32_t>(spools_.size());
+  header.Rows    = rows_;
+
+  std::vector<CatalogueColumn> columns;
+  std::uint64_t offset = AlignUp(sizeof(header) + spools_.size() * sizeof(CatalogueColumn));
+  for (auto const &spool : spools_) {
+    CatalogueColumn col = {};
+    col.Id     = static_cast<std::uint16_t>(spool.column);
+    col.Type   = spool.type;
+    col.Width  = static_cast<std::uint8_t>(CatalogueTypeWidth(spool.type));
+    col.Offset = offset;
+    col.Size   = rows_ * col.Width;
+    columns.push_back(col);
+    offset = AlignUp(offset + col.Size);
+  }
+
+  if (std::fwrite(&header, sizeof(header), 1, out_) != 1 ||
+      std::fwrite(columns.data(), sizeof(CatalogueColumn), columns.size(), out_) != columns.size())
+    return {RuntimeError{"could not write catalogue header"}};
+
+  std::uint64_t written = sizeof(header) + columns.size() * sizeof(CatalogueColumn);
+  std::vector<char> buffer(1 << 20);
+  for (std::size_t i = 0; i < spools_.size(); ++i) {
+    if (!WritePadding(out_, written, columns[i].Offset))
+      return {RuntimeError{"could not write catalogue padding"}};
+    written = columns[i].Offset;
+
+    std::FILE *spool = spools_[i].file;
+    if (std::fflush(spool) != 0 || std::fseek(spool, 0, SEEK_SET) != 0)
+      return {RuntimeError{"could not rewind temporary file"}};
+    while (auto const n = std::fread(buffer.data(), 1, buffer.size(), spool)) {
+      if (std::fwrite(buffer.data(), 1, n, out_) != n)
+        return {RuntimeError{"could not write catalogue column"}};
+      written += n;
+    }
+    if (written != columns[i].Offset + columns[i].Size)
+      return {RuntimeError{std::string{"column is incomplete: "} + PPMXLColumnName(spools_[i].column)}};
+  }
+
+  for (auto &spool : spools_)
+    std::fclose(spool.file);
+  spools_.clear();
+
+  auto const rv = std::fclose(out_);
+  out_ = nullptr;
+  if (rv != 0)
+    return {RuntimeError{"could not close catalogue " + fpath_}};
+
+  return {};
+}
+
+}
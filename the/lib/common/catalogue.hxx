@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gsl.h>
+
+#include "errors.hxx"
+#include "ppmxlreader.hxx"
+#include "utils.hxx"
+
+namespace the {
+
+// Binary columnar star catalogue.
+//
+// A file starts with CatalogueHeader followed by CatalogueHeader::Columns
+// column descriptors. Data of every column is a contiguous array of
+// CatalogueHeader::Rows values starting at an offset aligned to
+// kCatalogueAlignment bytes, so a column can be used in place once the file
+// is mapped into memory. Values are stored in the little-endian byte order.
+// Missing values ("None" in PPMXL) are stored as NaN.
+
+/// Type of values of a catalogue column.
+enum class CatalogueType: std::uint8_t {
+  UInt64  = 1,
+  Float64 = 2,
+  Float32 = 3,
+  UInt32  = 4,
+};
+
+struct CatalogueHeader {
+  char          Magic[8];
+  std::uint32_t Version;
+  /// Number of column descriptors following the header.
+  std::uint32_t Columns;
+  /// Number of values in every column.
+  std::uint64_t Rows;
+  std::uint64_t Reserved[5];
+};
+static_assert(sizeof(CatalogueHeader) == 64, "catalogue header must be 64 bytes");
+
+struct CatalogueColumn {
+  /// Value of PPMXLColumn.
+  std::uint16_t Id;
+  CatalogueType Type;
+  /// Size of a value in bytes.
+  std::uint8_t  Width;
+  std::uint32_t Reserved0;
+  /// Offset of the column data from the beginning of the file.
+  std::uint64_t Offset;
+  /// Size of the column data in bytes.
+  std::uint64_t Size;
+  std::uint64_t Reserved1;
+};
+static_assert(sizeof(CatalogueColumn) == 32, "catalogue column descriptor must be 32 bytes");
+
+char constexpr kCatalogueMagic[8] = {'T', 'H', 'E', 'C', 'A', 'T', 'L', 'G'};
+std::uint32_t constexpr kCatalogueVersion = 1;
+std::size_t constexpr kCatalogueAlignment = 64;
+
+template <typename T> struct CatalogueTypeOf;
+template <> struct CatalogueTypeOf<std::uint64_t> { static constexpr auto value = CatalogueType::UInt64; };
+template <> struct CatalogueTypeOf<double>        { static constexpr auto value = CatalogueType::Float64; };
+template <> struct CatalogueTypeOf<float>         { static constexpr auto value = CatalogueType::Float32; };
+template <> struct CatalogueTypeOf<std::uint32_t> { static constexpr auto value = CatalogueType::UInt32; };
+
+/// Returns a type the column is stored with.
+/// @return UInt64 for Ipix, UInt32 for NObs and Float64 for the rest.
+CatalogueType CatalogueColumnType(PPMXLColumn column);
+
+/// Returns a size of a value of the given type in bytes.
+std::size_t CatalogueTypeWidth(CatalogueType type);
+
+/// Implements a read-only view of a catalogue file mapped into memory.
+/// Columns are exposed as spans pointing into the mapping, so no data is copied.
+struct Catalogue final {
+  static Fallible<Catalogue> Open(char const *fpath);
+
+  std::size_t Rows() const {
+    return header_ ? header_->Rows : 0;
+  }
+
+  gsl::span<CatalogueColumn const> Columns() const {
+    return {columns_, header_ ? static_cast<std::ptrdiff_t>(header_->Columns) : 0};
+  }
+
+  /// Returns the whole mapped file.
+  gsl::span<char const> Bytes() const {
+    return file_.Bytes();
+  }
+
+  bool Has(PPMXLColumn column) const {
+    return Find(column) != nullptr;
+  }
+
+  /// Returns values of the column, or an empty span if the column is absent
+  /// or stored with another type.
+  template <typename T>
+  gsl::span<T const> Column(PPMXLColumn column) const {
+    auto const *desc = Find(column);
+    if (!desc || desc->Type != CatalogueTypeOf<T>::value)
+      return {};
+    return {reinterpret_cast<T const *>(file_.data() + desc->Offset),
+            static_cast<std::ptrdiff_t>(Rows())};
+  }
+
+  gsl::span<std::uint64_t const> Ipix()     const { return Column<std::uint64_t>(PPMXLColumn::Ipix); }
+  gsl::span<double const>        RaJ2000()  const { return Column<double>(PPMXLColumn::RaJ2000); }
+  gsl::span<double const>        DecJ2000() const { return Column<double>(PPMXLColumn::DecJ2000); }
+  gsl::span<double const>        PmRA()     const { return Column<double>(PPMXLColumn::PmRA); }
+  gsl::span<double const>        PmDE()     const { return Column<double>(PPMXLColumn::PmDE); }
+  gsl::span<double const>        Jmag()     const { return Column<double>(PPMXLColumn::Jmag); }
+  gsl::span<double const>        Hmag()     const { return Column<double>(PPMXLColumn::Hmag); }
+  gsl::span<double const>        Kmag()     const { return Column<double>(PPMXLColumn::Kmag); }
+  gsl::span<double const>        B1mag()    const { return Column<double>(PPMXLColumn::B1mag); }
+  gsl::span<double const>        R1mag()    const { return Column<double>(PPMXLColumn::R1mag); }
+
+ private:
+  CatalogueColumn const * Find(PPMXLColumn column) const;
+
+  MappedFile file_;
+  CatalogueHeader const *header_  = nullptr;
+  CatalogueColumn const *columns_ = nullptr;
+};
+
+/// Writes a catalogue file row by row.
+/// Every column is spooled into its own temporary file next to the output,
+/// so the memory footprint does not depend on the number of rows.
+struct CatalogueWriter final {
+  CatalogueWriter() = default;
+  CatalogueWriter(CatalogueWriter const &) = delete;
+  CatalogueWriter(CatalogueWriter &&other) noexcept;
+  ~CatalogueWriter();
+
+  static Fallible<CatalogueWriter> Create(char const *fpath,
+                                          gsl::span<PPMXLColumn const> columns);
+
+  void Append(PPMXLReader::Row const &row);
+
+  /// Writes the header and the columns into the output file and closes it.
+  Fallible<> Finish();
+
+  std::uint64_t Rows() const { return rows_; }
+
+ private:
+  struct Spool {
+    PPMXLColumn   column;
+    CatalogueType type;
+    std::FILE    *file;
+  };
+
+  std::string        fpath_;
+  std::FILE         *out_ = nullptr;
+  std::vector<Spool> spools_;
+  std::uint64_t      rows_ = 0;
+};
+
+}
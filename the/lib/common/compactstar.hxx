@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "ppmxlparser.hxx"
+#include "ppmxlreader.hxx"
+
+namespace the {
+
+// Quantised star record.
+//
+// Drawing a star takes its position, magnitude and colour, a few bytes out
+// of the 250 of PPMXLReader::Row. CompactStar keeps them in fixed point in
+// 16 bytes. Precision of values decoded, against the doubles encoded:
+//
+//   RaJ2000, DecJ2000  steps of 2^-32 of a turn (0.302 mas), error <= 0.151 mas;
+//   Jmag, J-Ks         steps of 1 mmag, error <= 0.5 mmag, range +-32.766 mag;
+//   PmRA, PmDE         steps of 0.5 mas/yr, error <= 0.25 mas/yr, range +-16.383 "/yr.
+//
+// PPMXL itself gives positions to 1e-6 deg (3.6 mas) and magnitudes to 1 mmag,
+// and its proper motions are uncertain by 2-10 mas/yr, so for PPMXL the
+// record is as good as the source. Values out of range saturate.
+// Missing magnitudes decode to NaN, missing proper motions and positions that
+// are not finite to zero.
+
+/// Columns of PPMXL CompactStar is made of.
+PPMXLColumns constexpr kCompactPPMXLColumns =
+    kPositionPPMXLColumns | ColumnBit(PPMXLColumn::PmRA) | ColumnBit(PPMXLColumn::PmDE) |
+    ColumnBit(PPMXLColumn::Kmag);
+
+/// Units of angles of CompactStar in degrees.
+double constexpr kCompactAngleStep = 360.0 / 4294967296.0;
+/// Units of proper motions of CompactStar in degrees per year (0.5 mas/yr).
+double constexpr kCompactPmStep = 0.5 / 3600e3;
+/// Magnitudes missing are stored as the largest value, so they sort last.
+std::int16_t constexpr kCompactMissing = std::numeric_limits<std::int16_t>::max();
+
+/// Returns a magnitude of CompactStar in magnitudes, NaN if missing.
+inline double CompactMagnitude(std::int16_t const value) {
+  return value == kCompactMissing ? std::numeric_limits<double>::quiet_NaN() : value * 1e-3;
+}
+
+namespace details {
+
+/// Returns the angle in degrees in units of kCompactAngleStep, zero if it is
+/// not finite, which llround leaves undefined.
+inline std::int64_t QuantiseAngle(double const value) {
+  if (!std::isfinite(value))
+    return 0;
+  return std::llround(value / kCompactAngleStep);
+}
+
+inline std::int16_t QuantiseMag(double const value) {
+  if (std::isnan(value))
+    return kCompactMissing;
+  return static_cast<std::int16_t>(std::clamp(std::round(value * 1e3), -32766.0, 32766.0));
+}
+
+inline std::int16_t QuantisePm(double const value) {
+  if (std::isnan(value))
+    return 0;
+  return static_cast<std::int16_t>(std::clamp(std::round(value / kCompactPmStep), -32767.0, 32767.0));
+}
+
+}
+
+/// Implements a star in 16 bytes.
+struct CompactStar {
+  /// Right ascension J2000.0 in 2^-32 of a turn.
+  std::uint32_t Ra;
+  /// Declination J2000.0 in 2^-32 of a turn.
+  std::int32_t  Dec;
+  /// Proper motion in RA*cos(delta) and Dec in 0.5 mas/yr.
+  std::int16_t  PmRA;
+  std::int16_t  PmDE;
+  /// Jmag in millimagnitudes, brightest stars first when sorted; INT16_MAX if missing.
+  std::int16_t  Mag;
+  /// Colour index J-Ks in millimagnitudes, INT16_MAX if missing.
+  std::int16_t  Colour;
+
+  static CompactStar FromRow(PPMXLReader::Row const &row) {
+    using namespace details;
+    CompactStar star;
+    // Rounding 360 degrees gives 2^32 that wraps to 0.
+    star.Ra     = static_cast<std::uint32_t>(static_cast<std::uint64_t>(
+        QuantiseAngle(std::fmod(row.RaJ2000, 360.0))));
+    star.Dec    = static_cast<std::int32_t>(QuantiseAngle(std::clamp(row.DecJ2000, -90.0, 90.0)));
+    star.PmRA   = QuantisePm(row.PmRA);
+    star.PmDE   = QuantisePm(row.PmDE);
+    star.Mag    = QuantiseMag(row.Jmag);
+    star.Colour = QuantiseMag(row.Jmag - row.Kmag);
+    return star;
+  }
+
+  /// Returns coordinates in degrees, and proper motions in degrees per year as PPMXL does.
+  double RaJ2000()  const { return Ra * kCompactAngleStep; }
+  double DecJ2000() const { return Dec * kCompactAngleStep; }
+  double PmRADeg()  const { return PmRA * kCompactPmStep; }
+  double PmDEDeg()  const { return PmDE * kCompactPmStep; }
+  /// Returns NaN if the magnitude is missing.
+  double Jmag()     const { return CompactMagnitude(Mag); }
+  double JKs()      const { return CompactMagnitude(Colour); }
+};
+static_assert(sizeof(CompactStar) == 16, "compact star must be 16 bytes");
+
+}
@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <cmath>
+
+#include "culling.hxx"
+
+namespace the {
+
+std::array<Vec3, 5> FrustumNormals(Mat4f const &projection) {
+  // A point is in the view if -w <= x <= w, -w <= y <= w and 0 < w in clip
+  // coordinates, so the sides are rows of the projection added to and
+  // subtracted from the last. Their last terms are zero as the eye is at the origin.
+  std::array<Vec3, 5> normals;
+  for (int side = 0; side < 5; ++side) {
+    double const sign = side == 4 ? 0.0 : side % 2 == 0 ? 1.0 : -1.0;
+    auto const &row = projection[side / 2 % 2];
+    Vec3 normal;
+    for (int i = 0; i < 3; ++i)
+      normal[i] = double(projection[3][i]) + sign * double(row[i]);
+    normals[std::size_t(side)] = normal / std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+  }
+  return normals;
+}
+
+std::size_t CullQuadruples(gsl::span<Vec3 const> const normals, double const margin,
+                           gsl::span<float> const quads) {
+  double const bound = -std::sin(margin);
+
+  auto const size = static_cast<std::size_t>(quads.size()) / 4;
+  auto *const data = quads.data();
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    auto const *quad = data + 4 * i;
+    bool inside = true;
+    for (auto const &n : normals)
+      inside &= n[0] * double(quad[0]) + n[1] * double(quad[1]) + n[2] * double(quad[2]) >= bound;
+    if (!inside)
+      continue;
+    if (kept != i)
+      std::copy(quad, quad + 4, data + 4 * kept);
+    ++kept;
+  }
+  return kept;
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <gsl.h>
+
+#include "mat.hxx"
+#include "vec.hxx"
+
+namespace the {
+
+// Culling of stars out of the view.
+//
+// Stars lie on the unit sphere around the eye, far from the near and far
+// planes, so a view frustum comes down to its four sides, planes through the
+// eye. A star is in the view if it is on the inner side of every plane; a cut
+// at the horizon is one more such plane. Caps of tiles are tested against the
+// same planes by PlanesOverlap (see tiles.hxx), so TileIndex::Query rejects
+// whole regions of the sky at once.
+
+/// Returns unit inward normals of the left, right, bottom and top sides of the
+/// frustum of a projection, and of the plane through the eye facing the view.
+/// The last one adds nothing for points, but rejects caps behind the eye the
+/// sides alone do not. The projection takes points of the frame of the eye,
+/// the eye at the origin, as column vectors to clip coordinates.
+std::array<Vec3, 5> FrustumNormals(Mat4f const &projection);
+
+/// Moves quadruples (x, y, z, w) of quads whose unit vector (x, y, z) is within
+/// margin radians of the region bounded by planes through the origin to the
+/// front, in order, and returns their number. Normals must be unit vectors.
+std::size_t CullQuadruples(gsl::span<Vec3 const> normals, double margin, gsl::span<float> quads);
+
+}
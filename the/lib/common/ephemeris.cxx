@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "ephemeris.hxx"
+#include "utils.hxx"
+
+namespace the {
+
+Vec3 ChebyshevEphemeris::operator () (double const t) const {
+  auto const n = Terms();
+  double const position = (t - begin_) / length_;
+  // The end of the span belongs to the last segment.
+  auto const segment = std::min(static_cast<std::size_t>(std::max(position, 0.0)), segments_ - 1);
+  double const x = 2.0 * (position - double(segment)) - 1.0;
+
+  auto const *c = &coefficients_[segment * 3 * n];
+  Vec3 result;
+  for (int axis = 0; axis < 3; ++axis, c += n) {
+    // Clenshaw's recurrence b_j = c_j + 2x b_j+1 - b_j+2.
+    double b1 = 0.0, b2 = 0.0;
+    for (auto j = n - 1; j > 0; --j) {
+      double const b = c[j] + 2.0 * x * b1 - b2;
+      b2 = b1;
+      b1 = b;
+    }
+    result[axis] = c[0] + x * b1 - b2;
+  }
+  return result;
+}
+
+Fallible<ChebyshevEphemeris> ChebyshevEphemeris::Open(char const *fpath) {
+  auto file = MappedFile::Open(fpath);
+  if (!file)
+    return {RuntimeError{std::string{"could not open ephemeris: "} + fpath}};
+
+  if (file->size() < sizeof(EphemerisHeader))
+    return {RuntimeError{"ephemeris is truncated"}};
+  EphemerisHeader header;
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (std::memcmp(header.Magic, kEphemerisMagic, sizeof(kEphemerisMagic)) != 0)
+    return {RuntimeError{"not an ephemeris file"}};
+  if (header.Version != kEphemerisVersion)
+    return {RuntimeError{"unsupported ephemeris version " + std::to_string(header.Version)}};
+  if (!(header.Length > 0.0) || header.Segments == 0)
+    return {RuntimeError{"ephemeris is malformed"}};
+  if (header.Degree == 0 || header.Degree > kMaxEphemerisDegree)
+    return {RuntimeError{"unsupported ephemeris degree " + std::to_string(header.Degree)}};
+
+  ChebyshevEphemeris ephemeris;
+  ephemeris.begin_    = header.Begin;
+  ephemeris.length_   = header.Length;
+  ephemeris.degree_   = header.Degree;
+  ephemeris.segments_ = header.Segments;
+  // Divided rather than multiplied, which a crafted count of segments could overflow.
+  auto const segment = 3 * ephemeris.Terms() * sizeof(double);
+  auto const bytes = file->size() - sizeof(header);
+  if (bytes % segment != 0 || bytes / segment != ephemeris.segments_)
+    return {RuntimeError{"ephemeris coefficients are truncated"}};
+  auto const count = ephemeris.segments_ * 3 * ephemeris.Terms();
+  ephemeris.coefficients_.resize(count);
+  std::memcpy(ephemeris.coefficients_.data(), file->data() + sizeof(header), count * sizeof(double));
+
+  return {std::move(ephemeris)};
+}
+
+Fallible<> ChebyshevEphemeris::Write(char const *fpath) const {
+  EphemerisHeader header = {};
+  std::memcpy(header.Magic, kEphemerisMagic, sizeof(kEphemerisMagic));
+  header.Version  = kEphemerisVersion;
+  header.Degree   = degree_;
+  header.Segments = segments_;
+  header.Begin    = begin_;
+  header.Length   = length_;
+
+  auto const bytes = coefficients_.size() * sizeof(double);
+  auto file = MappedFile::Create(fpath, sizeof(header) + bytes);
+  if (!file)
+    return {RuntimeError{std::string{"could not write ephemeris: "} + fpath}};
+  std::memcpy(file->MutableData(), &header, sizeof(header));
+  std::memcpy(file->MutableData() + sizeof(header), coefficients_.data(), bytes);
+
+  return {};
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "consts.hxx"
+#include "errors.hxx"
+#include "vec.hxx"
+
+namespace the {
+
+// Ephemerides of vectors approximated by Chebyshev polynomials.
+//
+// A span of time is cut into segments of equal length, and every coordinate
+// of a segment is a Chebyshev series fitted at the Chebyshev nodes of it, as
+// JPL ephemerides are. Looking a time up takes a division to find the segment
+// and a Clenshaw recurrence of a multiply-add per coefficient, however many
+// terms the series fitted have.
+//
+// A file of an ephemeris starts with EphemerisHeader followed by Segments
+// segments of 3 * (Degree + 1) coefficients, x ones first, as doubles in the
+// little-endian byte order.
+
+struct EphemerisHeader {
+  char          Magic[8];
+  std::uint32_t Version;
+  std::uint32_t Degree;
+  std::uint64_t Segments;
+  /// Start of the span and the length of a segment, in the units of time fitted.
+  double        Begin;
+  double        Length;
+  std::uint64_t Reserved[3];
+};
+static_assert(sizeof(EphemerisHeader) == 64, "ephemeris header must be 64 bytes");
+
+char constexpr kEphemerisMagic[8] = {'T', 'H', 'E', 'E', 'P', 'H', 'E', 'M'};
+std::uint32_t constexpr kEphemerisVersion = 1;
+/// Degrees of series a file may have, well past any worth fitting.
+std::uint32_t constexpr kMaxEphemerisDegree = 32;
+
+struct ChebyshevEphemeris final {
+  ChebyshevEphemeris() = default;
+
+  /// Fits fn(t), returning Vec3, over [begin, end) in segments of the length
+  /// with series of degree + 1 terms.
+  template <typename Fn>
+  static ChebyshevEphemeris Fit(Fn &&fn, double begin, double end, double length, unsigned degree);
+
+  static Fallible<ChebyshevEphemeris> Open(char const *fpath);
+  Fallible<> Write(char const *fpath) const;
+
+  bool Empty() const { return segments_ == 0; }
+  double Begin() const { return begin_; }
+  double End() const { return begin_ + double(segments_) * length_; }
+
+  bool Covers(double const t) const {
+    return !Empty() && t >= Begin() && t <= End();
+  }
+
+  /// Returns the vector at t, which must be covered.
+  Vec3 operator () (double t) const;
+
+ private:
+  std::size_t Terms() const { return degree_ + 1; }
+
+  double              begin_    = 0.0;
+  double              length_   = 1.0;
+  unsigned            degree_   = 0;
+  std::size_t         segments_ = 0;
+  std::vector<double> coefficients_;
+};
+
+template <typename Fn>
+ChebyshevEphemeris ChebyshevEphemeris::Fit(Fn &&fn, double const begin, double const end,
+                                           double const length, unsigned const degree) {
+  ChebyshevEphemeris ephemeris;
+  ephemeris.begin_    = begin;
+  ephemeris.length_   = length;
+  ephemeris.degree_   = degree;
+  ephemeris.segments_ = end > begin ? static_cast<std::size_t>(std::ceil((end - begin) / length)) : 0;
+
+  auto const n = ephemeris.Terms();
+  ephemeris.coefficients_.assign(ephemeris.segments_ * 3 * n, 0.0);
+  std::vector<Vec3> values(n);
+  for (std::size_t segment = 0; segment < ephemeris.segments_; ++segment) {
+    double const middle = begin + (double(segment) + 0.5) * length;
+    // Nodes are the zeros of the polynomial of degree n, where the
+    // polynomials of lower degrees are orthogonal in the sum.
+    for (std::size_t k = 0; k < n; ++k)
+      values[k] = fn(middle + 0.5 * length * std::cos(kPi * (double(k) + 0.5) / double(n)));
+
+    auto *c = &ephemeris.coefficients_[segment * 3 * n];
+    for (std::size_t j = 0; j < n; ++j) {
+      Vec3 sum{0.0, 0.0, 0.0};
+      for (std::size_t k = 0; k < n; ++k)
+        sum = sum + values[k] * std::cos(kPi * double(j) * (double(k) + 0.5) / double(n));
+      double const scale = (j == 0 ? 1.0 : 2.0) / double(n);
+      for (int axis = 0; axis < 3; ++axis)
+        c[axis * n + j] = sum[axis] * scale;
+    }
+  }
+
+  return ephemeris;
+}
+
+}
@@ -0,0 +1,64 @@
+#include <cmath>
+
+#include "frames.hxx"
+#include "precnut.hxx"
+#include "spheric.hxx"
+
+namespace the {
+
+Frames MakeFrames(double const T) {
+  auto const nutation = NutMatrix(T);
+  auto const ecl2equ = Ecl2EquMatrix(T);
+  return {{
+    PrecMatrixEcl(0.0, T),
+    ecl2equ,
+    nutation * ecl2equ,
+    nutation * PrecMatrixEqu(0.0, T),
+  }};
+}
+
+Mat3 FrameCache::At(Frame const frame, double const T) {
+  Mat3 result;
+  At(frame, {&T, 1}, {&result, 1});
+  return result;
+}
+
+void FrameCache::At(Frame const frame, gsl::span<double const> T, gsl::span<Mat3> out) {
+  Expects(out.size() == T.size());
+  // Matrices of the nodes around the epoch, copied under the lock and
+  // interpolated out of it. Epochs of a batch mostly fall between the same.
+  auto held = INT64_MIN;
+  Mat3 a, b;
+  for (std::ptrdiff_t k = 0; k < T.size(); ++k) {
+    double const nodes = std::floor(T[k] / kFrameStep);
+    auto const index = static_cast<std::int64_t>(nodes);
+    double const f = T[k] / kFrameStep - nodes;
+    if (index != held) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      a = NodeAt(index)[frame];
+      b = NodeAt(index + 1)[frame];
+      held = index;
+    }
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j)
+        out[k][i][j] = a[i][j] + (b[i][j] - a[i][j]) * f;
+    }
+  }
+}
+
+FrameCache &FrameCache::Shared() {
+  thread_local FrameCache cache;
+  return cache;
+}
+
+Frames const &FrameCache::NodeAt(std::int64_t const index) {
+  // Consecutive nodes fall in different slots.
+  auto &node = nodes_[static_cast<std::uint64_t>(index) % kSlots];
+  if (node.Index != index) {
+    node.Index = index;
+    node.Matrices = MakeFrames(double(index) * kFrameStep);
+  }
+  return node.Matrices;
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+#include <gsl.h>
+
+#include "mat.hxx"
+
+namespace the {
+
+// Matrices of reference frames of epochs.
+//
+// Precession, the obliquity of the ecliptic and nutation change over years,
+// not frames, so a FrameCache computes them at nodes an hour apart and
+// interpolates between nodes, to 1e-10 rad. Every job turning positions of
+// epochs near one another, a table over a range of time or the sky drawn
+// frame after frame, takes them from the same few nodes.
+
+/// Transformations of an epoch.
+enum class Frame {
+  /// Ecliptic of J2000 to the ecliptic of date, PrecMatrixEcl(0, T).
+  PrecEcl,
+  /// Ecliptic of date to the mean equator of date, Ecl2EquMatrix(T).
+  Ecl2Equ,
+  /// Ecliptic of date to the true equator of date, NutMatrix(T) * Ecl2EquMatrix(T).
+  Ecl2True,
+  /// Equator of J2000 to the true equator of date, NutMatrix(T) * PrecMatrixEqu(0, T).
+  J2000ToTrue,
+};
+
+std::size_t constexpr kFrames = 4;
+
+/// Matrices of every Frame of an epoch.
+struct Frames final {
+  Mat3 const &operator[](Frame const frame) const {
+    return Matrices[static_cast<std::size_t>(frame)];
+  }
+
+  std::array<Mat3, kFrames> Matrices;
+};
+
+/// Computes the matrices of epoch T, in Julian centuries since J2000.
+Frames MakeFrames(double const T);
+
+/// Nodes an hour apart, in Julian centuries.
+double constexpr kFrameStep = 1.0 / 36525.0 / 24.0;
+
+/// Cache of Frames at nodes kFrameStep apart, interpolated between them.
+/// It is safe to use from many threads.
+struct FrameCache final {
+  /// Returns the matrix of the frame at epoch T, in Julian centuries since J2000.
+  Mat3 At(Frame const frame, double const T);
+  /// Same as above, of every epoch T into out of the same size.
+  void At(Frame const frame, gsl::span<double const> T, gsl::span<Mat3> out);
+
+  /// The cache of the calling thread, which every job on it shares. Threads
+  /// keep caches of their own, so that workers over distant epochs neither
+  /// wait for one another nor evict one another's nodes.
+  static FrameCache &Shared();
+
+ private:
+  /// Nodes kept, by their index modulo this.
+  static std::size_t constexpr kSlots = 16;
+
+  struct Node final {
+    std::int64_t Index = INT64_MIN;
+    Frames Matrices;
+  };
+
+  Frames const &NodeAt(std::int64_t const index);
+
+  std::mutex mutex_;
+  std::array<Node, kSlots> nodes_;
+};
+
+}
@@ -0,0 +1,76 @@
+#include <string>
+
+#include <zlib.h>
+
+#include "gzip.hxx"
+
+namespace the {
+
+struct GzipReader::State {
+  z_stream stream = {};
+  bool     initialized = false;
+  /// Whether a member has been started but its end has not been seen yet.
+  bool     inMember = false;
+};
+
+GzipReader::GzipReader(std::istream &is, std::size_t const inputSize)
+    : is_{is}
+    , state_{std::make_unique<State>()}
+    , input_(inputSize)
+{}
+
+GzipReader::~GzipReader() {
+  if (state_->initialized)
+    inflateEnd(&state_->stream);
+}
+
+Fallible<std::size_t> GzipReader::Read(char *out, std::size_t const size) {
+  auto &zs = state_->stream;
+
+  if (!state_->initialized) {
+    // 32 enables detection of either gzip or zlib header.
+    if (inflateInit2(&zs, 15 + 32) != Z_OK)
+      return {RuntimeError{"inflateInit2 failed"}};
+    state_->initialized = true;
+  }
+
+  zs.next_out  = reinterpret_cast<Bytef *>(out);
+  zs.avail_out = static_cast<uInt>(size);
+
+  while (zs.avail_out > 0 && !finished_) {
+    if (zs.avail_in == 0) {
+      is_.read(input_.data(), static_cast<std::streamsize>(input_.size()));
+      auto const got = static_cast<std::size_t>(is_.gcount());
+      if (got == 0) {
+        finished_ = true;
+        if (state_->inMember)
+          return {RuntimeError{"unexpected end of gzip stream"}};
+        break;
+      }
+      consumed_ += got;
+      zs.next_in  = reinterpret_cast<Bytef *>(input_.data());
+      zs.avail_in = static_cast<uInt>(got);
+    }
+
+    state_->inMember = true;
+    switch (auto const rv = inflate(&zs, Z_NO_FLUSH); rv) {
+      case Z_OK:
+        break;
+      case Z_STREAM_END:
+        // Another gzip member may follow.
+        state_->inMember = false;
+        if (inflateReset(&zs) != Z_OK)
+          return {RuntimeError{"inflateReset failed"}};
+        break;
+      case Z_BUF_ERROR:
+        // No progress possible until more input is read.
+        break;
+      default:
+        return {RuntimeError{std::string{"inflate failed: "} + (zs.msg ? zs.msg : std::to_string(rv))}};
+    }
+  }
+
+  return {size - zs.avail_out};
+}
+
+}
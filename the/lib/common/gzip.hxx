@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "errors.hxx"
+
+namespace the {
+
+/// Inflates a gzip (or zlib) stream read from std::istream.
+/// Concatenated gzip members are inflated one after another, as gunzip does.
+struct GzipReader final {
+  explicit GzipReader(std::istream &is, std::size_t inputSize = 1 << 20);
+  GzipReader(GzipReader const &) = delete;
+  ~GzipReader();
+
+  /// Inflates up to size bytes into out.
+  /// @return Number of bytes inflated, 0 at the end of the stream.
+  Fallible<std::size_t> Read(char *out, std::size_t size);
+
+  /// Number of compressed bytes consumed so far.
+  std::uint64_t Consumed() const { return consumed_; }
+
+ private:
+  struct State;
+
+  std::istream          &is_;
+  std::unique_ptr<State> state_;
+  std::vector<char>      input_;
+  std::uint64_t          consumed_ = 0;
+  bool                   finished_ = false;
+};
+
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "lod.hxx"
+
+namespace the {
+
+MagnitudeLod::MagnitudeLod(Catalogue const &catalogue, TileIndex const &tiles)
+    : mags_{catalogue.Column<double>(tiles.Band())}
+    , tiles_{&tiles}
+{
+  if (mags_.size() != static_cast<std::ptrdiff_t>(tiles.Rows()))
+    tiles_ = nullptr;
+}
+
+std::uint64_t MagnitudeLod::Prefix(CatalogueTile const &tile, double const limit) const {
+  if (std::isinf(limit) && limit > 0.0)
+    return tile.Count;
+  // The range of a tile is rounded outwards, so it decides most tiles without a search.
+  if (std::isnan(tile.Brightest) || limit < double(tile.Brightest))
+    return 0;
+
+  auto const *begin = mags_.data() + tile.Begin;
+  auto const *end   = begin + tile.Count;
+  // Missing magnitudes at the end fail the predicate as fainter ones do.
+  return static_cast<std::uint64_t>(
+      std::partition_point(begin, end, [limit](double const m) { return m <= limit; }) - begin);
+}
+
+std::uint64_t MagnitudeLod::Count(double const limit) const {
+  std::uint64_t count = 0;
+  if (tiles_) {
+    for (auto const &tile : tiles_->Tiles())
+      count += Prefix(tile, limit);
+  }
+  return count;
+}
+
+double MagnitudeLod::LimitForCount(std::uint64_t const count) const {
+  if (!tiles_)
+    return -std::numeric_limits<double>::infinity();
+
+  double lo = std::numeric_limits<double>::infinity();
+  double hi = -std::numeric_limits<double>::infinity();
+  for (auto const &tile : tiles_->Tiles()) {
+    if (!std::isnan(tile.Brightest)) {
+      lo = std::min(lo, double(tile.Brightest));
+      hi = std::max(hi, double(tile.Faintest));
+    }
+  }
+  if (lo > hi)
+    return -std::numeric_limits<double>::infinity();
+  if (Count(hi) <= count)
+    return hi;
+
+  // Keep Count(lo) <= count < Count(hi), starting just below the brightest star.
+  lo = std::nextafter(lo, -std::numeric_limits<double>::infinity());
+  for (int i = 0; i < 64 && std::nextafter(lo, hi) < hi; ++i) {
+    auto const mid = lo + (hi - lo) / 2.0;
+    if (Count(mid) <= count)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+}
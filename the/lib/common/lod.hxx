@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include <gsl.h>
+
+#include "catalogue.hxx"
+#include "tiles.hxx"
+
+namespace the {
+
+/// Implements magnitude-ordered levels of detail over a tiled catalogue.
+/// Rows of every tile are sorted by magnitude in the band of the tile
+/// directory, so stars not fainter than a limit are a prefix of the tile and
+/// are used in place. Neither the catalogue nor the index is copied; both must
+/// outlive the object.
+struct MagnitudeLod final {
+  MagnitudeLod() = default;
+  MagnitudeLod(Catalogue const &catalogue, TileIndex const &tiles);
+
+  bool Empty() const { return tiles_ == nullptr; }
+
+  /// Returns the number of leading rows of the tile not fainter than the limit.
+  /// An infinite limit takes the whole tile, stars missing the magnitude included.
+  std::uint64_t Prefix(CatalogueTile const &tile, double limit) const;
+
+  /// Returns magnitudes of the leading rows of the tile not fainter than the limit.
+  gsl::span<double const> Magnitudes(CatalogueTile const &tile, double const limit) const {
+    return mags_.subspan(static_cast<std::ptrdiff_t>(tile.Begin),
+                         static_cast<std::ptrdiff_t>(Prefix(tile, limit)));
+  }
+
+  /// Returns the number of stars of the catalogue not fainter than the limit.
+  std::uint64_t Count(double limit) const;
+
+  /// Returns the faintest limit at which there are at most count stars,
+  /// so that taking Prefix(tile, limit) of every tile yields the count brightest stars
+  /// (fewer if several stars share the magnitude at the limit).
+  double LimitForCount(std::uint64_t count) const;
+
+ private:
+  gsl::span<double const> mags_;
+  TileIndex const        *tiles_ = nullptr;
+};
+
+}
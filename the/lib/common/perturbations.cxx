@@ -0,0 +1,149 @@
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "perturbations.hxx"
+#include "simdmath.hxx"
+
+// Lanes compiled for AVX2 stay within the functions compiled alike, see simdmath.cxx.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace the {
+
+namespace {
+
+// The kernel is written once for a lane type V, a double or a vector of
+// doubles of GCC vector extensions, as the kernels of simdmath are.
+
+#if defined(__SSE2__)
+using Double2 = double __attribute__((vector_size(16)));
+using Double4 = double __attribute__((vector_size(32)));
+#endif
+
+template <typename V>
+std::size_t constexpr kLanes = sizeof(V) / sizeof(double);
+
+template <typename V>
+V Load(double const *p) {
+  V v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+template <typename V>
+void Store(double *p, V const &v) {
+  std::memcpy(p, &v, sizeof(v));
+}
+
+/// Index of the multiple 0 in arrays of cosines and sines of multiples.
+int constexpr o = kPertMaxMultiple;
+int constexpr dim = 2 * o + 1;
+
+/// Fills cosines and sines of multiples [min, max] of an angle from those of it.
+template <typename V>
+void Multiples(V const &cos, V const &sin, int const min, int const max, V *C, V *S) {
+  C[o] = V{} + 1.0;   C[o + 1] = cos;   C[o - 1] = +C[o + 1];
+  S[o] = V{};         S[o + 1] = sin;   S[o - 1] = -S[o + 1];
+  // By the sine law, as Pert of Montenbruck and Pfleger does.
+  for (int i = 1; i < max; ++i) {
+    C[o + i + 1] = C[o + i] * C[o + 1] - S[o + i] * S[o + 1];
+    S[o + i + 1] = S[o + i] * C[o + 1] + C[o + i] * S[o + 1];
+  }
+  for (int i = -1; i > min; --i) {
+    C[o + i - 1] = C[o + i] * C[o - 1] - S[o + i] * S[o - 1];
+    S[o + i - 1] = S[o + i] * C[o - 1] + C[o + i] * S[o - 1];
+  }
+}
+
+template <typename V>
+void SumKernel(PertSeries const &series, V const &T, V const &CM, V const &SM, V const &Cm, V const &Sm,
+               V &dl, V &dr, V &db) {
+  V C[dim], S[dim], c[dim], s[dim];
+  Multiples(CM, SM, series.IMin, series.IMax, C, S);
+  Multiples(Cm, Sm, series.iMin, series.iMax, c, s);
+
+  V u{}, v{}, sumL{}, sumR{}, sumB{};
+  for (std::size_t k = 0; k < series.Size; ++k) {
+    auto const &term = series.Terms[k];
+    if (term.iT == 0) {
+      u = C[o + term.I] * c[o + term.i] - S[o + term.I] * s[o + term.i];
+      v = S[o + term.I] * c[o + term.i] + C[o + term.I] * s[o + term.i];
+    } else {
+      u *= T;
+      v *= T;
+    }
+    sumL += term.dlc * u + term.dls * v;
+    sumR += term.drc * u + term.drs * v;
+    sumB += term.dbc * u + term.dbs * v;
+  }
+  dl += sumL;
+  dr += sumR;
+  db += sumB;
+}
+
+/// Runs the kernel over whole vectors, and the tail as a vector padded with zeros.
+template <typename V>
+void SumArrays(PertSeries const &series, PertBatch const &batch) {
+  std::size_t constexpr N = kLanes<V>;
+  auto const n = static_cast<std::size_t>(batch.T.size());
+  double const *in[] = {batch.T.data(), batch.CM.data(), batch.SM.data(), batch.Cm.data(), batch.Sm.data()};
+  double *out[] = {batch.dl.data(), batch.dr.data(), batch.db.data()};
+
+  auto const run = [&series](double const *const *args, double *const *sums) {
+    V dl = Load<V>(sums[0]), dr = Load<V>(sums[1]), db = Load<V>(sums[2]);
+    SumKernel(series, Load<V>(args[0]), Load<V>(args[1]), Load<V>(args[2]), Load<V>(args[3]), Load<V>(args[4]),
+              dl, dr, db);
+    Store(sums[0], dl);
+    Store(sums[1], dr);
+    Store(sums[2], db);
+  };
+
+  std::size_t i = 0;
+  for (; i + N <= n; i += N) {
+    double const *args[] = {in[0] + i, in[1] + i, in[2] + i, in[3] + i, in[4] + i};
+    double *sums[] = {out[0] + i, out[1] + i, out[2] + i};
+    run(args, sums);
+  }
+  if (i < n) {
+    double tail[8][N] = {};
+    for (int a = 0; a < 5; ++a)
+      std::copy(in[a] + i, in[a] + n, tail[a]);
+    for (int a = 0; a < 3; ++a)
+      std::copy(out[a] + i, out[a] + n, tail[5 + a]);
+    double const *args[] = {tail[0], tail[1], tail[2], tail[3], tail[4]};
+    double *sums[] = {tail[5], tail[6], tail[7]};
+    run(args, sums);
+    for (int a = 0; a < 3; ++a)
+      std::copy(tail[5 + a], tail[5 + a] + (n - i), out[a] + i);
+  }
+}
+
+#if defined(__SSE2__)
+__attribute__((target("avx2,fma"), flatten))
+void SumArraysAvx2(PertSeries const &series, PertBatch const &batch) {
+  SumArrays<Double4>(series, batch);
+}
+#endif
+
+}
+
+void AddPerturbations(PertSeries const &series, PertBatch const &batch) {
+#if defined(__SSE2__)
+  switch (simd::ActiveIsa()) {
+    case simd::Isa::AVX2:
+      SumArraysAvx2(series, batch);
+      return;
+    case simd::Isa::SSE2:
+      SumArrays<Double2>(series, batch);
+      return;
+    case simd::Isa::Scalar:
+      break;
+  }
+#endif
+  SumArrays<double>(series, batch);
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+
+#include <gsl.h>
+
+namespace the {
+
+// Trigonometric series of perturbations of planetary theories.
+//
+// A series sums up the perturbations of a body by another one as terms of
+// multiples of the mean anomalies M of the perturbed body and m of the
+// perturbing one, and of powers of time:
+//
+//   T^iT * (dlc cos(I M + i m) + dls sin(I M + i m))
+//
+// in longitude, and alike in radius and latitude. Series are tables of
+// constant terms, and are summed up over arrays of epochs at once, an epoch
+// a lane of SIMD registers, with cosines and sines of the multiples
+// computed by the sine law from those of M and m.
+
+/// A term of a series. Terms of a power iT > 0 follow the term of the same
+/// multiples of the power 0, whose cosine and sine they take multiplied by T.
+struct PertTerm {
+  int    I, i, iT;
+  /// Coefficients of cosine and sine in longitude ["], radius [1e-6 AU] and latitude ["].
+  double dlc, dls, drc, drs, dbc, dbs;
+};
+
+/// Multiples of the mean anomalies a series can take at most either way.
+int constexpr kPertMaxMultiple = 10;
+
+/// Terms of a series, with the ranges of multiples of M and m they take.
+struct PertSeries {
+  int             IMin, IMax;
+  int             iMin, iMax;
+  PertTerm const *Terms;
+  std::size_t     Size;
+};
+
+/// Tells whether the terms stay in the ranges, for static_assert.
+constexpr bool Valid(PertSeries const &series) {
+  if (series.IMin < -kPertMaxMultiple || series.IMax > kPertMaxMultiple ||
+      series.iMin < -kPertMaxMultiple || series.iMax > kPertMaxMultiple)
+    return false;
+  for (std::size_t k = 0; k < series.Size; ++k) {
+    auto const &term = series.Terms[k];
+    if (term.I < series.IMin || term.I > series.IMax || term.i < series.iMin || term.i > series.iMax)
+      return false;
+    if (term.iT < 0)
+      return false;
+    if (term.iT > 0) {
+      if (k == 0)
+        return false;
+      auto const &last = series.Terms[k - 1];
+      if (last.I != term.I || last.i != term.i || last.iT != term.iT - 1)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Epochs and their sums of perturbations, arrays of the same size.
+struct PertBatch {
+  /// Time in Julian centuries since J2000.
+  gsl::span<double const> T;
+  /// Cosines and sines of the mean anomalies of the perturbed body, M, and of the perturbing one, m.
+  gsl::span<double const> CM, SM;
+  gsl::span<double const> Cm, Sm;
+  /// Sums the series are added to, in the units of the coefficients.
+  gsl::span<double>       dl, dr, db;
+};
+
+/// Sums the series up at every epoch of the batch and adds the sums.
+void AddPerturbations(PertSeries const &series, PertBatch const &batch);
+
+}
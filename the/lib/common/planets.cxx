@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "consts.hxx"
+#include "frames.hxx"
+#include "mat.hxx"
+#include "planets.hxx"
+#include "simdmath.hxx"
+#include "sun.hxx"
+
+namespace the {
+
+namespace {
+
+/// Mean elements at J2000 and their rates per Julian century, of the ecliptic
+/// and equinox of J2000: semi-major axis [AU], eccentricity, inclination,
+/// mean longitude, longitude of perihelion and that of the ascending node [deg].
+struct Elements {
+  double a, e, I, L, varpi, Omega;
+  double da, de, dI, dL, dvarpi, dOmega;
+};
+
+Elements constexpr kElements[kPlanets] = {
+  { 0.38709927, 0.20563593,  7.00497902, 252.25032350,  77.45779628,  48.33076593,
+    0.00000037, 0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081},
+  { 0.72333566, 0.00677672,  3.39467605, 181.97909950, 131.60246718,  76.67984255,
+    0.00000390,-0.00004107, -0.00078890,  58517.81538729, 0.00268329, -0.27769418},
+  { 1.52371034, 0.09339410,  1.84969142,  -4.55343205, -23.94362959,  49.55953891,
+    0.00001847, 0.00007882, -0.00813131,  19140.30268499, 0.44441088, -0.29257343},
+  { 5.20288700, 0.04838624,  1.30439695,  34.39644051,  14.72847983, 100.47390909,
+   -0.00011607,-0.00013253, -0.00183714,   3034.74612775, 0.21252668,  0.20469106},
+  { 9.53667594, 0.05386179,  2.48599187,  49.95424423,  92.59887831, 113.66242448,
+   -0.00125060,-0.00050991,  0.00193609,   1222.49362201,-0.41897216, -0.28867794},
+  {19.18916464, 0.04725744,  0.77263783, 313.23810451, 170.95427630,  74.01692503,
+   -0.00196176,-0.00004397, -0.00242939,    428.48202785, 0.40805281,  0.04240589},
+  {30.06992276, 0.00859048,  1.77004347, -55.12002969,  44.96476227, 131.78422574,
+    0.00026291, 0.00005105,  0.00035372,    218.45945325,-0.32241464, -0.00508664},
+  {39.48211675, 0.24882730, 17.14001206, 238.92903833, 224.06891629, 110.30393684,
+   -0.00031596, 0.00005170,  0.00004818,    145.20780515,-0.04062942, -0.01183482},
+};
+
+/// Newton's iterations of Kepler's equation from E = M + e sin M (1 + e cos M),
+/// off by 0.008 at most, which take eccentricities up to Pluto's to an ulp.
+int constexpr kKeplerIterations = 3;
+
+/// Epochs computed at a time, so that the arrays of a batch stay in the cache.
+std::ptrdiff_t constexpr kBatch = 32;
+/// Values of a batch, of every planet and epoch.
+std::ptrdiff_t constexpr kLanes = static_cast<std::ptrdiff_t>(kPlanets) * kBatch;
+
+/// Returns the angle in degrees less whole turns, as an integer conversion
+/// does it rather than a call of libm.
+double ReduceDegrees(double const angle) {
+  return angle - 360.0 * double(static_cast<std::int64_t>(angle / 360.0));
+}
+
+/// Computes the planets at n <= kBatch epochs T into those of the arrays of
+/// positions of stride epochs a planet.
+void PlanetsBatch(double const *T, std::ptrdiff_t const n, Vec3 const *sun,
+                  std::ptrdiff_t const stride, Vec3 *heliocentric, Vec3 *geocentric) {
+  auto const m = static_cast<std::ptrdiff_t>(kPlanets) * n;
+  double a[kLanes], ecc[kLanes], E[kLanes], sinE[kLanes], cosE[kLanes];
+  // Rows of arguments of perihelion, nodes, inclinations and mean anomalies
+  // follow one another, so that they take one call of SinCos, as M does of
+  // sun.cxx.
+  double angles[4 * kLanes], sines[4 * kLanes], cosines[4 * kLanes];
+  double *const M = angles + 3 * m;
+
+  for (std::size_t p = 0; p < kPlanets; ++p) {
+    auto const &el = kElements[p];
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+      auto const j = static_cast<std::ptrdiff_t>(p) * n + i;
+      double const t = T[i];
+      double const varpi = el.varpi + el.dvarpi * t;
+      double const Omega = el.Omega + el.dOmega * t;
+      a[j]   = el.a + el.da * t;
+      ecc[j] = el.e + el.de * t;
+      angles[j]         = (varpi - Omega) * kRad;
+      angles[m + j]     = Omega * kRad;
+      angles[2 * m + j] = (el.I + el.dI * t) * kRad;
+      M[j]              = ReduceDegrees(el.L + el.dL * t - varpi) * kRad;
+    }
+  }
+  simd::SinCos(gsl::span<double const>(angles, 4 * m), {sines, 4 * m}, {cosines, 4 * m});
+
+  // Kepler's equation M = E - e sin E of every planet and epoch at once.
+  // Sines and cosines of E are those of the first guess turned by the steps
+  // of Newton's iterations, which are small enough for a few terms of Taylor
+  // series to take them to an ulp.
+  for (std::ptrdiff_t j = 0; j < m; ++j)
+    E[j] = M[j] + ecc[j] * sines[3 * m + j] * (1.0 + ecc[j] * cosines[3 * m + j]);
+  simd::SinCos(gsl::span<double const>(E, m), {sinE, m}, {cosE, m});
+  for (int k = 0; k < kKeplerIterations; ++k) {
+    for (std::ptrdiff_t j = 0; j < m; ++j) {
+      double const d = -(E[j] - ecc[j] * sinE[j] - M[j]) / (1.0 - ecc[j] * cosE[j]);
+      double const d2 = d * d;
+      double const sinD = d * (1.0 - d2 / 6.0 * (1.0 - d2 / 20.0 * (1.0 - d2 / 42.0)));
+      double const cosD = 1.0 - d2 / 2.0 * (1.0 - d2 / 12.0 * (1.0 - d2 / 30.0 * (1.0 - d2 / 56.0)));
+      double const s = sinE[j], c = cosE[j];
+      E[j] += d;
+      sinE[j] = s * cosD + c * sinD;
+      cosE[j] = c * cosD - s * sinD;
+    }
+  }
+
+  // Once an epoch for all of the planets.
+  Mat3 precession[kBatch];
+  FrameCache::Shared().At(Frame::PrecEcl, {T, n}, {precession, n});
+  for (std::ptrdiff_t i = 0; i < n; ++i) {
+    for (std::size_t p = 0; p < kPlanets; ++p) {
+      auto const j = static_cast<std::ptrdiff_t>(p) * n + i;
+      // In the plane of the orbit, x towards the perihelion.
+      double const x = a[j] * (cosE[j] - ecc[j]);
+      double const y = a[j] * std::sqrt(1.0 - ecc[j] * ecc[j]) * sinE[j];
+      double const sw = sines[j],         cw = cosines[j];
+      double const sO = sines[m + j],     cO = cosines[m + j];
+      double const sI = sines[2 * m + j], cI = cosines[2 * m + j];
+      Vec3 const j2000{
+        (cw * cO - sw * sO * cI) * x - (sw * cO + cw * sO * cI) * y,
+        (cw * sO + sw * cO * cI) * x - (sw * sO - cw * cO * cI) * y,
+        sw * sI * x + cw * sI * y,
+      };
+      auto const k = static_cast<std::ptrdiff_t>(p) * stride + i;
+      heliocentric[k] = precession[i] * j2000;
+      geocentric[k] = heliocentric[k] + sun[i];
+    }
+  }
+}
+
+}
+
+void EphemerisFrame::Update(gsl::span<double const> T) {
+  sun_.resize(static_cast<std::size_t>(T.size()));
+  SunPos(T, {sun_.data(), T.size()});
+  UpdatePlanets(T);
+}
+
+void EphemerisFrame::Update(gsl::span<double const> T, gsl::span<Vec3 const> sun) {
+  Expects(sun.size() == T.size());
+  sun_.assign(sun.begin(), sun.end());
+  UpdatePlanets(T);
+}
+
+void EphemerisFrame::UpdatePlanets(gsl::span<double const> T) {
+  auto const n = T.size();
+  heliocentric_.resize(kPlanets * static_cast<std::size_t>(n));
+  geocentric_.resize(kPlanets * static_cast<std::size_t>(n));
+  for (std::ptrdiff_t i = 0; i < n; i += kBatch)
+    PlanetsBatch(T.data() + i, std::min(kBatch, n - i), sun_.data() + i, n,
+                 heliocentric_.data() + i, geocentric_.data() + i);
+}
+
+}
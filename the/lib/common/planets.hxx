@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <gsl.h>
+
+#include "vec.hxx"
+
+namespace the {
+
+// Positions of the planets.
+//
+// Orbits are Keplerian ones of the mean elements of E. M. Standish,
+// "Keplerian Elements for Approximate Positions of the Major Planets",
+// fitted to JPL DE405 over 1800-2050, within a few arcminutes of it and 10'
+// of Saturn at worst. Positions are geometric, with no light-time.
+//
+// An EphemerisFrame computes the sun and every planet at epochs at once. The
+// orbits are a model of their own rather than a part of the sun's series: mean
+// anomalies are those of the elements above, not the M2-M6 sun.cxx derives for
+// its perturbations, which stray from them by up to 0.4 degrees. What a frame
+// shares is what depends on the epoch alone: the precession of the J2000
+// elements to the equinox of date, taken from the shared FrameCache, and the
+// position of the Earth, which the sun's series gives. Kepler's equation is
+// solved for every planet and epoch in the same SIMD lanes. The sun and the
+// eight cost two to two and a half times the sun alone a frame at a time and
+// five times it in batches, as //the/bench:ephemeris measures.
+
+enum class Planet {
+  Mercury,
+  Venus,
+  Mars,
+  Jupiter,
+  Saturn,
+  Uranus,
+  Neptune,
+  Pluto,
+};
+
+std::size_t constexpr kPlanets = 8;
+
+struct EphemerisFrame final {
+  /// Computes the sun and the planets at epochs T, in Julian centuries since
+  /// J2000. Buffers are reused by later updates of as many epochs or fewer.
+  void Update(gsl::span<double const> T);
+  /// Same as above, with positions of the sun at T given, as SunPos gives them.
+  void Update(gsl::span<double const> T, gsl::span<Vec3 const> sun);
+
+  /// Number of epochs of the frame.
+  std::ptrdiff_t Size() const { return static_cast<std::ptrdiff_t>(sun_.size()); }
+
+  /// Geocentric positions of the sun [AU], of the ecliptic and equinox of date.
+  gsl::span<Vec3 const> Sun() const {
+    return {sun_.data(), Size()};
+  }
+  /// Heliocentric positions of the planet [AU], of the ecliptic and equinox of date.
+  gsl::span<Vec3 const> Heliocentric(Planet const planet) const {
+    return {heliocentric_.data() + static_cast<std::ptrdiff_t>(planet) * Size(), Size()};
+  }
+  /// Geocentric positions of the planet [AU], of the ecliptic and equinox of date.
+  gsl::span<Vec3 const> Geocentric(Planet const planet) const {
+    return {geocentric_.data() + static_cast<std::ptrdiff_t>(planet) * Size(), Size()};
+  }
+
+ private:
+  void UpdatePlanets(gsl::span<double const> T);
+
+  std::vector<Vec3> sun_;
+  /// Positions of the planets, those of a planet at every epoch in a row.
+  std::vector<Vec3> heliocentric_;
+  std::vector<Vec3> geocentric_;
+};
+
+}
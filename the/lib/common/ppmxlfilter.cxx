@@ -0,0 +1,129 @@
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+#include "ppmxlfilter.hxx"
+
+namespace the {
+
+namespace {
+
+std::uint32_t Bit(PPMXLColumn const column) {
+  return std::uint32_t{1} << static_cast<unsigned>(column);
+}
+
+template <typename T>
+bool ParseNumber(char const *begin, char const *end, T &value) {
+  auto const rv = std::from_chars(begin, end, value);
+  return rv.ec == std::errc{} && rv.ptr == end;
+}
+
+/// Returns a finite bound of Ipix as an integer, saturated to its range.
+std::uint64_t IpixBound(double const bound) {
+  if (bound <= 0.0)
+    return 0;
+  if (bound >= 18446744073709551615.0)
+    return std::numeric_limits<std::uint64_t>::max();
+  return static_cast<std::uint64_t>(bound);
+}
+
+}
+
+PPMXLFilter & PPMXLFilter::Range(PPMXLColumn const column, double const min, double const max) {
+  if (column == PPMXLColumn::Ipix) {
+    // NaN, which no conversion takes, passes no row, as it does of other columns.
+    if (std::isnan(min) || std::isnan(max))
+      return Ipix(std::numeric_limits<std::uint64_t>::max(), 0);
+    return Ipix(IpixBound(min), IpixBound(max));
+  }
+  auto &bounds = bounds_[static_cast<std::size_t>(column)];
+  bounds.Min = min;
+  bounds.Max = max;
+  columns_ |= Bit(column);
+  return *this;
+}
+
+PPMXLFilter & PPMXLFilter::Ipix(std::uint64_t const min, std::uint64_t const max) {
+  ipixMin_ = min;
+  ipixMax_ = max;
+  columns_ |= Bit(PPMXLColumn::Ipix);
+  return *this;
+}
+
+bool PPMXLFilter::AcceptsValue(PPMXLColumn const column, double const value) const {
+  auto const &bounds = bounds_[static_cast<std::size_t>(column)];
+  if (column == PPMXLColumn::RaJ2000 && bounds.Min > bounds.Max)
+    return value >= bounds.Min || value <= bounds.Max;
+  // NaN fails both comparisons.
+  return value >= bounds.Min && value <= bounds.Max;
+}
+
+bool PPMXLFilter::AcceptsField(PPMXLColumn const column, char const *begin, char const *end) const {
+  if (column == PPMXLColumn::Ipix) {
+    std::uint64_t ipix;
+    return ParseNumber(begin, end, ipix) && ipix >= ipixMin_ && ipix <= ipixMax_;
+  }
+  double value;
+  return ParseNumber(begin, end, value) && AcceptsValue(column, value);
+}
+
+bool PPMXLFilter::Accepts(PPMXLReader::Row const &row) const {
+  for (auto columns = columns_; columns; columns &= columns - 1) {
+    auto const column = static_cast<PPMXLColumn>(__builtin_ctz(columns));
+    if (column == PPMXLColumn::Ipix) {
+      if (row.Ipix < ipixMin_ || row.Ipix > ipixMax_)
+        return false;
+    } else if (!AcceptsValue(column, row.Value(column))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Fallible<PPMXLFilter> PPMXLFilter::Parse(std::string const &spec) {
+  PPMXLFilter filter;
+  std::size_t pos = 0;
+  while (pos < spec.size()) {
+    auto const end = std::min(spec.find(',', pos), spec.size());
+    auto const item = spec.substr(pos, end - pos);
+    pos = end + 1;
+
+    auto const colon1 = item.find(':');
+    auto const colon2 = colon1 == std::string::npos ? colon1 : item.find(':', colon1 + 1);
+    if (colon2 == std::string::npos)
+      return {RuntimeError{"filter " + item + " is not COLUMN:MIN:MAX"}};
+
+    auto const name = item.substr(0, colon1);
+    std::size_t index = 0;
+    while (index < kPPMXLColumns && name != PPMXLColumnName(static_cast<PPMXLColumn>(index)))
+      ++index;
+    if (index == kPPMXLColumns)
+      return {RuntimeError{"unknown column " + name}};
+    auto const column = static_cast<PPMXLColumn>(index);
+    if (column == PPMXLColumn::MagSurveys || column == PPMXLColumn::Flags)
+      return {RuntimeError{"column " + name + " is not numeric"}};
+
+    auto const *first  = item.data() + colon1 + 1;
+    auto const *middle = item.data() + colon2;
+    auto const *last   = item.data() + item.size();
+
+    if (column == PPMXLColumn::Ipix) {
+      std::uint64_t min = 0, max = std::numeric_limits<std::uint64_t>::max();
+      if ((first != middle && !ParseNumber(first, middle, min)) ||
+          (middle + 1 != last && !ParseNumber(middle + 1, last, max)))
+        return {RuntimeError{"bad bounds in filter " + item}};
+      filter.Ipix(min, max);
+    } else {
+      double min = -std::numeric_limits<double>::infinity();
+      double max = std::numeric_limits<double>::infinity();
+      if ((first != middle && !ParseNumber(first, middle, min)) ||
+          (middle + 1 != last && !ParseNumber(middle + 1, last, max)) ||
+          std::isnan(min) || std::isnan(max))
+        return {RuntimeError{"bad bounds in filter " + item}};
+      filter.Range(column, min, max);
+    }
+  }
+  return {filter};
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "errors.hxx"
+#include "ppmxlreader.hxx"
+
+namespace the {
+
+/// Conjunction of range predicates on PPMXL columns.
+/// PPMXLParser evaluates it on the raw text of a row before converting
+/// anything else, so rejected rows cost a delimiter scan up to the first
+/// failing column. Ranges are inclusive. Missing values ("None") never pass.
+struct PPMXLFilter {
+  /// Keeps rows with min <= column <= max, replacing a range set on the column before.
+  /// A range on RaJ2000 with min > max wraps through 0 degrees.
+  /// Ipix is compared as a double; use Ipix() for exact bounds.
+  PPMXLFilter & Range(PPMXLColumn column, double min, double max);
+
+  /// Keeps rows with the magnitude in the band between the bright and the faint limit.
+  PPMXLFilter & Magnitude(PPMXLColumn const band, double const brightest, double const faintest) {
+    return Range(band, brightest, faintest);
+  }
+
+  /// Keeps rows within a box of equatorial coordinates in degrees.
+  /// raMin > raMax selects a box crossing 0h.
+  PPMXLFilter & Box(double const raMin, double const raMax, double const decMin, double const decMax) {
+    return Range(PPMXLColumn::RaJ2000, raMin, raMax).Range(PPMXLColumn::DecJ2000, decMin, decMax);
+  }
+
+  /// Keeps rows with min <= Ipix <= max.
+  PPMXLFilter & Ipix(std::uint64_t min, std::uint64_t max);
+
+  /// Columns the predicates look at, one bit per PPMXLColumn.
+  std::uint32_t Columns() const { return columns_; }
+  bool Empty() const { return columns_ == 0; }
+
+  /// Tests a field given as text.
+  bool AcceptsField(PPMXLColumn column, char const *begin, char const *end) const;
+
+  /// Tests a row parsed already. Only the columns of the filter have to be set.
+  bool Accepts(PPMXLReader::Row const &row) const;
+
+  /// Parses a comma-separated list of predicates COLUMN:MIN:MAX, e.g.
+  /// "Jmag:0:2.5,DecJ2000:-90:0". An empty bound is open: "Jmag::6".
+  static Fallible<PPMXLFilter> Parse(std::string const &spec);
+
+ private:
+  bool AcceptsValue(PPMXLColumn column, double value) const;
+
+  struct Bounds {
+    double Min = -std::numeric_limits<double>::infinity();
+    double Max = std::numeric_limits<double>::infinity();
+  };
+
+  std::uint32_t columns_ = 0;
+  std::array<Bounds, kPPMXLColumns> bounds_;
+  std::uint64_t ipixMin_ = 0;
+  std::uint64_t ipixMax_ = std::numeric_limits<std::uint64_t>::max();
+};
+
+}
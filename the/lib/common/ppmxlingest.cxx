@@ -0,0 +1,38 @@
+#include <iomanip>
+
+#include "ppmxlingest.hxx"
+
+namespace the {
+
+namespace {
+
+double MegabytesPerSecond(std::uint64_t const bytes, std::uint64_t const nanos) {
+  return nanos ? double(bytes) * 1e3 / double(nanos) : 0.0;
+}
+
+}
+
+std::ostream & operator << (std::ostream &os, PPMXLIngestStats const &stats) {
+  auto const input  = stats.InputBytes.load();
+  auto const text   = stats.TextBytes.load();
+  auto const read   = stats.ReadNanos.load();
+  auto const parse  = stats.ParseNanos.load();
+  auto const wall   = stats.WallNanos.load();
+  auto const threads = std::max(1u, stats.Threads.load());
+
+  auto const flags = os.flags();
+  auto const precision = os.precision();
+  os << std::fixed << std::setprecision(1)
+     << "read " << double(input) / 1e6 << " MB at " << MegabytesPerSecond(input, read) << " MB/s"
+     << " (" << double(text) / 1e6 << " MB of text at " << MegabytesPerSecond(text, read) << " MB/s)"
+     << ", parsed " << stats.ParsedRows.load() << " rows at "
+     << MegabytesPerSecond(text, parse / threads) << " MB/s on " << threads << " threads"
+     << ", sink " << double(stats.SinkNanos.load()) / 1e6 << " ms"
+     << ", reader stalled " << double(stats.StallNanos.load()) / 1e6 << " ms"
+     << ", total " << double(wall) / 1e6 << " ms at " << MegabytesPerSecond(text, wall) << " MB/s";
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gsl.h>
+
+#include "errors.hxx"
+#include "gzip.hxx"
+#include "ppmxlparser.hxx"
+#include "ppmxlreader.hxx"
+
+namespace the {
+
+/// Default size of a piece of text parsed by one worker at once.
+std::size_t constexpr kPPMXLChunkSize = 8 << 20;
+
+/// Piece of PPMXL text made of whole lines (the last line of the input may lack its newline).
+struct PPMXLChunk {
+  char const *begin = nullptr;
+  char const *end   = nullptr;
+  /// Backs [begin, end) unless the chunk points into memory owned by someone else.
+  std::vector<char> storage;
+};
+
+/// Counters of an ingest pipeline, updated while it runs.
+/// Times of parsing are summed over all worker threads.
+struct PPMXLIngestStats {
+  /// Bytes taken from the underlying source: compressed bytes for gzip input.
+  std::atomic<std::uint64_t> InputBytes{0};
+  /// Bytes of PPMXL text handed to the parsers.
+  std::atomic<std::uint64_t> TextBytes{0};
+  /// Time spent reading (and inflating) the input.
+  std::atomic<std::uint64_t> ReadNanos{0};
+  /// Time the reader waited for the parsers to free a chunk.
+  std::atomic<std::uint64_t> StallNanos{0};
+  /// Time spent parsing, summed over threads.
+  std::atomic<std::uint64_t> ParseNanos{0};
+  /// Rows parsed, including the ones dropped after the limit was reached.
+  std::atomic<std::uint64_t> ParsedRows{0};
+  /// Time spent in the sink.
+  std::atomic<std::uint64_t> SinkNanos{0};
+  /// Wall time of the whole pipeline.
+  std::atomic<std::uint64_t> WallNanos{0};
+  /// Number of parsing threads.
+  std::atomic<unsigned> Threads{0};
+};
+
+/// Prints throughput of every stage of the pipeline.
+std::ostream & operator << (std::ostream &os, PPMXLIngestStats const &stats);
+
+namespace details {
+
+/// Measures a scope and adds elapsed nanoseconds to a counter, if there is one.
+struct IngestTimer final {
+  explicit IngestTimer(std::atomic<std::uint64_t> *counter)
+      : counter_{counter}
+  {
+    if (counter_)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  IngestTimer(IngestTimer const &) = delete;
+
+  ~IngestTimer() {
+    if (counter_) {
+      auto const elapsed = std::chrono::steady_clock::now() - start_;
+      counter_->fetch_add(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+          std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::atomic<std::uint64_t> *counter_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+inline
+std::atomic<std::uint64_t> * IngestCounter(PPMXLIngestStats *stats,
+                                           std::atomic<std::uint64_t> PPMXLIngestStats::*counter) {
+  return stats ? &(stats->*counter) : nullptr;
+}
+
+inline
+unsigned IngestThreads(unsigned const threads) {
+  return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline
+void ParseChunk(PPMXLParser const &parser, PPMXLChunk const &chunk,
+                std::vector<PPMXLReader::Row> &rows) {
+  auto const *rest = parser.Parse(chunk.begin, chunk.end, [&rows](PPMXLReader::Row const &row) {
+    rows.push_back(row);
+    return true;
+  });
+  if (rest != chunk.end) {
+    PPMXLReader::Row row;
+    if (parser.ParseRow(rest, chunk.end, row))
+      rows.push_back(row);
+  }
+}
+
+/// Parses chunks produced by source(chunk) on several worker threads and
+/// passes the rows to sink(row) on the calling thread in the order of chunks.
+/// At most 2 * threads chunks are held in memory at once. Storage of parsed
+/// chunks and vectors of delivered rows are handed back for reuse, so a long
+/// stream runs in a fixed amount of memory: source finds chunk.storage with
+/// the capacity of a previous chunk.
+/// @param limit Maximum number of rows passed to the sink, 0 for no limit.
+/// @param stats Counters to update, may be null.
+/// @return Number of rows passed to the sink.
+template <typename Source, typename Sink>
+std::size_t IngestChunks(PPMXLParser const &parser, unsigned threads, std::size_t const limit,
+                         Source &&source, Sink &&sink, PPMXLIngestStats *stats = nullptr) {
+  using Rows = std::vector<PPMXLReader::Row>;
+
+  struct Job {
+    std::size_t seq;
+    PPMXLChunk  chunk;
+  };
+
+  IngestTimer wall{IngestCounter(stats, &PPMXLIngestStats::WallNanos)};
+
+  threads = IngestThreads(threads);
+  std::size_t const maxInFlight = 2 * std::size_t{threads};
+  if (stats)
+    stats->Threads = threads;
+
+  std::mutex mutex;
+  std::condition_variable jobsCv, resultsCv, slotsCv;
+  std::deque<Job> jobs;
+  std::map<std::size_t, Rows> results;
+  std::vector<std::vector<char>> spareStorage;
+  std::vector<Rows> spareRows;
+  std::size_t produced = 0;
+  std::size_t inFlight = 0;
+  bool sourceDone = false;
+  bool stop = false;
+
+  std::thread producer([&] {
+    for (;;) {
+      PPMXLChunk chunk;
+      {
+        IngestTimer stall{IngestCounter(stats, &PPMXLIngestStats::StallNanos)};
+        std::unique_lock<std::mutex> lock(mutex);
+        slotsCv.wait(lock, [&] { return stop || inFlight < maxInFlight; });
+        if (stop)
+          break;
+        if (!spareStorage.empty()) {
+          chunk.storage = std::move(spareStorage.back());
+          spareStorage.pop_back();
+          chunk.storage.clear();
+        }
+      }
+      {
+        IngestTimer read{IngestCounter(stats, &PPMXLIngestStats::ReadNanos)};
+        if (!source(chunk))
+          break;
+      }
+      if (stats)
+        stats->TextBytes += static_cast<std::uint64_t>(chunk.end - chunk.begin);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({produced++, std::move(chunk)});
+        ++inFlight;
+      }
+      jobsCv.notify_one();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sourceDone = true;
+    }
+    jobsCv.notify_all();
+    resultsCv.notify_all();
+  });
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      for (;;) {
+        Job job;
+        Rows rows;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          jobsCv.wait(lock, [&] { return stop || sourceDone || !jobs.empty(); });
+          if (stop || jobs.empty())
+            break;
+          job = std::move(jobs.front());
+          jobs.pop_front();
+          if (!spareRows.empty()) {
+            rows = std::move(spareRows.back());
+            spareRows.pop_back();
+          }
+        }
+        {
+          IngestTimer parse{IngestCounter(stats, &PPMXLIngestStats::ParseNanos)};
+          ParseChunk(parser, job.chunk, rows);
+        }
+        if (stats)
+          stats->ParsedRows += rows.size();
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          results.emplace(job.seq, std::move(rows));
+          if (job.chunk.storage.capacity() > 0)
+            spareStorage.push_back(std::move(job.chunk.storage));
+        }
+        resultsCv.notify_all();
+      }
+    });
+  }
+
+  std::size_t next = 0;
+  std::size_t emitted = 0;
+  for (;;) {
+    Rows rows;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      resultsCv.wait(lock, [&] { return results.count(next) || (sourceDone && next == produced); });
+      auto it = results.find(next);
+      if (it == results.end())
+        break;
+      rows = std::move(it->second);
+      results.erase(it);
+    }
+    ++next;
+
+    {
+      IngestTimer sinking{IngestCounter(stats, &PPMXLIngestStats::SinkNanos)};
+      for (auto const &row : rows) {
+        if (limit > 0 && emitted >= limit)
+          break;
+        sink(row);
+        ++emitted;
+      }
+    }
+
+    bool const reached = limit > 0 && emitted >= limit;
+    rows.clear();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      --inFlight;
+      stop = reached;
+      spareRows.push_back(std::move(rows));
+    }
+    slotsCv.notify_one();
+    if (reached) {
+      jobsCv.notify_all();
+      slotsCv.notify_all();
+      break;
+    }
+  }
+
+  producer.join();
+  for (auto &worker : workers)
+    worker.join();
+
+  return emitted;
+}
+
+/// Fills chunk.storage with whole lines taken by read(buffer, size), which
+/// returns the number of bytes stored or 0 at the end of input.
+/// A partial line at the end of a block is kept in carry for the next chunk.
+/// @return false when there is nothing left to parse.
+template <typename Read>
+bool FillChunk(PPMXLChunk &chunk, std::vector<char> &carry, std::size_t const blockSize, Read &&read) {
+  auto &storage = chunk.storage;
+  storage.assign(carry.begin(), carry.end());
+  carry.clear();
+
+  // Read until the block has at least one complete line, or the input ends.
+  for (;;) {
+    auto const have = storage.size();
+    storage.resize(have + blockSize);
+    auto const got = read(storage.data() + have, blockSize);
+    storage.resize(have + got);
+    if (got == 0)
+      break;
+
+    auto const *first = storage.data() + have;
+    auto const *last  = first + got;
+    while (last != first && last[-1] != '\n')
+      --last;
+    if (last != first) {
+      auto const *const end = storage.data() + storage.size();
+      carry.assign(last, end);
+      storage.resize(storage.size() - static_cast<std::size_t>(end - last));
+      break;
+    }
+  }
+
+  if (storage.empty())
+    return false;
+  chunk.begin = storage.data();
+  chunk.end   = storage.data() + storage.size();
+  return true;
+}
+
+}
+
+/// Splits a buffer of PPMXL text into newline-aligned chunks and parses them
+/// on several threads. Rows are passed to sink(row) on the calling thread
+/// in the same order they follow in the buffer.
+/// @param limit Maximum number of rows passed to the sink, 0 for no limit.
+/// @param threads Number of parsing threads, 0 to use every core.
+/// @param stats Counters to update, may be null.
+/// @return Number of rows passed to the sink.
+template <typename Sink>
+std::size_t IngestPPMXL(PPMXLParser const &parser, gsl::span<char const> const text,
+                        std::size_t const limit, unsigned const threads, Sink &&sink,
+                        std::size_t const chunkSize = kPPMXLChunkSize,
+                        PPMXLIngestStats *stats = nullptr) {
+  char const *pos = text.data();
+  char const *const end = text.data() + text.size();
+
+  return details::IngestChunks(parser, threads, limit, [&](PPMXLChunk &chunk) {
+      if (pos == end)
+        return false;
+      auto const *stop = pos + std::min<std::size_t>(chunkSize, static_cast<std::size_t>(end - pos));
+      if (stop != end) {
+        auto const *eol = static_cast<char const *>(
+            std::memchr(stop - 1, '\n', static_cast<std::size_t>(end - stop + 1)));
+        stop = eol ? eol + 1 : end;
+      }
+      chunk.begin = pos;
+      chunk.end   = stop;
+      if (stats)
+        stats->InputBytes += static_cast<std::uint64_t>(stop - pos);
+      pos = stop;
+      return true;
+    }, sink, stats);
+}
+
+template <typename Sink>
+std::size_t PPMXLReader::ReadParallel(PPMXLParser const &parser, unsigned const threads, Sink &&sink,
+                                      PPMXLIngestStats *stats) {
+  if (limit_ > 0 && pos_ >= limit_)
+    return 0;
+
+  std::vector<char> carry;
+  auto const rows = details::IngestChunks(parser, threads, limit_ > 0 ? limit_ - pos_ : 0,
+    [&](PPMXLChunk &chunk) {
+      return details::FillChunk(chunk, carry, kPPMXLChunkSize, [&](char *out, std::size_t const size) {
+          is_.read(out, static_cast<std::streamsize>(size));
+          auto const got = static_cast<std::size_t>(is_.gcount());
+          if (stats)
+            stats->InputBytes += got;
+          return got;
+        });
+    }, sink, stats);
+
+  pos_ += rows;
+  return rows;
+}
+
+template <typename Sink>
+Fallible<std::size_t> PPMXLReader::ReadGzip(PPMXLParser const &parser, unsigned const threads, Sink &&sink,
+                                            PPMXLIngestStats *stats) {
+  if (limit_ > 0 && pos_ >= limit_)
+    return {std::size_t{0}};
+
+  GzipReader gzip{is_};
+  std::optional<RuntimeError> failure;
+  std::vector<char> carry;
+
+  // Inflation runs on the reading thread, so it overlaps with parsing of earlier chunks.
+  auto const rows = details::IngestChunks(parser, threads, limit_ > 0 ? limit_ - pos_ : 0,
+    [&](PPMXLChunk &chunk) {
+      return details::FillChunk(chunk, carry, kPPMXLChunkSize, [&](char *out, std::size_t const size) {
+          auto const consumed = gzip.Consumed();
+          auto rv = gzip.Read(out, size);
+          if (stats)
+            stats->InputBytes += gzip.Consumed() - consumed;
+          if (!rv) {
+            std::ostringstream message;
+            message << rv.Err();
+            failure.emplace(message.str());
+            return std::size_t{0};
+          }
+          return *rv;
+        });
+    }, sink, stats);
+
+  pos_ += rows;
+  if (failure)
+    return {*failure};
+  return {rows};
+}
+
+}
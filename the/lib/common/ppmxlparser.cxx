@@ -0,0 +1,135 @@
+#include <charconv>
+#include <limits>
+
+#include "ppmxlparser.hxx"
+
+namespace the {
+
+namespace {
+
+using Row = PPMXLReader::Row;
+
+// Floating-point fields of a row by their column, or nullptr for the rest.
+double Row::* const kDoubleFields[kPPMXLColumns] = {
+  nullptr,
+  &Row::RaJ2000,
+  &Row::DecJ2000,
+  &Row::E_eaepRA,
+  &Row::E_deepDE,
+  &Row::PmRA,
+  &Row::PmDE,
+  &Row::E_pmRA,
+  &Row::E_pmDE,
+  nullptr,
+  &Row::EpochRA,
+  &Row::EpochDec,
+  &Row::Jmag,
+  &Row::E_Jmag,
+  &Row::Hmag,
+  &Row::E_Hmag,
+  &Row::Kmag,
+  &Row::E_Kmag,
+  &Row::B1mag,
+  &Row::B2mag,
+  &Row::R1mag,
+  &Row::R2mag,
+  &Row::Imag,
+  nullptr,
+  nullptr,
+  &Row::VickersPMRA,
+  &Row::VickersPMDE,
+};
+
+}
+
+void PPMXLParser::ParseField(unsigned const field, char const *begin, char const *end, Row &row) const {
+  if (auto const member = kDoubleFields[field]) {
+    double value;
+    // Unparsable fields, "None" in particular, are missing values.
+    if (std::from_chars(begin, end, value).ec != std::errc{})
+      value = std::numeric_limits<double>::quiet_NaN();
+    row.*member = value;
+    return;
+  }
+
+  switch (static_cast<PPMXLColumn>(field)) {
+    case PPMXLColumn::Ipix:
+      if (std::from_chars(begin, end, row.Ipix).ec != std::errc{})
+        row.Ipix = 0;
+      break;
+    case PPMXLColumn::NObs:
+      if (std::from_chars(begin, end, row.NObs).ec != std::errc{})
+        row.NObs = 0;
+      break;
+    case PPMXLColumn::MagSurveys:
+      // Short enough to stay within the small string buffer.
+      row.MagSurveys.assign(begin, end);
+      break;
+    case PPMXLColumn::Flags:
+      row.Flags.assign(begin, end);
+      break;
+    default:
+      break;
+  }
+}
+
+bool PPMXLParser::ParseFilteredRow(char const *begin, char const *end, Row &row) const {
+  char const *fieldBegins[kPPMXLColumns];
+  char const *fieldEnds[kPPMXLColumns];
+  auto const tested = filter_.Columns();
+
+  unsigned field = 0;
+  bool passed = true;
+  char const *fieldBegin = begin;
+  auto const visit = [&](char const *fieldEnd) {
+    if ((tested & (PPMXLColumns{1} << field)) &&
+        !filter_.AcceptsField(static_cast<PPMXLColumn>(field), fieldBegin, fieldEnd)) {
+      passed = false;
+      return false;
+    }
+    fieldBegins[field] = fieldBegin;
+    fieldEnds[field] = fieldEnd;
+    fieldBegin = fieldEnd + 1;
+    return ++field <= scanLast_;
+  };
+
+  details::ForEachByte<'|'>(begin, end, visit);
+  if (passed && field <= scanLast_)
+    visit(end);  // the last field is not followed by a delimiter
+  if (!passed || field <= scanLast_)
+    return false;
+
+  for (auto columns = columns_; columns; columns &= columns - 1) {
+    auto const f = static_cast<unsigned>(__builtin_ctz(columns));
+    ParseField(f, fieldBegins[f], fieldEnds[f], row);
+  }
+  return true;
+}
+
+bool PPMXLParser::ParseRow(char const *begin, char const *end, Row &row) const {
+  if (begin != end && end[-1] == '\r')
+    --end;
+
+  if (!filter_.Empty())
+    return ParseFilteredRow(begin, end, row);
+
+  unsigned field = 0;
+  char const *fieldBegin = begin;
+  details::ForEachByte<'|'>(begin, end, [&](char const *delim) {
+    if (columns_ & (PPMXLColumns{1} << field))
+      ParseField(field, fieldBegin, delim, row);
+    fieldBegin = delim + 1;
+    return ++field <= last_;
+  });
+
+  if (field <= last_) {
+    // The last field is not followed by a delimiter.
+    if (columns_ & (PPMXLColumns{1} << field))
+      ParseField(field, fieldBegin, end, row);
+    ++field;
+  }
+
+  return field > last_;
+}
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+# include <immintrin.h>
+#endif
+
+#include "ppmxlfilter.hxx"
+#include "ppmxlreader.hxx"
+
+namespace the {
+
+/// Set of PPMXL columns, one bit per PPMXLColumn.
+using PPMXLColumns = std::uint32_t;
+
+inline constexpr
+PPMXLColumns ColumnBit(PPMXLColumn const column) {
+  return PPMXLColumns{1} << static_cast<unsigned>(column);
+}
+
+PPMXLColumns constexpr kAllPPMXLColumns = (PPMXLColumns{1} << kPPMXLColumns) - 1;
+
+/// Columns PPMXLReader::Row::Fill has always filled in.
+PPMXLColumns constexpr kPositionPPMXLColumns =
+    ColumnBit(PPMXLColumn::Ipix) | ColumnBit(PPMXLColumn::RaJ2000) |
+    ColumnBit(PPMXLColumn::DecJ2000) | ColumnBit(PPMXLColumn::Jmag);
+
+namespace details {
+
+/// Calls fn(p) for every p in [begin, end) such that *p == c, until fn returns false.
+/// Returns false if the scan has been stopped by fn.
+template <char C, typename Fn>
+inline
+bool ForEachByte(char const *begin, char const *end, Fn &&fn) {
+  char const *p = begin;
+#if defined(__AVX2__)
+  __m256i const needle = _mm256_set1_epi8(C);
+  for (; end - p >= 32; p += 32) {
+    auto const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+    auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    for (; mask; mask &= mask - 1) {
+      if (!fn(p + __builtin_ctz(mask)))
+        return false;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i const needle16 = _mm_set1_epi8(C);
+  for (; end - p >= 16; p += 16) {
+    auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16)));
+    for (; mask; mask &= mask - 1) {
+      if (!fn(p + __builtin_ctz(mask)))
+        return false;
+    }
+  }
+#endif
+  while (p < end) {
+    p = static_cast<char const *>(std::memchr(p, C, static_cast<std::size_t>(end - p)));
+    if (!p)
+      break;
+    if (!fn(p))
+      return false;
+    ++p;
+  }
+  return true;
+}
+
+}
+
+/// Implements a parser of pipe-delimited PPMXL rows working on raw bytes.
+/// It neither allocates nor depends on the locale. Only requested columns are
+/// converted, and fields past the last requested one are not even scanned.
+/// Missing values ("None") yield NaN, unlike PPMXLReader::Row::Fill that
+/// sets Jmag to -1.0.
+/// With a filter, predicates are tested on the text of their fields as the
+/// row is scanned, and requested columns are converted only for rows passed.
+struct PPMXLParser {
+  explicit PPMXLParser(PPMXLColumns const columns = kAllPPMXLColumns, PPMXLFilter const &filter = {})
+      : columns_{columns & kAllPPMXLColumns}
+      , last_{columns_ ? 31u - static_cast<unsigned>(__builtin_clz(columns_)) : 0u}
+      , filter_{filter}
+      , scanLast_{std::max(last_, filter_.Empty() ? 0u : 31u - static_cast<unsigned>(__builtin_clz(filter_.Columns())))}
+  {}
+
+  PPMXLColumns Columns() const { return columns_; }
+  PPMXLFilter const & Filter() const { return filter_; }
+
+  /// Parses a row [begin, end) excluding the line terminator.
+  /// @return false if the row has fewer fields than requested or is rejected by the filter.
+  bool ParseRow(char const *begin, char const *end, PPMXLReader::Row &row) const;
+
+  /// Parses every complete line of [begin, end) and calls sink(row) for each
+  /// well-formed row passing the filter until the sink returns false.
+  /// @return Beginning of the first unparsed line, which is either
+  ///         the incomplete trailing line or the line after the one the sink has stopped at.
+  template <typename Sink>
+  char const * Parse(char const *begin, char const *end, Sink &&sink) const {
+    PPMXLReader::Row row;
+    while (begin < end) {
+      auto const *eol = static_cast<char const *>(
+          std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+      if (!eol)
+        break;
+      auto const *line = begin;
+      begin = eol + 1;
+      if (eol != line && ParseRow(line, eol, row) && !sink(static_cast<PPMXLReader::Row const &>(row)))
+        break;
+    }
+    return begin;
+  }
+
+ private:
+  void ParseField(unsigned field, char const *begin, char const *end, PPMXLReader::Row &row) const;
+  bool ParseFilteredRow(char const *begin, char const *end, PPMXLReader::Row &row) const;
+
+  PPMXLColumns columns_;
+  unsigned     last_;
+  PPMXLFilter  filter_;
+  /// Last field to look at, either requested or tested.
+  unsigned     scanLast_;
+};
+
+template <typename Sink>
+std::size_t PPMXLReader::Read(PPMXLParser const &parser, Sink &&sink) {
+  std::size_t constexpr kBlockSize = 1 << 20;
+
+  std::vector<char> buffer(kBlockSize);
+  std::size_t filled = 0;
+  std::size_t rows = 0;
+
+  auto const consume = [&](PPMXLReader::Row const &row) {
+    if (limit_ > 0 && pos_ >= limit_)
+      return false;
+    ++pos_;
+    ++rows;
+    sink(row);
+    return true;
+  };
+
+  while (limit_ == 0 || pos_ < limit_) {
+    if (filled == buffer.size())
+      buffer.resize(buffer.size() * 2);  // a line longer than the buffer
+
+    is_.read(buffer.data() + filled, static_cast<std::streamsize>(buffer.size() - filled));
+    auto const got = static_cast<std::size_t>(is_.gcount());
+    filled += got;
+
+    bool const last = got == 0;
+    if (last) {
+      if (filled == 0)
+        break;
+      // The last line is not terminated.
+      if (filled == buffer.size())
+        buffer.resize(buffer.size() + 1);
+      buffer[filled++] = '\n';
+    }
+
+    auto const *begin = buffer.data();
+    auto const *rest  = parser.Parse(begin, begin + filled, consume);
+    auto const used   = static_cast<std::size_t>(rest - begin);
+    std::memmove(buffer.data(), rest, filled - used);
+    filled -= used;
+
+    if (last)
+      break;
+  }
+
+  return rows;
+}
+
+}
@@ -0,0 +1,108 @@
+#include <cmath>
+#include <limits>
+
+#include "ppmxlreader.hxx"
+
+namespace the {
+
+char const * PPMXLColumnName(PPMXLColumn column) {
+  switch (column) {
+    case PPMXLColumn::Ipix:        return "Ipix";
+    case PPMXLColumn::RaJ2000:     return "RaJ2000";
+    case PPMXLColumn::DecJ2000:    return "DecJ2000";
+    case PPMXLColumn::E_eaepRA:    return "E_eaepRA";
+    case PPMXLColumn::E_deepDE:    return "E_deepDE";
+    case PPMXLColumn::PmRA:        return "PmRA";
+    case PPMXLColumn::PmDE:        return "PmDE";
+    case PPMXLColumn::E_pmRA:      return "E_pmRA";
+    case PPMXLColumn::E_pmDE:      return "E_pmDE";
+    case PPMXLColumn::NObs:        return "NObs";
+    case PPMXLColumn::EpochRA:     return "EpochRA";
+    case PPMXLColumn::EpochDec:    return "EpochDec";
+    case PPMXLColumn::Jmag:        return "Jmag";
+    case PPMXLColumn::E_Jmag:      return "E_Jmag";
+    case PPMXLColumn::Hmag:        return "Hmag";
+    case PPMXLColumn::E_Hmag:      return "E_Hmag";
+    case PPMXLColumn::Kmag:        return "Kmag";
+    case PPMXLColumn::E_Kmag:      return "E_Kmag";
+    case PPMXLColumn::B1mag:       return "B1mag";
+    case PPMXLColumn::B2mag:       return "B2mag";
+    case PPMXLColumn::R1mag:       return "R1mag";
+    case PPMXLColumn::R2mag:       return "R2mag";
+    case PPMXLColumn::Imag:        return "Imag";
+    case PPMXLColumn::MagSurveys:  return "MagSurveys";
+    case PPMXLColumn::Flags:       return "Flags";
+    case PPMXLColumn::VickersPMRA: return "VickersPMRA";
+    case PPMXLColumn::VickersPMDE: return "VickersPMDE";
+  }
+  return "Unknown";
+}
+
+double PPMXLReader::Row::Value(PPMXLColumn column) const {
+  switch (column) {
+    case PPMXLColumn::Ipix:        return static_cast<double>(Ipix);
+    case PPMXLColumn::RaJ2000:     return RaJ2000;
+    case PPMXLColumn::DecJ2000:    return DecJ2000;
+    case PPMXLColumn::E_eaepRA:    return E_eaepRA;
+    case PPMXLColumn::E_deepDE:    return E_deepDE;
+    case PPMXLColumn::PmRA:        return PmRA;
+    case PPMXLColumn::PmDE:        return PmDE;
+    case PPMXLColumn::E_pmRA:      return E_pmRA;
+    case PPMXLColumn::E_pmDE:      return E_pmDE;
+    case PPMXLColumn::NObs:        return NObs;
+    case PPMXLColumn::EpochRA:     return EpochRA;
+    case PPMXLColumn::EpochDec:    return EpochDec;
+    case PPMXLColumn::Jmag:        return Jmag;
+    case PPMXLColumn::E_Jmag:      return E_Jmag;
+    case PPMXLColumn::Hmag:        return Hmag;
+    case PPMXLColumn::E_Hmag:      return E_Hmag;
+    case PPMXLColumn::Kmag:        return Kmag;
+    case PPMXLColumn::E_Kmag:      return E_Kmag;
+    case PPMXLColumn::B1mag:       return B1mag;
+    case PPMXLColumn::B2mag:       return B2mag;
+    case PPMXLColumn::R1mag:       return R1mag;
+    case PPMXLColumn::R2mag:       return R2mag;
+    case PPMXLColumn::Imag:        return Imag;
+    case PPMXLColumn::VickersPMRA: return VickersPMRA;
+    case PPMXLColumn::VickersPMDE: return VickersPMDE;
+    case PPMXLColumn::MagSurveys:
+    case PPMXLColumn::Flags:
+      break;
+  }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+void PPMXLReader::Row::SetValue(PPMXLColumn column, double value) {
+  switch (column) {
+    case PPMXLColumn::Ipix:        Ipix        = static_cast<std::uint64_t>(value); break;
+    case PPMXLColumn::RaJ2000:     RaJ2000     = value; break;
+    case PPMXLColumn::DecJ2000:    DecJ2000    = value; break;
+    case PPMXLColumn::E_eaepRA:    E_eaepRA    = value; break;
+    case PPMXLColumn::E_deepDE:    E_deepDE    = value; break;
+    case PPMXLColumn::PmRA:        PmRA        = value; break;
+    case PPMXLColumn::PmDE:        PmDE        = value; break;
+    case PPMXLColumn::E_pmRA:      E_pmRA      = value; break;
+    case PPMXLColumn::E_pmDE:      E_pmDE      = value; break;
+    case PPMXLColumn::NObs:        NObs        = std::isnan(value) ? 0u : static_cast<unsigned>(value); break;
+    case PPMXLColumn::EpochRA:     EpochRA     = value; break;
+    case PPMXLColumn::EpochDec:    EpochDec    = value; break;
+    case PPMXLColumn::Jmag:        Jmag        = value; break;
+    case PPMXLColumn::E_Jmag:      E_Jmag      = value; break;
+    case PPMXLColumn::Hmag:        Hmag        = value; break;
+    case PPMXLColumn::E_Hmag:      E_Hmag      = value; break;
+    case PPMXLColumn::Kmag:        Kmag        = value; break;
+    case PPMXLColumn::E_Kmag:      E_Kmag      = value; break;
+    case PPMXLColumn::B1mag:       B1mag       = value; break;
+    case PPMXLColumn::B2mag:       B2mag       = value; break;
+    case PPMXLColumn::R1mag:       R1mag       = value; break;
+    case PPMXLColumn::R2mag:       R2mag       = value; break;
+    case PPMXLColumn::Imag:        Imag        = value; break;
+    case PPMXLColumn::VickersPMRA: VickersPMRA = value; break;
+    case PPMXLColumn::VickersPMDE: VickersPMDE = value; break;
+    case PPMXLColumn::MagSurveys:
+    case PPMXLColumn::Flags:
+      break;
+  }
+}
+
+}
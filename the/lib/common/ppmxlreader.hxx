@@ -1,10 +1,55 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <istream>
+#include <string>
+
+#include "errors.hxx"
 
 namespace the {
 
+/// Identifies a field of PPMXL catalogue by its position in a pipe-delimited row.
+enum class PPMXLColumn: std::uint16_t {
+  Ipix        =  0,
+  RaJ2000     =  1,
+  DecJ2000    =  2,
+  E_eaepRA    =  3,
+  E_deepDE    =  4,
+  PmRA        =  5,
+  PmDE        =  6,
+  E_pmRA      =  7,
+  E_pmDE      =  8,
+  NObs        =  9,
+  EpochRA     = 10,
+  EpochDec    = 11,
+  Jmag        = 12,
+  E_Jmag      = 13,
+  Hmag        = 14,
+  E_Hmag      = 15,
+  Kmag        = 16,
+  E_Kmag      = 17,
+  B1mag       = 18,
+  B2mag       = 19,
+  R1mag       = 20,
+  R2mag       = 21,
+  Imag        = 22,
+  MagSurveys  = 23,
+  Flags       = 24,
+  VickersPMRA = 25,
+  VickersPMDE = 26,
+};
+
+/// Number of fields in a row of PPMXL catalogue.
+std::size_t constexpr kPPMXLColumns = 27;
+
+/// Returns a name of the column as it is spelled in PPMXLReader::Row.
+char const * PPMXLColumnName(PPMXLColumn column);
+
+struct PPMXLParser;
+struct PPMXLIngestStats;
+
 /// Implements a reader of PPMXL catalogue.
 /// The catalogue contains 910468688 records.
 struct PPMXLReader {
@@ -104,6 +149,15 @@ struct PPMXLReader {
     /// Example: \a -1.0106e-07
     double VickersPMDE;
 
+    /// Returns a numeric field by its column identifier.
+    /// Ipix is returned as is converted to double, so it is not exact for large values.
+    /// MagSurveys and Flags are not numeric and yield NaN.
+    double Value(PPMXLColumn column) const;
+
+    /// Sets a numeric field by its column identifier.
+    /// MagSurveys and Flags are not numeric and are left intact.
+    void SetValue(PPMXLColumn column, double value);
+
     friend
     std::istream & operator >> (std::istream &is, Row &row) {
       char delim;
@@ -185,6 +239,31 @@ struct PPMXLReader {
     return is;
   }
 
+  /// Reads the rest of the stream by large blocks and parses rows in place
+  /// with the parser given, calling sink(row) for every row until the limit.
+  /// Defined in ppmxlparser.hxx.
+  /// @return Number of rows passed to the sink.
+  template <typename Sink>
+  std::size_t Read(PPMXLParser const &parser, Sink &&sink);
+
+  /// Same as Read but parses blocks of the stream on several threads.
+  /// Rows are still passed to the sink in the stream order, on the calling thread.
+  /// Defined in ppmxlingest.hxx.
+  /// @param threads Number of parsing threads, 0 to use every core.
+  /// @param stats Counters of the pipeline to update, may be null.
+  template <typename Sink>
+  std::size_t ReadParallel(PPMXLParser const &parser, unsigned threads, Sink &&sink,
+                           PPMXLIngestStats *stats = nullptr);
+
+  /// Same as ReadParallel but the stream is gzip-compressed. It is inflated
+  /// block by block while earlier blocks are being parsed, so the text
+  /// never lands on disk nor in memory at whole.
+  /// Defined in ppmxlingest.hxx.
+  /// @return Number of rows passed to the sink, or an error of the decompressor.
+  template <typename Sink>
+  Fallible<std::size_t> ReadGzip(PPMXLParser const &parser, unsigned threads, Sink &&sink,
+                                 PPMXLIngestStats *stats = nullptr);
+
   operator bool () const {
     if (limit_ > 0 && pos_ > limit_)
       return false;
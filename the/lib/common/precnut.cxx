@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "consts.hxx"
 #include "precnut.hxx"
 
@@ -27,4 +29,43 @@ Mat3 PrecMatrixEqu(double const T0, double const T1) {
   return Mat3::RotateZ(-z) * Mat3::RotateY(theta) * Mat3::RotateZ(-zeta);
 }
 
+namespace {
+
+/// Nutation in longitude and in obliquity [rad], and the mean obliquity.
+struct Nutation {
+  double dpsi, deps, eps;
+};
+
+Nutation NutationOf(double const T) {
+  // Mean anomaly of the sun, elongation of the moon, its argument of latitude
+  // and the longitude of its ascending node, in revolutions.
+  auto const angle = [](double const revolutions) {
+    return kPi2 * (revolutions - std::floor(revolutions));
+  };
+  double const ls = angle(0.993133 +   99.997306 * T);
+  double const D  = angle(0.827362 + 1236.853087 * T);
+  double const F  = angle(0.259089 + 1342.227826 * T);
+  double const N  = angle(0.347346 -    5.372447 * T);
+  return {
+    (-17.200 * std::sin(N) - 1.319 * std::sin(2.0 * (F - D + N)) -
+       0.227 * std::sin(2.0 * (F + N)) + 0.206 * std::sin(2.0 * N) +
+       0.143 * std::sin(ls)) / kArcs,
+    (+9.203 * std::cos(N) + 0.574 * std::cos(2.0 * (F - D + N)) +
+      0.098 * std::cos(2.0 * (F + N)) - 0.090 * std::cos(2.0 * N)) / kArcs,
+    0.4090928 - 2.2696e-4 * T,
+  };
+}
+
+}
+
+Mat3 NutMatrix(double const T) {
+  auto const n = NutationOf(T);
+  return Mat3::RotateX(-n.eps - n.deps) * Mat3::RotateZ(-n.dpsi) * Mat3::RotateX(n.eps);
+}
+
+double EquationOfEquinoxes(double const T) {
+  auto const n = NutationOf(T);
+  return n.dpsi * std::cos(n.eps);
+}
+
 }
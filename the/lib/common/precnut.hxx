@@ -16,4 +16,16 @@ Mat3 PrecMatrixEcl(double const T0, double const T1);
 /// @note: T0 and T1 in Julian centuries since J2000 (T - MJD_J2000 / 36525)
 Mat3 PrecMatrixEqu(double const T0, double const T1);
 
+/// Returns a nutation transformation matrix of the mean equatorial coordinates
+/// of date to the true ones, of the main terms of the IAU 1980 theory, to 0.5".
+/// @param T Epoch
+/// @note: T in Julian centuries since J2000 (T - MJD_J2000 / 36525)
+Mat3 NutMatrix(double const T);
+
+/// Returns the equation of the equinoxes in radians, apparent sidereal time
+/// less the mean one, of the nutation of NutMatrix.
+/// @param T Epoch
+/// @note: T in Julian centuries since J2000 (T - MJD_J2000 / 36525)
+double EquationOfEquinoxes(double const T);
+
 }
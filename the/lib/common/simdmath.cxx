@@ -0,0 +1,454 @@
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "simdmath.hxx"
+
+// Kernels return 32-byte vectors only to kernels compiled alike, so the ABI
+// GCC warns of is the same on both sides of every call; optimised builds
+// inline them into the AVX2 entry points anyway. Functions of Lanes compiled
+// for AVX2 take and return vectors by reference, as their callers may not be.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace the::simd {
+
+namespace {
+
+// Kernels are written once for a lane type V, a scalar or a vector of
+// doubles or floats, with GCC vector extensions: arithmetic and comparisons
+// work lane by lane, and a ? b : c selects lanes by a mask. Lanes<V> gives
+// the element type, the integer vector of the same shape, and square roots.
+
+template <typename V>
+struct Lanes;
+
+template <>
+struct Lanes<double> {
+  using Scalar = double;
+  static constexpr std::size_t N = 1;
+  static void Sqrt(double const &v, double &out) { out = std::sqrt(v); }
+};
+
+template <>
+struct Lanes<float> {
+  using Scalar = float;
+  static constexpr std::size_t N = 1;
+  static void Sqrt(float const &v, float &out) { out = std::sqrt(v); }
+};
+
+#if defined(__SSE2__)
+// Intrinsic types without their attributes, which template arguments drop.
+using Double2 = double    __attribute__((vector_size(16)));
+using Float4  = float     __attribute__((vector_size(16)));
+using Double4 = double    __attribute__((vector_size(32)));
+using Float8  = float     __attribute__((vector_size(32)));
+using Int2    = long long __attribute__((vector_size(16)));
+using Int4    = int       __attribute__((vector_size(16)));
+using Long4   = long long __attribute__((vector_size(32)));
+using Int8    = int       __attribute__((vector_size(32)));
+
+template <>
+struct Lanes<Double2> {
+  using Scalar = double;
+  using Int    = Int2;
+  static constexpr std::size_t N = 2;
+  static void Sqrt(Double2 const &v, Double2 &out) { out = _mm_sqrt_pd(v); }
+};
+
+template <>
+struct Lanes<Float4> {
+  using Scalar = float;
+  using Int    = Int4;
+  static constexpr std::size_t N = 4;
+  static void Sqrt(Float4 const &v, Float4 &out) { out = _mm_sqrt_ps(v); }
+};
+
+template <>
+struct Lanes<Double4> {
+  using Scalar = double;
+  using Int    = Long4;
+  static constexpr std::size_t N = 4;
+  __attribute__((target("avx2,fma")))
+  static void Sqrt(Double4 const &v, Double4 &out) { out = _mm256_sqrt_pd(v); }
+};
+
+template <>
+struct Lanes<Float8> {
+  using Scalar = float;
+  using Int    = Int8;
+  static constexpr std::size_t N = 8;
+  __attribute__((target("avx2,fma")))
+  static void Sqrt(Float8 const &v, Float8 &out) { out = _mm256_sqrt_ps(v); }
+};
+
+/// Lane types of every instruction set for an element type.
+template <typename S>
+struct Vectors;
+
+template <>
+struct Vectors<double> {
+  using SSE2 = Double2;
+  using AVX2 = Double4;
+};
+
+template <>
+struct Vectors<float> {
+  using SSE2 = Float4;
+  using AVX2 = Float8;
+};
+#endif
+
+template <typename V>
+using Scalar = typename Lanes<V>::Scalar;
+
+template <typename V>
+V Load(Scalar<V> const *p) {
+  V v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+template <typename V>
+void Store(Scalar<V> *p, V const &v) {
+  std::memcpy(p, &v, sizeof(v));
+}
+
+/// Returns value in every lane. Subtracting zeros keeps the sign of -0.0.
+template <typename V>
+V Splat(double const value) {
+  return static_cast<Scalar<V>>(value) - V{};
+}
+
+template <typename V>
+V Abs(V const &v) {
+  if constexpr (std::is_arithmetic_v<V>) {
+    return std::abs(v);
+  } else {
+    using I = typename Lanes<V>::Int;
+    return (V)((I)v & ~(I)Splat<V>(-0.0));
+  }
+}
+
+template <typename V>
+V CopySign(V const &v, V const &sign) {
+  if constexpr (std::is_arithmetic_v<V>) {
+    return std::copysign(v, sign);
+  } else {
+    using I = typename Lanes<V>::Int;
+    I const mask = (I)Splat<V>(-0.0);
+    return (V)(((I)v & ~mask) | ((I)sign & mask));
+  }
+}
+
+/// Returns a mask of lanes with the sign bit set, negative zeros and NaNs included.
+template <typename V>
+auto SignBit(V const &v) {
+  if constexpr (std::is_arithmetic_v<V>) {
+    return std::signbit(v);
+  } else {
+    using I = typename Lanes<V>::Int;
+    return (I)v < 0;
+  }
+}
+
+/// Rounds to the nearest integer, |v| < 2^51 for doubles and 2^22 for floats.
+template <typename V>
+V Round(V const &v) {
+  using S = Scalar<V>;
+  // 1.5 * 2^52 or 1.5 * 2^23: the sum drops the fraction.
+  S const magic = S(1.5) * S(std::uint64_t{1} << (std::numeric_limits<S>::digits - 1));
+  return (v + magic) - magic;
+}
+
+template <typename V>
+V Floor(V const &v) {
+  V const r = Round(v);
+  return r - (r > v ? Splat<V>(1.0) : Splat<V>(0.0));
+}
+
+double constexpr kPi       = 3.14159265358979311600e+00;
+double constexpr kPio2     = 1.57079632679489655800e+00;
+double constexpr kPio4     = 7.85398163397448278999e-01;
+double constexpr kInvPio2  = 6.36619772367581382433e-01;
+/// Difference of pi/2 and kPio2.
+double constexpr kMoreBits = 6.123233995736765886130e-17;
+
+/// Reductions by pi/2 in parts of 33 bits in double, fdlibm, and of 8 to 12
+/// bits in float, Cephes, keep products with quotients up to the limits exact.
+double constexpr kDoublePio2[]     = {1.57079632673412561417e+00, 6.07710050630396597660e-11,
+                                      2.02226624871116645580e-21, 8.47842766036889956997e-32};
+float  constexpr kFloatPio2[]      = {1.5703125f, 4.837512969970703125e-4f, 7.54978995489188216e-8f};
+double constexpr kDoubleMaxReduced = 1e5;
+float  constexpr kFloatMaxReduced  = 8192.0f;
+
+template <typename S>
+S MaxReduced() {
+  if constexpr (std::is_same_v<S, double>)
+    return kDoubleMaxReduced;
+  else
+    return kFloatMaxReduced;
+}
+
+template <typename V>
+void SinCosKernel(V const &x, V &sin, V &cos) {
+  V k, s, c;
+  if constexpr (std::is_same_v<Scalar<V>, double>) {
+    k = Round(x * kInvPio2);
+    V const r = (((x - k * kDoublePio2[0]) - k * kDoublePio2[1]) - k * kDoublePio2[2]) - k * kDoublePio2[3];
+    V const z = r * r;
+    // fdlibm __kernel_sin and __kernel_cos on [-pi/4, pi/4].
+    s = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+        z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+        z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+    c = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 +
+        z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07 +
+        z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+  } else {
+    k = Round(x * float(kInvPio2));
+    V const r = ((x - k * kFloatPio2[0]) - k * kFloatPio2[1]) - k * kFloatPio2[2];
+    V const z = r * r;
+    // Cephes sinf and cosf on [-pi/4, pi/4].
+    s = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+    c = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f +
+        z * 2.443315711809948e-5f));
+  }
+
+  // Quadrant of x.
+  V const q = k - Splat<V>(4.0) * Floor(k * Splat<V>(0.25));
+  auto const odd = (q == Splat<V>(1.0)) | (q == Splat<V>(3.0));
+  V const qs = odd ? c : s;
+  V const qc = odd ? s : c;
+  sin = q >= Splat<V>(2.0) ? -qs : qs;
+  cos = (q == Splat<V>(1.0)) | (q == Splat<V>(2.0)) ? -qc : qc;
+  // The polynomial loses the sign of zero.
+  sin = x == Splat<V>(0.0) ? x : sin;
+}
+
+/// Returns atan(t) for t in [0, 1], Cephes atan and atanf.
+template <typename V>
+V AtanKernel(V const &t) {
+  if constexpr (std::is_same_v<Scalar<V>, double>) {
+    auto const big = t > 0.66;
+    V const u = big ? (t - 1.0) / (t + 1.0) : t;
+    V const z = u * u;
+    V const p = (((-8.750608600031904122785e-01 * z - 1.615753718733365076637e+01) * z -
+                  7.500855792314704667340e+01) * z - 1.228866684490136173410e+02) * z -
+                  6.485021904942025371773e+01;
+    V const q = ((((z + 2.485846490142306297962e+01) * z + 1.650270098316988542046e+02) * z +
+                  4.328810604912902668951e+02) * z + 4.853903996359136964868e+02) * z +
+                  1.945506571482613964425e+02;
+    V const a = u + u * z * p / q;
+    return big ? a + (kPio4 + 0.5 * kMoreBits) : a;
+  } else {
+    // tan(pi/8).
+    auto const big = t > 0.4142135623730950f;
+    V const u = big ? (t - 1.0f) / (t + 1.0f) : t;
+    V const z = u * u;
+    V const a = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z -
+                 3.33329491539e-1f) * z * u + u;
+    return big ? a + float(kPio4) : a;
+  }
+}
+
+template <typename V>
+V Atan2Kernel(V const &y, V const &x) {
+  V const ax = Abs(x);
+  V const ay = Abs(y);
+  V const hi = ay > ax ? ay : ax;
+  V const lo = ay > ax ? ax : ay;
+  // Both zeros give 0 and both infinities 1, as atan2 has it.
+  V const t = hi == Splat<V>(0.0) ? Splat<V>(0.0) : lo == hi ? Splat<V>(1.0) : lo / hi;
+
+  // Octants: a, pi/2 - a, pi/2 + a, pi - a.
+  auto const swap = ay > ax;
+  auto const neg  = SignBit(x);
+  V a = AtanKernel(t);
+  a = swap ? -a : a;
+  a = neg ? -a : a;
+  V const hiPart = swap ? Splat<V>(kPio2) : neg ? Splat<V>(kPi) : Splat<V>(0.0);
+  V const loPart = swap ? Splat<V>(kMoreBits) : neg ? Splat<V>(2.0 * kMoreBits) : Splat<V>(0.0);
+  a = CopySign(hiPart + (a + loPart), y);
+  return (x == x) & (y == y) ? a : x + y;
+}
+
+template <typename V>
+V AsinKernel(V const &x) {
+  V const one = Splat<V>(1.0);
+  V cos;
+  Lanes<V>::Sqrt((one - x) * (one + x), cos);
+  return Atan2Kernel(x, cos);
+}
+
+// Arrays go through kernels by whole vectors, and the tail as a vector padded with zeros.
+
+template <typename V>
+void SinCosArray(Scalar<V> const *x, Scalar<V> *sin, Scalar<V> *cos, std::size_t const n) {
+  using S = Scalar<V>;
+  std::size_t constexpr N = Lanes<V>::N;
+
+  std::size_t i = 0;
+  for (; i + N <= n; i += N) {
+    V s, c;
+    SinCosKernel(Load<V>(x + i), s, c);
+    Store(sin + i, s);
+    Store(cos + i, c);
+  }
+  if (i < n) {
+    S tail[N] = {}, tailSin[N], tailCos[N];
+    std::copy(x + i, x + n, tail);
+    V s, c;
+    SinCosKernel(Load<V>(tail), s, c);
+    Store(tailSin, s);
+    Store(tailCos, c);
+    std::copy(tailSin, tailSin + (n - i), sin + i);
+    std::copy(tailCos, tailCos + (n - i), cos + i);
+  }
+
+  for (i = 0; i < n; ++i) {
+    if (std::abs(x[i]) > MaxReduced<S>() && std::isfinite(x[i])) {
+      sin[i] = std::sin(x[i]);
+      cos[i] = std::cos(x[i]);
+    }
+  }
+}
+
+template <typename V>
+void Atan2Array(Scalar<V> const *y, Scalar<V> const *x, Scalar<V> *out, std::size_t const n) {
+  using S = Scalar<V>;
+  std::size_t constexpr N = Lanes<V>::N;
+
+  std::size_t i = 0;
+  for (; i + N <= n; i += N)
+    Store(out + i, Atan2Kernel(Load<V>(y + i), Load<V>(x + i)));
+  if (i < n) {
+    S tailY[N] = {}, tailX[N] = {}, tailOut[N];
+    std::copy(y + i, y + n, tailY);
+    std::copy(x + i, x + n, tailX);
+    Store(tailOut, Atan2Kernel(Load<V>(tailY), Load<V>(tailX)));
+    std::copy(tailOut, tailOut + (n - i), out + i);
+  }
+}
+
+template <typename V>
+void AsinArray(Scalar<V> const *x, Scalar<V> *out, std::size_t const n) {
+  using S = Scalar<V>;
+  std::size_t constexpr N = Lanes<V>::N;
+
+  std::size_t i = 0;
+  for (; i + N <= n; i += N)
+    Store(out + i, AsinKernel(Load<V>(x + i)));
+  if (i < n) {
+    S tail[N] = {}, tailOut[N];
+    std::copy(x + i, x + n, tail);
+    Store(tailOut, AsinKernel(Load<V>(tail)));
+    std::copy(tailOut, tailOut + (n - i), out + i);
+  }
+}
+
+Isa active = SupportedIsa();
+
+#if defined(__SSE2__)
+/// Calls fn with a null pointer to the AVX2 lane type of S. Everything fn
+/// calls is inlined here and so compiled for AVX2 and FMA.
+template <typename S, typename Fn>
+__attribute__((target("avx2,fma"), flatten))
+void RunAvx2(Fn const &fn) {
+  fn(static_cast<typename Vectors<S>::AVX2 *>(nullptr));
+}
+#endif
+
+/// Calls fn with a null pointer to the lane type of S of the active instruction set.
+template <typename S, typename Fn>
+void Run(Fn const &fn) {
+#if defined(__SSE2__)
+  switch (active) {
+    case Isa::AVX2:
+      RunAvx2<S>(fn);
+      return;
+    case Isa::SSE2:
+      fn(static_cast<typename Vectors<S>::SSE2 *>(nullptr));
+      return;
+    case Isa::Scalar:
+      break;
+  }
+#endif
+  fn(static_cast<S *>(nullptr));
+}
+
+template <typename Lane>
+using LaneOf = std::remove_pointer_t<Lane>;
+
+template <typename S>
+void SinCosSpans(gsl::span<S const> x, gsl::span<S> sin, gsl::span<S> cos) {
+  Run<S>([&](auto *lane) {
+    SinCosArray<LaneOf<decltype(lane)>>(x.data(), sin.data(), cos.data(), static_cast<std::size_t>(x.size()));
+  });
+}
+
+template <typename S>
+void Atan2Spans(gsl::span<S const> y, gsl::span<S const> x, gsl::span<S> out) {
+  Run<S>([&](auto *lane) {
+    Atan2Array<LaneOf<decltype(lane)>>(y.data(), x.data(), out.data(), static_cast<std::size_t>(y.size()));
+  });
+}
+
+template <typename S>
+void AsinSpans(gsl::span<S const> x, gsl::span<S> out) {
+  Run<S>([&](auto *lane) {
+    AsinArray<LaneOf<decltype(lane)>>(x.data(), out.data(), static_cast<std::size_t>(x.size()));
+  });
+}
+
+}
+
+void SinCos(gsl::span<double const> x, gsl::span<double> sin, gsl::span<double> cos) {
+  SinCosSpans(x, sin, cos);
+}
+
+void SinCos(gsl::span<float const> x, gsl::span<float> sin, gsl::span<float> cos) {
+  SinCosSpans(x, sin, cos);
+}
+
+void Atan2(gsl::span<double const> y, gsl::span<double const> x, gsl::span<double> out) {
+  Atan2Spans(y, x, out);
+}
+
+void Atan2(gsl::span<float const> y, gsl::span<float const> x, gsl::span<float> out) {
+  Atan2Spans(y, x, out);
+}
+
+void Asin(gsl::span<double const> x, gsl::span<double> out) {
+  AsinSpans(x, out);
+}
+
+void Asin(gsl::span<float const> x, gsl::span<float> out) {
+  AsinSpans(x, out);
+}
+
+Isa SupportedIsa() {
+#if defined(__SSE2__)
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return Isa::AVX2;
+  return Isa::SSE2;
+#else
+  return Isa::Scalar;
+#endif
+}
+
+Isa ActiveIsa() {
+  return active;
+}
+
+void UseIsa(Isa const isa) {
+  active = std::min(isa, SupportedIsa());
+}
+
+}
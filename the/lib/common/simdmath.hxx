@@ -0,0 +1,57 @@
+#pragma once
+
+#include <gsl.h>
+
+namespace the::simd {
+
+// Transcendental functions over arrays.
+//
+// The functions evaluate polynomial approximations on several values at once
+// in SIMD registers, branch-free, so whole arrays cost a fraction of calls
+// to libm. They run on AVX2 and FMA, on SSE2, or one value at a time,
+// whichever is the best the CPU has, see ActiveIsa.
+//
+// Errors against libm, over the whole range of arguments:
+//
+//   double  SinCos, Atan2, Asin  2 ulp;
+//   float   SinCos               3 ulp, or 1e-11 absolute next to zeros of sin and cos;
+//           Atan2                3 ulp;
+//           Asin                 4 ulp.
+//
+// An ulp of an angle of a turn is 0.2e-9 arcseconds in double and 0.1
+// arcseconds in float. Arguments of sin and cos beyond the fast reduction,
+// 1e5 in double and 8192 in float, are left to libm. NaNs, infinities and
+// signed zeros come out as libm gives them.
+//
+// Spans passed to a function must be of the same size.
+
+/// Computes sine and cosine of every x. Outputs must not overlap x.
+void SinCos(gsl::span<double const> x, gsl::span<double> sin, gsl::span<double> cos);
+void SinCos(gsl::span<float const> x, gsl::span<float> sin, gsl::span<float> cos);
+
+/// Computes atan2(y, x) of every pair. The output may be one of the inputs.
+void Atan2(gsl::span<double const> y, gsl::span<double const> x, gsl::span<double> out);
+void Atan2(gsl::span<float const> y, gsl::span<float const> x, gsl::span<float> out);
+
+/// Computes asin of every x. The output may be the input.
+void Asin(gsl::span<double const> x, gsl::span<double> out);
+void Asin(gsl::span<float const> x, gsl::span<float> out);
+
+/// Instruction sets the functions are implemented with.
+enum class Isa {
+  Scalar,
+  SSE2,
+  AVX2,
+};
+
+/// Returns the best instruction set the CPU has.
+Isa SupportedIsa();
+
+/// Returns the instruction set the functions use, SupportedIsa unless changed.
+Isa ActiveIsa();
+
+/// Makes the functions use an instruction set, at most SupportedIsa,
+/// for tests and benchmarks. Not to be called while the functions run.
+void UseIsa(Isa isa);
+
+}
@@ -1,21 +1,38 @@
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 #include "consts.hxx"
+#include "simdmath.hxx"
 #include "time.hxx"
 #include "spheric.hxx"
 
 namespace the {
 
+namespace {
+
+// Batches are transformed by kBatch elements at a time through buffers on the stack.
+std::ptrdiff_t constexpr kBatch = 256;
+
+using Batch = std::array<double, kBatch>;
+
+gsl::span<double> Head(Batch &batch, std::ptrdiff_t const size) {
+  return {batch.data(), size};
+}
+
+}
+
 double EclipticObliquity(double const T) {
   // Astronomical Almanac 2010, p. B52.
+  // kEpsilonJ2000 and the coefficients are in arcseconds.
   return (kEpsilonJ2000 -
-          (46.836769 - (1.831e-4 + (2.00340e-3 - (5.76e-7 - 4.34e-8*T)*T)*T)*T)*T
-          / 3600.0) * kRad;
+          (46.836769 - (1.831e-4 + (2.00340e-3 - (5.76e-7 - 4.34e-8*T)*T)*T)*T)*T)
+         / 3600.0 * kRad;
 }
 
 Mat3 Equ2EclMatrix(double const T) {
   double const eps = EclipticObliquity(T);
-  return Mat3::RotateX(eps * kRad);
+  return Mat3::RotateX(eps);
 }
 
 Mat3 Ecl2EquMatrix(double const T) {
@@ -60,4 +77,96 @@ void Hor2Equ(double h, double az, double lat,
     tau += kPi2;
 }
 
+void Equ2Hor(gsl::span<double const> dec, gsl::span<double const> tau, double lat,
+             gsl::span<double> h, gsl::span<double> az) {
+  auto const latS = std::sin(lat);
+  auto const latC = std::cos(lat);
+  Batch tauS, tauC, decS, decC;
+  for (std::ptrdiff_t begin = 0; begin < dec.size(); begin += kBatch) {
+    auto const size = std::min(kBatch, dec.size() - begin);
+    simd::SinCos(tau.subspan(begin, size), Head(tauS, size), Head(tauC, size));
+    simd::SinCos(dec.subspan(begin, size), Head(decS, size), Head(decC, size));
+
+    // Arguments of asin and atan2 are put to the outputs and transformed in place.
+    auto const hs  = h.subspan(begin, size);
+    auto const azs = az.subspan(begin, size);
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      hs[i]   = latS * decS[i] + latC * decC[i] * tauC[i];
+      azs[i]  = latC * (decS[i] / decC[i]) - latS * tauC[i];
+      tauS[i] = -tauS[i];
+    }
+    simd::Asin(hs, hs);
+    simd::Atan2(Head(tauS, size), azs, azs);
+    for (auto &a : azs) {
+      if (a < 0)
+        a += kPi2;
+    }
+  }
+}
+
+void Hor2Equ(gsl::span<double const> h, gsl::span<double const> az, double lat,
+             gsl::span<double> dec, gsl::span<double> tau) {
+  auto const latS = std::sin(lat);
+  auto const latC = std::cos(lat);
+  Batch azS, azC, hS, hC;
+  for (std::ptrdiff_t begin = 0; begin < h.size(); begin += kBatch) {
+    auto const size = std::min(kBatch, h.size() - begin);
+    simd::SinCos(az.subspan(begin, size), Head(azS, size), Head(azC, size));
+    simd::SinCos(h.subspan(begin, size), Head(hS, size), Head(hC, size));
+
+    auto const decs = dec.subspan(begin, size);
+    auto const taus = tau.subspan(begin, size);
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      decs[i] = latS * hS[i] - latC * hC[i] * azC[i];
+      taus[i] = latC * (hS[i] / hC[i]) + latS * azC[i];
+    }
+    simd::Asin(decs, decs);
+    simd::Atan2(Head(azS, size), taus, taus);
+    for (auto &t : taus) {
+      if (t < 0)
+        t += kPi2;
+    }
+  }
+}
+
+void MakeVec3(gsl::span<Polar const> polar, gsl::span<Vec3> vec) {
+  Batch phi, theta, phiS, phiC, thetaS, thetaC;
+  for (std::ptrdiff_t begin = 0; begin < polar.size(); begin += kBatch) {
+    auto const size = std::min(kBatch, polar.size() - begin);
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      phi[i]   = polar[begin + i].Phi;
+      theta[i] = polar[begin + i].Theta;
+    }
+    simd::SinCos(Head(phi, size), Head(phiS, size), Head(phiC, size));
+    simd::SinCos(Head(theta, size), Head(thetaS, size), Head(thetaC, size));
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      auto const r = polar[begin + i].R;
+      vec[begin + i] = {r * thetaC[i] * phiC[i], r * thetaC[i] * phiS[i], r * thetaS[i]};
+    }
+  }
+}
+
+void MakePolar(gsl::span<Vec3 const> vec, gsl::span<Polar> polar) {
+  Batch x, y, z, xy, xySqrt, phi, theta;
+  for (std::ptrdiff_t begin = 0; begin < vec.size(); begin += kBatch) {
+    auto const size = std::min(kBatch, vec.size() - begin);
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      auto const &v = vec[begin + i];
+      x[i] = v[0];
+      y[i] = v[1];
+      z[i] = v[2];
+      xy[i] = v[0]*v[0] + v[1]*v[1];
+      xySqrt[i] = std::sqrt(xy[i]);
+    }
+    simd::Atan2(Head(y, size), Head(x, size), Head(phi, size));
+    simd::Atan2(Head(z, size), Head(xySqrt, size), Head(theta, size));
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      auto &p = polar[begin + i];
+      p.Phi   = x[i] == 0.0 && y[i] == 0.0 ? 0.0 : phi[i];
+      p.Theta = z[i] == 0.0 && xySqrt[i] == 0.0 ? 0.0 : theta[i];
+      p.R     = std::sqrt(xy[i] + z[i]*z[i]);
+    }
+  }
+}
+
 }
@@ -2,10 +2,14 @@
 
 #include <array>
 
+#include <gsl.h>
+
 #include "mat.hxx"
 
 namespace the {
 
+/// Returns the mean obliquity of the ecliptic in radians.
+/// @param T is a time in Julian centuries since J2000
 double EclipticObliquity(double const T);
 
 /// Returns a matrix for transformation of equatorial to ecliptical coordinates.
@@ -38,4 +42,37 @@ void Equ2Hor(double dec, double tau, double lat,
 void Hor2Equ(double h, double az, double lat, 
              double& dec, double& tau);
 
+// Transforms equatorial coordinates of many objects to the horizon system
+// of one observer. Same as Equ2Hor above, element by element, evaluated in
+// SIMD lanes with the latitude terms computed once.
+// @param dec Declinations
+// @param tau Hour angles
+// @param lat Geographical latitude of the observer
+// @param [out] h Altitudes
+// @param [out] az Azimuths
+// @note All parameters in radians. Spans must be of the same size;
+//       outputs must not overlap inputs.
+void Equ2Hor(gsl::span<double const> dec, gsl::span<double const> tau, double lat,
+             gsl::span<double> h, gsl::span<double> az);
+
+// Transforms horizontal coordinates of many objects to the equatorial system
+// of one observer. Same as Hor2Equ above, element by element.
+// @param h Altitudes
+// @param az Azimuths
+// @param lat Geographical latitude of the observer
+// @param [out] dec Declinations
+// @param [out] tau Hour angles
+// @note All parameters in radians. Spans must be of the same size;
+//       outputs must not overlap inputs.
+void Hor2Equ(gsl::span<double const> h, gsl::span<double const> az, double lat,
+             gsl::span<double> dec, gsl::span<double> tau);
+
+// Converts polar coordinates to vectors as MakeVec3 does, element by element.
+// Spans must be of the same size.
+void MakeVec3(gsl::span<Polar const> polar, gsl::span<Vec3> vec);
+
+// Converts vectors to polar coordinates as MakePolar does, element by element.
+// Spans must be of the same size.
+void MakePolar(gsl::span<Vec3 const> vec, gsl::span<Polar> polar);
+
 }
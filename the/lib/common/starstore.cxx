@@ -0,0 +1,248 @@
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "errors.hxx"
+#include "simdmath.hxx"
+#include "starstore.hxx"
+
+namespace the {
+
+namespace {
+
+template <typename T>
+void Grow(details::AlignedArray<T> &column, std::size_t const size, std::size_t const capacity) {
+  static_assert(kStarStoreBatch * sizeof(T) % kStarStoreAlignment == 0,
+                "batches must keep the size of columns a multiple of the alignment");
+  auto *data = static_cast<T *>(std::aligned_alloc(kStarStoreAlignment, capacity * sizeof(T)));
+  if (!data)
+    Panic(RuntimeError{"could not allocate star columns"});
+  if (size > 0)
+    std::memcpy(data, column.get(), size * sizeof(T));
+  column.reset(data);
+}
+
+/// Rotates stars [begin, end) one at a time.
+void RotateScalar(Mat3f const &m, float const *x, float const *y, float const *z, float const *w,
+                  std::size_t const begin, std::size_t const end, float *out) {
+  for (auto i = begin; i < end; ++i) {
+    auto const quad = out + 4 * (i - begin);
+    quad[0] = m[0][0] * x[i] + m[0][1] * y[i] + m[0][2] * z[i];
+    quad[1] = m[1][0] * x[i] + m[1][1] * y[i] + m[1][2] * z[i];
+    quad[2] = m[2][0] * x[i] + m[2][1] * y[i] + m[2][2] * z[i];
+    quad[3] = w[i];
+  }
+}
+
+#if defined(__SSE2__)
+
+/// Rotates stars 4 at a time, returns the number of stars rotated.
+std::size_t RotateSse2(Mat3f const &m, float const *x, float const *y, float const *z, float const *w,
+                       std::size_t const size, float *out) {
+  __m128 r[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      r[i][j] = _mm_set1_ps(m[i][j]);
+  }
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    auto const vx = _mm_load_ps(x + i);
+    auto const vy = _mm_load_ps(y + i);
+    auto const vz = _mm_load_ps(z + i);
+    auto q0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0][0], vx), _mm_mul_ps(r[0][1], vy)), _mm_mul_ps(r[0][2], vz));
+    auto q1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[1][0], vx), _mm_mul_ps(r[1][1], vy)), _mm_mul_ps(r[1][2], vz));
+    auto q2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[2][0], vx), _mm_mul_ps(r[2][1], vy)), _mm_mul_ps(r[2][2], vz));
+    auto q3 = _mm_load_ps(w + i);
+    // Columns of x, y, z and sizes become quadruples of stars.
+    _MM_TRANSPOSE4_PS(q0, q1, q2, q3);
+    _mm_storeu_ps(out + 4 * i +  0, q0);
+    _mm_storeu_ps(out + 4 * i +  4, q1);
+    _mm_storeu_ps(out + 4 * i +  8, q2);
+    _mm_storeu_ps(out + 4 * i + 12, q3);
+  }
+  return i;
+}
+
+/// Rotates stars 8 at a time, returns the number of stars rotated.
+__attribute__((target("avx2,fma")))
+std::size_t RotateAvx2(Mat3f const &m, float const *x, float const *y, float const *z, float const *w,
+                       std::size_t const size, float *out) {
+  __m256 r[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      r[i][j] = _mm256_set1_ps(m[i][j]);
+  }
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    auto const vx = _mm256_load_ps(x + i);
+    auto const vy = _mm256_load_ps(y + i);
+    auto const vz = _mm256_load_ps(z + i);
+    auto const q0 = _mm256_fmadd_ps(r[0][2], vz, _mm256_fmadd_ps(r[0][1], vy, _mm256_mul_ps(r[0][0], vx)));
+    auto const q1 = _mm256_fmadd_ps(r[1][2], vz, _mm256_fmadd_ps(r[1][1], vy, _mm256_mul_ps(r[1][0], vx)));
+    auto const q2 = _mm256_fmadd_ps(r[2][2], vz, _mm256_fmadd_ps(r[2][1], vy, _mm256_mul_ps(r[2][0], vx)));
+    auto const q3 = _mm256_load_ps(w + i);
+    // Transposes within 128-bit lanes: stars 0-3 in the low lanes, 4-7 in the high ones.
+    auto const t0 = _mm256_unpacklo_ps(q0, q1);
+    auto const t1 = _mm256_unpackhi_ps(q0, q1);
+    auto const t2 = _mm256_unpacklo_ps(q2, q3);
+    auto const t3 = _mm256_unpackhi_ps(q2, q3);
+    auto const s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    auto const s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    auto const s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    auto const s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(out + 4 * i +  0, _mm256_permute2f128_ps(s0, s1, 0x20));
+    _mm256_storeu_ps(out + 4 * i +  8, _mm256_permute2f128_ps(s2, s3, 0x20));
+    _mm256_storeu_ps(out + 4 * i + 16, _mm256_permute2f128_ps(s0, s1, 0x31));
+    _mm256_storeu_ps(out + 4 * i + 24, _mm256_permute2f128_ps(s2, s3, 0x31));
+  }
+  return i;
+}
+
+#endif
+
+template <typename T>
+void Permute(details::AlignedArray<T> &column, std::vector<std::uint32_t> const &order,
+             std::vector<T> &buffer) {
+  buffer.resize(order.size());
+  for (std::size_t i = 0; i < order.size(); ++i)
+    buffer[i] = column[order[i]];
+  std::copy(buffer.begin(), buffer.end(), column.get());
+}
+
+}
+
+StarStore::StarStore(StarStore &&other) noexcept
+    : ra_{std::move(other.ra_)}
+    , dec_{std::move(other.dec_)}
+    , pmRA_{std::move(other.pmRA_)}
+    , pmDE_{std::move(other.pmDE_)}
+    , mag_{std::move(other.mag_)}
+    , colour_{std::move(other.colour_)}
+    , size_{std::exchange(other.size_, 0)}
+    , capacity_{std::exchange(other.capacity_, 0)}
+{}
+
+StarStore & StarStore::operator = (StarStore &&other) noexcept {
+  if (this != &other) {
+    ra_       = std::move(other.ra_);
+    dec_      = std::move(other.dec_);
+    pmRA_     = std::move(other.pmRA_);
+    pmDE_     = std::move(other.pmDE_);
+    mag_      = std::move(other.mag_);
+    colour_   = std::move(other.colour_);
+    size_     = std::exchange(other.size_, 0);
+    capacity_ = std::exchange(other.capacity_, 0);
+  }
+  return *this;
+}
+
+void StarStore::Reserve(std::size_t capacity) {
+  if (capacity <= capacity_)
+    return;
+  capacity = std::max(capacity, 2 * capacity_);
+  capacity = (capacity + kStarStoreBatch - 1) / kStarStoreBatch * kStarStoreBatch;
+  Grow(ra_,     size_, capacity);
+  Grow(dec_,    size_, capacity);
+  Grow(pmRA_,   size_, capacity);
+  Grow(pmDE_,   size_, capacity);
+  Grow(mag_,    size_, capacity);
+  Grow(colour_, size_, capacity);
+  capacity_ = capacity;
+}
+
+void StarStore::SortByMagnitude() {
+  // Missing magnitudes are stored as the largest value.
+  std::vector<std::uint32_t> order(size_);
+  std::iota(order.begin(), order.end(), 0u);
+  std::stable_sort(order.begin(), order.end(), [this](std::uint32_t const a, std::uint32_t const b) {
+    return mag_[a] < mag_[b];
+  });
+
+  std::vector<std::uint32_t> buffer32;
+  std::vector<std::int32_t>  bufferS32;
+  std::vector<std::int16_t>  buffer16;
+  Permute(ra_,     order, buffer32);
+  Permute(dec_,    order, bufferS32);
+  Permute(pmRA_,   order, buffer16);
+  Permute(pmDE_,   order, buffer16);
+  Permute(mag_,    order, buffer16);
+  Permute(colour_, order, buffer16);
+}
+
+std::size_t StarStore::CountBrighter(double const limit) const {
+  auto const mags = Mag();
+  return static_cast<std::size_t>(
+      std::partition_point(mags.begin(), mags.end(), [limit](std::int16_t const m) {
+        return CompactMagnitude(m) <= limit;
+      }) - mags.begin());
+}
+
+StarVectors::StarVectors(StarVectors &&other) noexcept
+    : x_{std::move(other.x_)}
+    , y_{std::move(other.y_)}
+    , z_{std::move(other.z_)}
+    , pointSize_{std::move(other.pointSize_)}
+    , size_{std::exchange(other.size_, 0)}
+    , capacity_{std::exchange(other.capacity_, 0)}
+{}
+
+StarVectors & StarVectors::operator = (StarVectors &&other) noexcept {
+  if (this != &other) {
+    x_         = std::move(other.x_);
+    y_         = std::move(other.y_);
+    z_         = std::move(other.z_);
+    pointSize_ = std::move(other.pointSize_);
+    size_      = std::exchange(other.size_, 0);
+    capacity_  = std::exchange(other.capacity_, 0);
+  }
+  return *this;
+}
+
+void StarVectors::Reserve(std::size_t capacity) {
+  if (capacity <= capacity_)
+    return;
+  capacity = std::max(capacity, 2 * capacity_);
+  capacity = (capacity + kStarStoreBatch - 1) / kStarStoreBatch * kStarStoreBatch;
+  Grow(x_,         size_, capacity);
+  Grow(y_,         size_, capacity);
+  Grow(z_,         size_, capacity);
+  Grow(pointSize_, size_, capacity);
+  capacity_ = capacity;
+}
+
+void StarVectors::Append(double const ra, double const dec, float const pointSize) {
+  if (size_ == capacity_)
+    Reserve(size_ + 1);
+  x_[size_]         = static_cast<float>(std::cos(dec) * std::cos(ra));
+  y_[size_]         = static_cast<float>(std::cos(dec) * std::sin(ra));
+  z_[size_]         = static_cast<float>(std::sin(dec));
+  pointSize_[size_] = pointSize;
+  ++size_;
+}
+
+void StarVectors::Rotate(Mat3f const &rotation, gsl::span<float> const out,
+                         std::size_t const begin, std::size_t const end) const {
+  std::size_t done = begin;
+#if defined(__SSE2__)
+  auto const isa = simd::ActiveIsa();
+  if (isa != simd::Isa::Scalar) {
+    // Vector loads are aligned, so stars up to a multiple of 8 go one at a time.
+    done = std::min(end, (begin + 7) / 8 * 8);
+    RotateScalar(rotation, x_.get(), y_.get(), z_.get(), pointSize_.get(), begin, done, out.data());
+    auto const rotate = isa == simd::Isa::AVX2 ? RotateAvx2 : RotateSse2;
+    done += rotate(rotation, x_.get() + done, y_.get() + done, z_.get() + done, pointSize_.get() + done,
+                   end - done, out.data() + 4 * (done - begin));
+  }
+#endif
+  RotateScalar(rotation, x_.get(), y_.get(), z_.get(), pointSize_.get(), done, end,
+               out.data() + 4 * (done - begin));
+}
+
+}
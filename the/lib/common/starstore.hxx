@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+#include <gsl.h>
+
+#include "compactstar.hxx"
+#include "mat.hxx"
+
+namespace the {
+
+/// Rows columns of StarStore grow by, a multiple of the alignment for every column type.
+std::size_t constexpr kStarStoreBatch = std::size_t{1} << 16;
+/// Columns of StarStore start at a cache line.
+std::size_t constexpr kStarStoreAlignment = 64;
+
+namespace details {
+
+struct AlignedFree {
+  void operator () (void *p) const { std::free(p); }
+};
+
+template <typename T>
+using AlignedArray = std::unique_ptr<T[], AlignedFree>;
+
+}
+
+/// Implements a structure of arrays of CompactStar fields, so that a loop over
+/// stars reads contiguous arrays of the fields it needs only.
+/// Every column is aligned to kStarStoreAlignment and grows by batches of
+/// kStarStoreBatch rows, at least doubling its capacity.
+struct StarStore final {
+  StarStore() = default;
+  StarStore(StarStore const &) = delete;
+  StarStore(StarStore &&other) noexcept;
+
+  StarStore & operator = (StarStore const &) = delete;
+  StarStore & operator = (StarStore &&other) noexcept;
+
+  std::size_t Size()     const { return size_; }
+  std::size_t Capacity() const { return capacity_; }
+  bool        Empty()    const { return size_ == 0; }
+
+  void Reserve(std::size_t capacity);
+  void Clear() { size_ = 0; }
+
+  void Append(CompactStar const &star) {
+    if (size_ == capacity_)
+      Reserve(size_ + 1);
+    ra_[size_]     = star.Ra;
+    dec_[size_]    = star.Dec;
+    pmRA_[size_]   = star.PmRA;
+    pmDE_[size_]   = star.PmDE;
+    mag_[size_]    = star.Mag;
+    colour_[size_] = star.Colour;
+    ++size_;
+  }
+
+  CompactStar operator [] (std::size_t const i) const {
+    return {ra_[i], dec_[i], pmRA_[i], pmDE_[i], mag_[i], colour_[i]};
+  }
+
+  /// Orders stars by magnitude, brightest first and missing magnitudes last.
+  /// Stars of equal magnitude keep their order.
+  void SortByMagnitude();
+
+  /// Returns the number of leading stars not fainter than the limit,
+  /// provided stars are sorted by magnitude.
+  std::size_t CountBrighter(double limit) const;
+
+  /// Columns hold fields of CompactStar of the same names.
+  gsl::span<std::uint32_t const> Ra()     const { return {ra_.get(), Extent()}; }
+  gsl::span<std::int32_t const>  Dec()    const { return {dec_.get(), Extent()}; }
+  gsl::span<std::int16_t const>  PmRA()   const { return {pmRA_.get(), Extent()}; }
+  gsl::span<std::int16_t const>  PmDE()   const { return {pmDE_.get(), Extent()}; }
+  gsl::span<std::int16_t const>  Mag()    const { return {mag_.get(), Extent()}; }
+  gsl::span<std::int16_t const>  Colour() const { return {colour_.get(), Extent()}; }
+
+ private:
+  std::ptrdiff_t Extent() const { return static_cast<std::ptrdiff_t>(size_); }
+
+  details::AlignedArray<std::uint32_t> ra_;
+  details::AlignedArray<std::int32_t>  dec_;
+  details::AlignedArray<std::int16_t>  pmRA_;
+  details::AlignedArray<std::int16_t>  pmDE_;
+  details::AlignedArray<std::int16_t>  mag_;
+  details::AlignedArray<std::int16_t>  colour_;
+  std::size_t size_     = 0;
+  std::size_t capacity_ = 0;
+};
+
+/// Implements arrays of unit vectors of stars in the equatorial frame with
+/// a point size of every star, computed once so that drawing a frame takes
+/// a matrix product per star and no trigonometry.
+/// Arrays are aligned and grow as StarStore columns do.
+struct StarVectors final {
+  StarVectors() = default;
+  StarVectors(StarVectors const &) = delete;
+  StarVectors(StarVectors &&other) noexcept;
+
+  StarVectors & operator = (StarVectors const &) = delete;
+  StarVectors & operator = (StarVectors &&other) noexcept;
+
+  std::size_t Size()  const { return size_; }
+  bool        Empty() const { return size_ == 0; }
+
+  void Reserve(std::size_t capacity);
+
+  /// @param ra, dec Equatorial coordinates in radians.
+  void Append(double ra, double dec, float pointSize);
+
+  gsl::span<float const> X()         const { return {x_.get(), Extent()}; }
+  gsl::span<float const> Y()         const { return {y_.get(), Extent()}; }
+  gsl::span<float const> Z()         const { return {z_.get(), Extent()}; }
+  gsl::span<float const> PointSize() const { return {pointSize_.get(), Extent()}; }
+
+  /// Writes rotation * (x, y, z) and the point size of every star into
+  /// consecutive quadruples of out, which must hold 4 * Size() floats.
+  /// Uses AVX2 or SSE2 as simd::ActiveIsa says.
+  void Rotate(Mat3f const &rotation, gsl::span<float> out) const {
+    Rotate(rotation, out, 0, size_);
+  }
+
+  /// Rotates stars [begin, end) only, into quadruples of out from the first,
+  /// so that threads may rotate disjoint ranges into slices of one buffer.
+  void Rotate(Mat3f const &rotation, gsl::span<float> out, std::size_t begin, std::size_t end) const;
+
+ private:
+  std::ptrdiff_t Extent() const { return static_cast<std::ptrdiff_t>(size_); }
+
+  details::AlignedArray<float> x_;
+  details::AlignedArray<float> y_;
+  details::AlignedArray<float> z_;
+  details::AlignedArray<float> pointSize_;
+  std::size_t size_     = 0;
+  std::size_t capacity_ = 0;
+};
+
+}
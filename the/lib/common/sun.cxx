@@ -1,248 +1,204 @@
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 
 #include "consts.hxx"
 #include "math.hxx"
+#include "perturbations.hxx"
+#include "simdmath.hxx"
 #include "sun.hxx"
 #include "vec.hxx"
 
 namespace the {
 
-// XXX: I have to copy perturbation calculations as is until I figure out how it works.
-namespace // Unnamed namespace
-{
-  //
-  // Constants
-  //
-  const int o   = 10;         // Index offset
-  const int dim = 2*o+1;      // Work array dimension
-
-
-  //
-  // Definition of Pert class for summing up trigonometric perturbation 
-  // series
-  class Pert
-  {
-    public:
-
-      // Set time, mean anomalies and index range
-      void Init ( double T, 
-                  double M, int I_min, int I_max,
-                  double m, int i_min, int i_max );
-  
-      // Sum-up perturbations in longitude, radius and latitude
-      void Term ( int I, int i, int iT,
-                  double dlc, double dls, 
-                  double drc, double drs, 
-                  double dbc, double dbs );
-
-      // Retrieve perturbations in longitude, radius and latitude
-      double dl();
-      double dr();
-      double db();
-
-    private:
-        
-      double m_T;
-      double m_C[dim], m_S[dim], m_c[dim], m_s[dim];
-      double m_dl, m_db, m_dr;
-      double m_u, m_v;
-  };
-
-
-  // Set time, mean anomalies and index range
-  void Pert::Init ( double T, 
-                    double M, int I_min, int I_max,
-                    double m, int i_min, int i_max )
-  {
-    //
-    // Variables
-    //
-    int i;
-
-  
-    m_dl=0.0; m_dr=0.0; m_db=0.0; // reset perturbations
-
-    m_T=T;  // set time
-
-
-    // cosine and sine of multiples of M
-    m_C[o]=1.0; m_C[o+1]=std::cos(M); m_C[o-1]=+m_C[o+1];
-    m_S[o]=0.0; m_S[o+1]=std::sin(M); m_S[o-1]=-m_S[o+1];
-  
-    for (i=1; i<I_max; i++) 
-      SineLaw ( m_C[o+i],m_S[o+i], m_C[o+1],m_S[o+1], m_C[o+i+1],m_S[o+i+1] ); 
-    for (i=-1; i>I_min; i--) 
-      SineLaw ( m_C[o+i],m_S[o+i], m_C[o-1],m_S[o-1], m_C[o+i-1],m_S[o+i-1] ); 
-  
-
-    // cosine and sine of multiples of m
-    m_c[o]=1.0; m_c[o+1]=std::cos(m); m_c[o-1]=+m_c[o+1];
-    m_s[o]=0.0; m_s[o+1]=std::sin(m); m_s[o-1]=-m_s[o+1];
-    
-    for (i=1; i<i_max; i++) 
-      SineLaw ( m_c[o+i],m_s[o+i], m_c[o+1],m_s[o+1], m_c[o+i+1],m_s[o+i+1] );
-    for (i=-1; i>i_min; i--) 
-      SineLaw ( m_c[o+i],m_s[o+i], m_c[o-1],m_s[o-1], m_c[o+i-1],m_s[o+i-1] );
+namespace {
+
+// Perturbations of the Earth-Moon barycentre by Venus, Mars, Jupiter and
+// Saturn, of Montenbruck and Pfleger; M is the mean anomaly of the Earth,
+// m that of the planet.
+
+PertTerm constexpr kVenusTerms[] = {
+  {1,  0, 0, -0.22, 6892.76, -16707.37, -0.54,  0.00,  0.00},
+  {1,  0, 1, -0.06,  -17.35,     42.04, -0.15,  0.00,  0.00},
+  {1,  0, 2, -0.01,   -0.05,      0.13, -0.02,  0.00,  0.00},
+  {2,  0, 0,  0.00,   71.98,   -139.57,  0.00,  0.00,  0.00},
+  {2,  0, 1,  0.00,   -0.36,      0.70,  0.00,  0.00,  0.00},
+  {3,  0, 0,  0.00,    1.04,     -1.75,  0.00,  0.00,  0.00},
+  {0, -1, 0,  0.03,   -0.07,     -0.16, -0.07,  0.02, -0.02},
+  {1, -1, 0,  2.35,   -4.23,     -4.75, -2.64,  0.00,  0.00},
+  {1, -2, 0, -0.10,    0.06,      0.12,  0.20,  0.02,  0.00},
+  {2, -1, 0, -0.06,   -0.03,      0.20, -0.01,  0.01, -0.09},
+  {2, -2, 0, -4.70,    2.90,      8.28, 13.42,  0.01, -0.01},
+  {3, -2, 0,  1.80,   -1.74,     -1.44, -1.57,  0.04, -0.06},
+  {3, -3, 0, -0.67,    0.03,      0.11,  2.43,  0.01,  0.00},
+  {4, -2, 0,  0.03,   -0.03,      0.10,  0.09,  0.01, -0.01},
+  {4, -3, 0,  1.51,   -0.40,     -0.88, -3.36,  0.18, -0.10},
+  {4, -4, 0, -0.19,   -0.09,     -0.38,  0.77,  0.00,  0.00},
+  {5, -3, 0,  0.76,   -0.68,      0.30,  0.37,  0.01,  0.00},
+  {5, -4, 0, -0.14,   -0.04,     -0.11,  0.43, -0.03,  0.00},
+  {5, -5, 0, -0.05,   -0.07,     -0.31,  0.21,  0.00,  0.00},
+  {6, -4, 0,  0.15,   -0.04,     -0.06, -0.21,  0.01,  0.00},
+  {6, -5, 0, -0.03,   -0.03,     -0.09,  0.09, -0.01,  0.00},
+  {6, -6, 0,  0.00,   -0.04,     -0.18,  0.02,  0.00,  0.00},
+  {7, -5, 0, -0.12,   -0.03,     -0.08,  0.31, -0.02, -0.01},
+};
+PertSeries constexpr kVenus{0, 7, -6, 0, kVenusTerms, std::size(kVenusTerms)};
+static_assert(Valid(kVenus));
+
+PertTerm constexpr kMarsTerms[] = {
+  {1, -1, 0, -0.22,  0.17, -0.21, -0.27, 0.00, 0.00},
+  {1, -2, 0, -1.66,  0.62,  0.16,  0.28, 0.00, 0.00},
+  {2, -2, 0,  1.96,  0.57, -1.32,  4.55, 0.00, 0.01},
+  {2, -3, 0,  0.40,  0.15, -0.17,  0.46, 0.00, 0.00},
+  {2, -4, 0,  0.53,  0.26,  0.09, -0.22, 0.00, 0.00},
+  {3, -3, 0,  0.05,  0.12, -0.35,  0.15, 0.00, 0.00},
+  {3, -4, 0, -0.13, -0.48,  1.06, -0.29, 0.01, 0.00},
+  {3, -5, 0, -0.04, -0.20,  0.20, -0.04, 0.00, 0.00},
+  {4, -4, 0,  0.00, -0.03,  0.10,  0.04, 0.00, 0.00},
+  {4, -5, 0,  0.05, -0.07,  0.20,  0.14, 0.00, 0.00},
+  {4, -6, 0, -0.10,  0.11, -0.23, -0.22, 0.00, 0.00},
+  {5, -7, 0, -0.05,  0.00,  0.01, -0.14, 0.00, 0.00},
+  {5, -8, 0,  0.05,  0.01, -0.02,  0.10, 0.00, 0.00},
+};
+PertSeries constexpr kMars{1, 5, -8, -1, kMarsTerms, std::size(kMarsTerms)};
+static_assert(Valid(kMars));
+
+PertTerm constexpr kJupiterTerms[] = {
+  {-1, -1, 0,  0.01,  0.07,  0.18,  -0.02, 0.00, -0.02},
+  { 0, -1, 0, -0.31,  2.58,  0.52,   0.34, 0.02,  0.00},
+  { 1, -1, 0, -7.21, -0.06,  0.13, -16.27, 0.00, -0.02},
+  { 1, -2, 0, -0.54, -1.52,  3.09,  -1.12, 0.01, -0.17},
+  { 1, -3, 0, -0.03, -0.21,  0.38,  -0.06, 0.00, -0.02},
+  { 2, -1, 0, -0.16,  0.05, -0.18,  -0.31, 0.01,  0.00},
+  { 2, -2, 0,  0.14, -2.73,  9.23,   0.48, 0.00,  0.00},
+  { 2, -3, 0,  0.07, -0.55,  1.83,   0.25, 0.01,  0.00},
+  { 2, -4, 0,  0.02, -0.08,  0.25,   0.06, 0.00,  0.00},
+  { 3, -2, 0,  0.01, -0.07,  0.16,   0.04, 0.00,  0.00},
+  { 3, -3, 0, -0.16, -0.03,  0.08,  -0.64, 0.00,  0.00},
+  { 3, -4, 0, -0.04, -0.01,  0.03,  -0.17, 0.00,  0.00},
+};
+PertSeries constexpr kJupiter{-1, 3, -4, -1, kJupiterTerms, std::size(kJupiterTerms)};
+static_assert(Valid(kJupiter));
+
+PertTerm constexpr kSaturnTerms[] = {
+  {0, -1, 0,  0.00,  0.32,  0.01,  0.00, 0.00,  0.00},
+  {1, -1, 0, -0.08, -0.41,  0.97, -0.18, 0.00, -0.01},
+  {1, -2, 0,  0.04,  0.10, -0.23,  0.10, 0.00,  0.00},
+  {2, -2, 0,  0.04,  0.10, -0.35,  0.13, 0.00,  0.00},
+};
+PertSeries constexpr kSaturn{0, 2, -2, -1, kSaturnTerms, std::size(kSaturnTerms)};
+static_assert(Valid(kSaturn));
+
+/// Epochs summed up at a time, so that the arrays of a batch stay in the cache.
+std::size_t constexpr kBatch = 128;
+
+/// Arguments of sines and cosines: mean anomalies of planets, mean arguments
+/// of the lunar orbit and those of long-periodic perturbations. Sums and
+/// differences of arguments follow them, taken by the sine law.
+enum { iM2, iM3, iM4, iM5, iM6, iD, iA, iU, iLP, nArgs = iLP+4, iDmA = nArgs, iDpA, iDmM3, iDpM3, nAll };
+
+void SunPosBatch(double const *T, std::size_t const n, Vec3 *out) {
+  auto const size = static_cast<std::ptrdiff_t>(n);
+  // Rows of arguments follow one another, so that they take one call of
+  // SinCos however few epochs there are.
+  double args[nArgs * kBatch], sines[nAll * kBatch], cosines[nAll * kBatch];
+  auto const arg = [&](int const k) { return args + k * n; };
+  auto const S = [&](int const k) { return sines + k * n; };
+  auto const C = [&](int const k) { return cosines + k * n; };
+  for (std::size_t i = 0; i < n; ++i) {
+    double const t = T[i];
+    // Mean anomalies of planets and mean arguments of lunar orbit [rad]
+    arg(iM2)[i] = kPi2 * Frac ( 0.1387306 + 162.5485917*t );
+    arg(iM3)[i] = kPi2 * Frac ( 0.9931266 +  99.9973604*t );
+    arg(iM4)[i] = kPi2 * Frac ( 0.0543250 +  53.1666028*t );
+    arg(iM5)[i] = kPi2 * Frac ( 0.0551750 +   8.4293972*t );
+    arg(iM6)[i] = kPi2 * Frac ( 0.8816500 +   3.3938722*t );
+    arg(iD)[i]  = kPi2 * Frac ( 0.8274 + 1236.8531*t );
+    arg(iA)[i]  = kPi2 * Frac ( 0.3749 + 1325.5524*t );
+    arg(iU)[i]  = kPi2 * Frac ( 0.2591 + 1342.2278*t );
+    arg(iLP+0)[i] = kPi2*(0.6983 + 0.0561*t);
+    arg(iLP+1)[i] = kPi2*(0.5764 + 0.4174*t);
+    arg(iLP+2)[i] = kPi2*(0.4189 + 0.3306*t);
+    arg(iLP+3)[i] = kPi2*(0.3581 + 2.4814*t);
   }
-  
-  
-  // Sum-up perturbations in longitude, radius and latitude
-  void Pert::Term ( int I, int i, int iT,
-                    double dlc, double dls, 
-                    double drc, double drs, 
-                    double dbc, double dbs )
-  {
-    if ( iT == 0 ) 
-      SineLaw ( m_C[o+I],m_S[o+I], m_c[o+i],m_s[o+i], m_u,m_v );
-    else 
-      { m_u *= m_T; m_v *= m_T; };
-
-    m_dl += ( dlc*m_u + dls*m_v );
-    m_dr += ( drc*m_u + drs*m_v );
-    m_db += ( dbc*m_u + dbs*m_v );
+  simd::SinCos(gsl::span<double const>(args, nArgs * size), {sines, nArgs * size}, {cosines, nArgs * size});
+  for (std::size_t i = 0; i < n; ++i) {
+    SineLaw(C(iD)[i], S(iD)[i], C(iA)[i], -S(iA)[i], C(iDmA)[i], S(iDmA)[i]);
+    SineLaw(C(iD)[i], S(iD)[i], C(iA)[i], +S(iA)[i], C(iDpA)[i], S(iDpA)[i]);
+    SineLaw(C(iD)[i], S(iD)[i], C(iM3)[i], -S(iM3)[i], C(iDmM3)[i], S(iDmM3)[i]);
+    SineLaw(C(iD)[i], S(iD)[i], C(iM3)[i], +S(iM3)[i], C(iDpM3)[i], S(iDpM3)[i]);
   }
 
+  // Corrections in longitude ["], radius [1e-6 AU] and latitude ["]
+  double dl[kBatch], dr[kBatch], db[kBatch];
+  std::fill(dl, dl + n, 0.0);
+  std::fill(dr, dr + n, 0.0);
+  std::fill(db, db + n, 0.0);
+  auto const in = [size](double const *p) { return gsl::span<double const>(p, size); };
+  auto const sums = [&](int const perturbing) {
+    return PertBatch{in(T), in(C(iM3)), in(S(iM3)), in(C(perturbing)), in(S(perturbing)),
+                     {dl, size}, {dr, size}, {db, size}};
+  };
+  // Keplerian terms and perturbations by Venus, then by the others.
+  AddPerturbations(kVenus,   sums(iM2));
+  AddPerturbations(kMars,    sums(iM4));
+  AddPerturbations(kJupiter, sums(iM5));
+  AddPerturbations(kSaturn,  sums(iM6));
+
+  // Longitudes and latitudes, then their sines and cosines, in a row each.
+  double lb[2 * kBatch], sinLB[2 * kBatch], cosLB[2 * kBatch];
+  double *const l = lb, *const b = lb + n;
+  for (std::size_t i = 0; i < n; ++i) {
+    // Difference of Earth-Moon-barycentre and centre of the Earth
+    dl[i] += +  6.45*S(iD)[i] - 0.42*S(iDmA)[i] + 0.18*S(iDpA)[i]
+             +  0.17*S(iDmM3)[i] - 0.06*S(iDpM3)[i];
+
+    dr[i] += + 30.76*C(iD)[i] - 3.06*C(iDmA)[i] + 0.85*C(iDpA)[i]
+             -  0.58*C(iDpM3)[i] + 0.57*C(iDmM3)[i];
+
+    db[i] += + 0.576*S(iU)[i];
+
+    // Long-periodic perturbations
+    dl[i] += + 6.40 * S(iLP+0)[i]
+             + 1.87 * S(iLP+1)[i]
+             + 0.27 * S(iLP+2)[i]
+             + 0.20 * S(iLP+3)[i];
+
+    // Ecliptic coordinates ([rad],[AU])
+    l[i] = kPi2 * Frac ( 0.7859453 + arg(iM3)[i]/kPi2 +
+                       ( (6191.2+1.1*T[i])*T[i] + dl[i] ) / 1296.0e3 );
+    b[i] = db[i] / kArcs;
+  }
+  simd::SinCos(gsl::span<double const>(lb, 2 * size), {sinLB, 2 * size}, {cosLB, 2 * size});
+
+  for (std::size_t i = 0; i < n; ++i) {
+    double const r = 1.0001398 - 0.0000007 * T[i] + dr[i] * 1.0e-6;
+    double const sinL = sinLB[i], cosL = cosLB[i], sinB = sinLB[n + i], cosB = cosLB[n + i];
+    out[i] = {r * cosB * cosL, r * cosB * sinL, r * sinB};
+  }
+}
 
-  // Retrieve perturbations in longitude, radius and latitude
-  double Pert::dl() 
-    { return m_dl; }
+}
 
-  double Pert::dr() 
-    { return m_dr; }
+Vec3 SunPos(double const T) {
+  Vec3 pos;
+  SunPosBatch(&T, 1, &pos);
+  return pos;
+}
 
-  double Pert::db() 
-    { return m_db; }
+void SunPos(gsl::span<double const> T, gsl::span<Vec3> out) {
+  auto const n = static_cast<std::size_t>(T.size());
+  for (std::size_t i = 0; i < n; i += kBatch)
+    SunPosBatch(T.data() + i, std::min(kBatch, n - i), out.data() + i);
+}
 
-} // End of unnamed namespace
+ChebyshevEphemeris FitSunPos(double const T0, double const T1) {
+  return ChebyshevEphemeris::Fit([](double const T) { return SunPos(T); },
+                                 T0, T1, kSunEphemerisSegment, kSunEphemerisDegree);
+}
 
-Vec3 SunPos(double const T) {
-  //
-  // Variables
-  //
-  double  M2,M3,M4,M5,M6;          // Mean anomalies
-  double  D, A, U;                 // Mean arguments of lunar orbit
-  Pert    Ven, Mar, Jup, Sat;      // Perturbations
-  double  dl, dr, db;              // Corrections in longitude ["],
-                                   // radius [AU] and latitude ["]
-  double  l,b,r;                   // Ecliptic coordinates
-
-
-  // Mean anomalies of planets and mean arguments of lunar orbit [rad]
-  M2 = kPi2 * Frac ( 0.1387306 + 162.5485917*T );
-  M3 = kPi2 * Frac ( 0.9931266 +  99.9973604*T );
-  M4 = kPi2 * Frac ( 0.0543250 +  53.1666028*T ); 
-  M5 = kPi2 * Frac ( 0.0551750 +   8.4293972*T );
-  M6 = kPi2 * Frac ( 0.8816500 +   3.3938722*T ); 
-
-  D  = kPi2 * Frac ( 0.8274 + 1236.8531*T );
-  A  = kPi2 * Frac ( 0.3749 + 1325.5524*T );      
-  U  = kPi2 * Frac ( 0.2591 + 1342.2278*T );
-
-  
-  // Keplerian terms and perturbations by Venus
-  Ven.Init ( T, M3,0,7, M2,-6,0 );
-
-  Ven.Term ( 1, 0,0,-0.22,6892.76,-16707.37, -0.54, 0.00, 0.00);
-  Ven.Term ( 1, 0,1,-0.06, -17.35,    42.04, -0.15, 0.00, 0.00);
-  Ven.Term ( 1, 0,2,-0.01,  -0.05,     0.13, -0.02, 0.00, 0.00);
-  Ven.Term ( 2, 0,0, 0.00,  71.98,  -139.57,  0.00, 0.00, 0.00);
-  Ven.Term ( 2, 0,1, 0.00,  -0.36,     0.70,  0.00, 0.00, 0.00);
-  Ven.Term ( 3, 0,0, 0.00,   1.04,    -1.75,  0.00, 0.00, 0.00);
-  Ven.Term ( 0,-1,0, 0.03,  -0.07,    -0.16, -0.07, 0.02,-0.02);
-  Ven.Term ( 1,-1,0, 2.35,  -4.23,    -4.75, -2.64, 0.00, 0.00);
-  Ven.Term ( 1,-2,0,-0.10,   0.06,     0.12,  0.20, 0.02, 0.00);
-  Ven.Term ( 2,-1,0,-0.06,  -0.03,     0.20, -0.01, 0.01,-0.09);
-  Ven.Term ( 2,-2,0,-4.70,   2.90,     8.28, 13.42, 0.01,-0.01);
-  Ven.Term ( 3,-2,0, 1.80,  -1.74,    -1.44, -1.57, 0.04,-0.06);
-  Ven.Term ( 3,-3,0,-0.67,   0.03,     0.11,  2.43, 0.01, 0.00);
-  Ven.Term ( 4,-2,0, 0.03,  -0.03,     0.10,  0.09, 0.01,-0.01);
-  Ven.Term ( 4,-3,0, 1.51,  -0.40,    -0.88, -3.36, 0.18,-0.10);
-  Ven.Term ( 4,-4,0,-0.19,  -0.09,    -0.38,  0.77, 0.00, 0.00);
-  Ven.Term ( 5,-3,0, 0.76,  -0.68,     0.30,  0.37, 0.01, 0.00);
-  Ven.Term ( 5,-4,0,-0.14,  -0.04,    -0.11,  0.43,-0.03, 0.00);
-  Ven.Term ( 5,-5,0,-0.05,  -0.07,    -0.31,  0.21, 0.00, 0.00);
-  Ven.Term ( 6,-4,0, 0.15,  -0.04,    -0.06, -0.21, 0.01, 0.00);
-  Ven.Term ( 6,-5,0,-0.03,  -0.03,    -0.09,  0.09,-0.01, 0.00);
-  Ven.Term ( 6,-6,0, 0.00,  -0.04,    -0.18,  0.02, 0.00, 0.00);
-  Ven.Term ( 7,-5,0,-0.12,  -0.03,    -0.08,  0.31,-0.02,-0.01);
-
-  dl = Ven.dl(); dr = Ven.dr();  db = Ven.db();
-
-
-  // Perturbations by Mars 
-  Mar.Init ( T, M3,1,5, M4,-8,-1 );
-
-  Mar.Term ( 1,-1,0,-0.22,   0.17,    -0.21, -0.27, 0.00, 0.00);
-  Mar.Term ( 1,-2,0,-1.66,   0.62,     0.16,  0.28, 0.00, 0.00);
-  Mar.Term ( 2,-2,0, 1.96,   0.57,    -1.32,  4.55, 0.00, 0.01);
-  Mar.Term ( 2,-3,0, 0.40,   0.15,    -0.17,  0.46, 0.00, 0.00);
-  Mar.Term ( 2,-4,0, 0.53,   0.26,     0.09, -0.22, 0.00, 0.00);
-  Mar.Term ( 3,-3,0, 0.05,   0.12,    -0.35,  0.15, 0.00, 0.00);
-  Mar.Term ( 3,-4,0,-0.13,  -0.48,     1.06, -0.29, 0.01, 0.00);
-  Mar.Term ( 3,-5,0,-0.04,  -0.20,     0.20, -0.04, 0.00, 0.00);
-  Mar.Term ( 4,-4,0, 0.00,  -0.03,     0.10,  0.04, 0.00, 0.00);
-  Mar.Term ( 4,-5,0, 0.05,  -0.07,     0.20,  0.14, 0.00, 0.00);
-  Mar.Term ( 4,-6,0,-0.10,   0.11,    -0.23, -0.22, 0.00, 0.00);
-  Mar.Term ( 5,-7,0,-0.05,   0.00,     0.01, -0.14, 0.00, 0.00);
-  Mar.Term ( 5,-8,0, 0.05,   0.01,    -0.02,  0.10, 0.00, 0.00);
-
-  dl += Mar.dl(); dr += Mar.dr();  db += Mar.db();
-
-  
-  // Perturbations by Jupiter 
-  Jup.Init ( T, M3,-1,3, M5,-4,-1 );
-
-  Jup.Term (-1,-1,0, 0.01,   0.07,     0.18, -0.02, 0.00,-0.02);
-  Jup.Term ( 0,-1,0,-0.31,   2.58,     0.52,  0.34, 0.02, 0.00);
-  Jup.Term ( 1,-1,0,-7.21,  -0.06,     0.13,-16.27, 0.00,-0.02);
-  Jup.Term ( 1,-2,0,-0.54,  -1.52,     3.09, -1.12, 0.01,-0.17);
-  Jup.Term ( 1,-3,0,-0.03,  -0.21,     0.38, -0.06, 0.00,-0.02);
-  Jup.Term ( 2,-1,0,-0.16,   0.05,    -0.18, -0.31, 0.01, 0.00);
-  Jup.Term ( 2,-2,0, 0.14,  -2.73,     9.23,  0.48, 0.00, 0.00);
-  Jup.Term ( 2,-3,0, 0.07,  -0.55,     1.83,  0.25, 0.01, 0.00);
-  Jup.Term ( 2,-4,0, 0.02,  -0.08,     0.25,  0.06, 0.00, 0.00);
-  Jup.Term ( 3,-2,0, 0.01,  -0.07,     0.16,  0.04, 0.00, 0.00);
-  Jup.Term ( 3,-3,0,-0.16,  -0.03,     0.08, -0.64, 0.00, 0.00);
-  Jup.Term ( 3,-4,0,-0.04,  -0.01,     0.03, -0.17, 0.00, 0.00);
-
-  dl += Jup.dl(); dr += Jup.dr();  db += Jup.db();
-
-  
-  // Perturbations by Saturn 
-  Sat.Init ( T, M3,0,2, M6,-2,-1 );
-
-  Sat.Term ( 0,-1,0, 0.00,   0.32,     0.01,  0.00, 0.00, 0.00);
-  Sat.Term ( 1,-1,0,-0.08,  -0.41,     0.97, -0.18, 0.00,-0.01);
-  Sat.Term ( 1,-2,0, 0.04,   0.10,    -0.23,  0.10, 0.00, 0.00);
-  Sat.Term ( 2,-2,0, 0.04,   0.10,    -0.35,  0.13, 0.00, 0.00);
-
-  dl += Sat.dl(); dr += Sat.dr();  db += Sat.db();
-
-
-  // Difference of Earth-Moon-barycentre and centre of the Earth
-  dl += +  6.45*std::sin(D) - 0.42*std::sin(D-A) + 0.18*std::sin(D+A)
-        +  0.17*std::sin(D-M3) - 0.06*std::sin(D+M3);
-
-  dr += + 30.76*std::cos(D) - 3.06*std::cos(D-A) + 0.85*std::cos(D+A)
-        -  0.58*std::cos(D+M3) + 0.57*std::cos(D-M3);
-
-  db += + 0.576*std::sin(U);
-
-
-  // Long-periodic perturbations
-  dl += + 6.40 * std::sin ( kPi2*(0.6983 + 0.0561*T) ) 
-        + 1.87 * std::sin ( kPi2*(0.5764 + 0.4174*T) )
-        + 0.27 * std::sin ( kPi2*(0.4189 + 0.3306*T) ) 
-        + 0.20 * std::sin ( kPi2*(0.3581 + 2.4814*T) );
-
-
-  // Ecliptic coordinates ([rad],[AU])
-  l = kPi2 * Frac ( 0.7859453 + M3/kPi2 +
-                 ( (6191.2+1.1*T)*T + dl ) / 1296.0e3 );
-  r = 1.0001398 - 0.0000007 * T + dr * 1.0e-6;
-  b = db / kArcs;
-
-  return MakeVec3(Polar{l, b, r});
+Vec3 SunPos(ChebyshevEphemeris const &ephemeris, double const T) {
+  return ephemeris.Covers(T) ? ephemeris(T) : SunPos(T);
 }
 
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <gsl.h>
+
+#include "ephemeris.hxx"
 #include "vec.hxx"
 
 namespace the {
@@ -10,4 +13,21 @@ namespace the {
 /// @return Geocentric position of the Sun (in [AU]), referred to the ecliptic and equinox of date.
 Vec3 SunPos(double const T);
 
+/// Computes SunPos of every epoch of T into out, of the same size, summing
+/// the series up over many epochs at once.
+void SunPos(gsl::span<double const> T, gsl::span<Vec3> out);
+
+/// Length in Julian centuries and degree of segments of FitSunPos, which keep
+/// it within 1e-12 AU of SunPos, a millionth of an arcsecond.
+double constexpr kSunEphemerisSegment = 16.0 / 36525.0;
+unsigned constexpr kSunEphemerisDegree = 12;
+
+/// Fits SunPos over [T0, T1] in Julian centuries since J2000, for SunPos to
+/// look positions up rather than sum the series up.
+ChebyshevEphemeris FitSunPos(double const T0, double const T1);
+
+/// Returns SunPos(T) from the ephemeris fitted by FitSunPos, or computes it
+/// if the ephemeris does not cover T.
+Vec3 SunPos(ChebyshevEphemeris const &ephemeris, double const T);
+
 }
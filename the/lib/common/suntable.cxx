@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "consts.hxx"
+#include "frames.hxx"
+#include "spheric.hxx"
+#include "sun.hxx"
+#include "suntable.hxx"
+#include "vec.hxx"
+
+namespace the {
+
+namespace {
+
+// Rows are computed kBatch at a time through buffers on the stack.
+std::ptrdiff_t constexpr kBatch = 256;
+
+double Degrees(double const angle) {
+  return kDeg * angle;
+}
+
+/// Returns the angle in degrees within [0, 360).
+double DegreesOfCircle(double const angle) {
+  double const degrees = kDeg * angle;
+  if (degrees >= 0.0)
+    return degrees;
+  // A tiny negative angle would round up to 360 itself.
+  return std::min(degrees + 360.0, std::nextafter(360.0, 0.0));
+}
+
+}
+
+void SunTable(double const begin, double const step, std::size_t const first, gsl::span<SunRow> out) {
+  std::array<double, kBatch> T;
+  std::array<Vec3, kBatch> ecl, equ;
+  std::array<Polar, kBatch> eclPolar, equPolar;
+  std::array<Mat3, kBatch> ecl2equ;
+  for (std::ptrdiff_t offset = 0; offset < out.size(); offset += kBatch) {
+    auto const size = std::min(kBatch, out.size() - offset);
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      // Epochs are multiples of the step rather than sums of it, which would drift.
+      out[offset + i].MJD = begin + step * double(first + std::size_t(offset + i));
+      T[i] = (out[offset + i].MJD - kMJD_J2000) / 36525.0;
+    }
+    SunPos({T.data(), size}, {ecl.data(), size});
+    FrameCache::Shared().At(Frame::Ecl2Equ, {T.data(), size}, {ecl2equ.data(), size});
+    for (std::ptrdiff_t i = 0; i < size; ++i)
+      equ[i] = ecl2equ[i] * ecl[i];
+    MakePolar({ecl.data(), size}, {eclPolar.data(), size});
+    MakePolar({equ.data(), size}, {equPolar.data(), size});
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      auto &row = out[offset + i];
+      row.L   = DegreesOfCircle(eclPolar[i].Phi);
+      row.B   = Degrees(eclPolar[i].Theta);
+      row.R   = eclPolar[i].R;
+      row.RA  = DegreesOfCircle(equPolar[i].Phi);
+      row.Dec = Degrees(equPolar[i].Theta);
+    }
+  }
+}
+
+void FormatCsv(SunRow const &row, TextBuffer &text) {
+  // A millisecond of MJD, 1e-8 degrees of angles and 1e-10 AU of distance,
+  // about the precision of the series.
+  text.Fixed(row.MJD, 8).Put(',')
+      .Fixed(row.L, 8).Put(',')
+      .Fixed(row.B, 8).Put(',')
+      .Fixed(row.R, 10).Put(',')
+      .Fixed(row.RA, 8).Put(',')
+      .Fixed(row.Dec, 8).Put('\n');
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <gsl.h>
+
+#include "textbuffer.hxx"
+
+namespace the {
+
+// Tables of positions of the sun at epochs of equal steps.
+//
+// A binary table starts with SunTableHeader followed by Rows SunRow records
+// of doubles in the little-endian byte order. A CSV table has a line of
+// kSunCsvHeader followed by a line a row.
+
+/// Position of the sun at an epoch, referred to the ecliptic and the equator
+/// of date. Angles are in degrees, within [0, 360) for L and RA.
+struct SunRow {
+  /// Modified Julian Date.
+  double MJD;
+  /// Ecliptic longitude and latitude, and the distance in AU.
+  double L, B, R;
+  /// Right ascension and declination.
+  double RA, Dec;
+};
+static_assert(sizeof(SunRow) == 48, "sun table row must be 48 bytes");
+
+struct SunTableHeader {
+  char          Magic[8];
+  std::uint32_t Version;
+  /// Size of a row in bytes.
+  std::uint32_t RowSize;
+  std::uint64_t Rows;
+  /// MJD of the first row and the step between rows in days.
+  double        Begin;
+  double        Step;
+  std::uint64_t Reserved[3];
+};
+static_assert(sizeof(SunTableHeader) == 64, "sun table header must be 64 bytes");
+
+char constexpr kSunTableMagic[8] = {'T', 'H', 'E', 'S', 'U', 'N', 'T', 'B'};
+std::uint32_t constexpr kSunTableVersion = 1;
+
+/// Computes the rows of epochs begin + step * (first + i) into out[i].
+void SunTable(double begin, double step, std::size_t first, gsl::span<SunRow> out);
+
+char constexpr kSunCsvHeader[] = "MJD,L,B,R,RA,Dec\n";
+/// Room a row takes in CSV at most, the newline included.
+std::size_t constexpr kSunCsvRowSize = 128;
+
+/// Appends the row to the text as a line of CSV, angles to 1e-8 degrees.
+void FormatCsv(SunRow const &row, TextBuffer &text);
+
+}
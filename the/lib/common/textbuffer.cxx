@@ -0,0 +1,36 @@
+#include <charconv>
+#include <cstring>
+
+#include "textbuffer.hxx"
+
+namespace the {
+
+TextBuffer & TextBuffer::Put(char const c) {
+  if (size_ < capacity_)
+    begin_[size_++] = c;
+  else
+    overflowed_ = true;
+  return *this;
+}
+
+TextBuffer & TextBuffer::Put(char const *str) {
+  auto const length = std::strlen(str);
+  if (length <= capacity_ - size_) {
+    std::memcpy(begin_ + size_, str, length);
+    size_ += length;
+  } else {
+    overflowed_ = true;
+  }
+  return *this;
+}
+
+TextBuffer & TextBuffer::Fixed(double const value, int const decimals) {
+  auto const rv = std::to_chars(begin_ + size_, begin_ + capacity_, value, std::chars_format::fixed, decimals);
+  if (rv.ec == std::errc{})
+    size_ = static_cast<std::size_t>(rv.ptr - begin_);
+  else
+    overflowed_ = true;
+  return *this;
+}
+
+}
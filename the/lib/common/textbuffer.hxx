@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include <gsl.h>
+
+namespace the {
+
+/// Formats text into a buffer of the caller, which it never grows: text past
+/// the end is dropped and the buffer is marked overflowed. Numbers are
+/// formatted by std::to_chars, so rows of them take no allocation nor locale.
+struct TextBuffer final {
+  explicit TextBuffer(gsl::span<char> buffer)
+      : begin_{buffer.data()}
+      , capacity_{static_cast<std::size_t>(buffer.size())}
+  {}
+
+  TextBuffer & Put(char c);
+  TextBuffer & Put(char const *str);
+  /// Formats the value with the given number of decimals, as %.*f does.
+  TextBuffer & Fixed(double value, int decimals);
+
+  /// Drops the text so far.
+  void Clear() {
+    size_ = 0;
+    overflowed_ = false;
+  }
+
+  char const * data() const { return begin_; }
+  std::size_t  size() const { return size_; }
+  /// Tells whether some text did not fit.
+  bool         Overflowed() const { return overflowed_; }
+
+ private:
+  char        *begin_;
+  std::size_t  capacity_;
+  std::size_t  size_ = 0;
+  bool         overflowed_ = false;
+};
+
+}
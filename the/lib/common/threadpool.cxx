@@ -0,0 +1,147 @@
+#include <algorithm>
+
+#include "threadpool.hxx"
+
+namespace the {
+
+namespace {
+
+/// Pool and queue of the worker running on the thread, if any.
+thread_local ThreadPool const *currentPool = nullptr;
+thread_local std::size_t       currentSlot = 0;
+
+}
+
+struct ThreadPool::Loop {
+  void                   (*Body)(void *, std::size_t, std::size_t);
+  void                    *Context;
+  std::size_t              Grain;
+  /// Indices not run yet.
+  std::atomic<std::size_t> Pending;
+  std::mutex               Mutex;
+  std::condition_variable  Done;
+  bool                     Finished = false;
+};
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i + 1 < threads; ++i)
+    workers_.emplace_back([this, i] { Work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::Run(std::size_t const begin, std::size_t const end, std::size_t grain,
+                     void (*body)(void *, std::size_t, std::size_t), void *context) {
+  if (begin >= end)
+    return;
+  grain = std::max<std::size_t>(grain, 1);
+  if (workers_.empty() || end - begin <= grain) {
+    for (auto first = begin; first < end; first += std::min(grain, end - first))
+      body(context, first, first + std::min(grain, end - first));
+    return;
+  }
+
+  Loop loop;
+  loop.Body    = body;
+  loop.Context = context;
+  loop.Grain   = grain;
+  loop.Pending = end - begin;
+
+  auto const slot = Slot();
+  Execute(slot, {&loop, begin, end});
+  // Helps with whatever is queued until the loop is done; ranges of other loops included.
+  Range range;
+  while (loop.Pending.load() > 0 && Take(slot, range))
+    Execute(slot, range);
+
+  // Waits for the last range even if done, so that loop outlives its use.
+  std::unique_lock<std::mutex> lock(loop.Mutex);
+  loop.Done.wait(lock, [&loop] { return loop.Finished; });
+}
+
+void ThreadPool::Work(std::size_t const slot) {
+  currentPool = this;
+  currentSlot = slot;
+  for (;;) {
+    Range range;
+    if (Take(slot, range)) {
+      Execute(slot, range);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wake_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+    if (stop_ && queued_.load() == 0)
+      return;
+  }
+}
+
+void ThreadPool::Execute(std::size_t const slot, Range range) {
+  auto &loop = *range.Owner;
+  while (range.End - range.Begin > loop.Grain) {
+    auto const middle = range.Begin + (range.End - range.Begin) / 2;
+    Push(slot, {&loop, middle, range.End});
+    range.End = middle;
+  }
+  loop.Body(loop.Context, range.Begin, range.End);
+
+  auto const size = range.End - range.Begin;
+  if (loop.Pending.fetch_sub(size) == size) {
+    std::lock_guard<std::mutex> lock(loop.Mutex);
+    loop.Finished = true;
+    loop.Done.notify_all();
+  }
+}
+
+void ThreadPool::Push(std::size_t const slot, Range const &range) {
+  {
+    auto &queue = *queues_[slot];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    queue.Ranges.push_back(range);
+    ++queued_;
+  }
+  // Taking the lock orders the push before a worker checks queued_ and sleeps.
+  { std::lock_guard<std::mutex> lock(sleepMutex_); }
+  wake_.notify_one();
+}
+
+bool ThreadPool::Take(std::size_t const slot, Range &range) {
+  {
+    auto &queue = *queues_[slot];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (!queue.Ranges.empty()) {
+      range = queue.Ranges.back();
+      queue.Ranges.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+  for (std::size_t i = 1; i < queues_.size(); ++i) {
+    auto &queue = *queues_[(slot + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (!queue.Ranges.empty()) {
+      range = queue.Ranges.front();
+      queue.Ranges.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t ThreadPool::Slot() const {
+  return currentPool == this ? currentSlot : queues_.size() - 1;
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace the {
+
+// Work-stealing thread pool for loops over index ranges.
+//
+// Every thread of the pool owns a queue of ranges. A thread splits the range
+// it runs in halves down to the grain, queues the upper halves and runs the
+// lowest piece; when its own queue is empty it steals from the front of the
+// others, where the largest ranges wait. The thread calling ParallelFor takes
+// part in the loop, so a pool of one thread runs loops in the caller alone.
+
+struct ThreadPool final {
+  /// Starts threads - 1 workers; 0 for one thread per core.
+  explicit ThreadPool(unsigned threads = 0);
+  ThreadPool(ThreadPool const &) = delete;
+  ~ThreadPool();
+
+  ThreadPool & operator = (ThreadPool const &) = delete;
+
+  /// Returns the number of threads running loops, the caller included.
+  unsigned Size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+  /// Calls fn(first, last) over disjoint subranges covering [begin, end), of
+  /// at most grain indices each, from the threads of the pool, and returns
+  /// once every call has returned. Loops may be nested and may run from
+  /// several threads at once.
+  template <typename Fn>
+  void ParallelFor(std::size_t const begin, std::size_t const end, std::size_t const grain, Fn &&fn) {
+    using Body = std::remove_reference_t<Fn>;
+    Run(begin, end, grain, [](void *context, std::size_t const first, std::size_t const last) {
+      (*static_cast<Body *>(context))(first, last);
+    }, const_cast<void *>(static_cast<void const *>(&fn)));
+  }
+
+ private:
+  struct Loop;
+  struct Range {
+    Loop        *Owner;
+    std::size_t  Begin;
+    std::size_t  End;
+  };
+  struct alignas(64) Queue {
+    std::mutex        Mutex;
+    std::deque<Range> Ranges;
+  };
+
+  void Run(std::size_t begin, std::size_t end, std::size_t grain,
+           void (*body)(void *, std::size_t, std::size_t), void *context);
+  void Work(std::size_t slot);
+  /// Splits the range down to the grain queueing upper halves to the slot, and runs the rest.
+  void Execute(std::size_t slot, Range range);
+  void Push(std::size_t slot, Range const &range);
+  /// Takes the last range queued to the slot, or the first one of another queue.
+  bool Take(std::size_t slot, Range &range);
+  /// Returns the queue of the calling thread.
+  std::size_t Slot() const;
+
+  /// Queues of the workers, and the last one of threads outside the pool.
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread>            workers_;
+  std::atomic<std::size_t>            queued_{0};
+  std::mutex                          sleepMutex_;
+  std::condition_variable             wake_;
+  bool                                stop_ = false;
+};
+
+}
@@ -0,0 +1,285 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <utility>
+
+#include "consts.hxx"
+#include "logging.hxx"
+#include "tilecache.hxx"
+
+namespace the {
+
+namespace {
+
+/// Views closer than that to the last one do not restart the prefetch.
+double const kViewTolerance = 0.25 * kRad;
+/// Tiles a pass reads before it gives way to a newer view, so that views
+/// coming faster than tiles are ranked still get their nearest tiles.
+std::size_t constexpr kPassReads = 32;
+
+Fallible<> ReadAt(int const fd, char *data, std::size_t size, std::uint64_t offset) {
+  while (size > 0) {
+    auto const n = ::pread(fd, data, size, static_cast<off_t>(offset));
+    if (n <= 0)
+      return {RuntimeError{"short read"}};
+    data   += n;
+    size   -= static_cast<std::size_t>(n);
+    offset += static_cast<std::uint64_t>(n);
+  }
+  return {};
+}
+
+}
+
+std::ostream & operator << (std::ostream &os, TileCacheStats const &stats) {
+  auto const flags = os.flags();
+  auto const precision = os.precision();
+  os << std::fixed << std::setprecision(1)
+     << stats.Tiles << " tiles in " << double(stats.Bytes) / 1e6
+     << " of " << double(stats.Budget) / 1e6 << " MB"
+     << ", loaded " << stats.Loads << " tiles, " << double(stats.ReadBytes) / 1e6 << " MB in "
+     << double(stats.ReadNanos) / 1e6 << " ms"
+     << ", evicted " << stats.Evictions << " tiles";
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+TileCache::TileCache(Catalogue const &catalogue, TileIndex const &tiles, std::size_t const budget)
+    : catalogue_{&catalogue}
+    , tiles_{&tiles}
+    , lod_{catalogue, tiles}
+    , budget_{budget}
+{}
+
+TileCache::~TileCache() {
+  Stop();
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+Fallible<> TileCache::Start(char const *fpath) {
+  if (prefetcher_.joinable())
+    return {RuntimeError{std::string{"tile cache is started already: "} + fpath}};
+  if (lod_.Empty() || catalogue_->Rows() != tiles_->Rows())
+    return {RuntimeError{std::string{"tile directory does not match catalogue "} + fpath}};
+
+  PPMXLColumn const columns[] = {PPMXLColumn::RaJ2000, PPMXLColumn::DecJ2000, tiles_->Band()};
+  for (std::size_t i = 0; i < 3; ++i) {
+    auto const id = static_cast<std::uint16_t>(columns[i]);
+    auto const desc = std::find_if(catalogue_->Columns().begin(), catalogue_->Columns().end(),
+                                   [id](CatalogueColumn const &c) { return c.Id == id; });
+    if (desc == catalogue_->Columns().end() || desc->Type != CatalogueType::Float64)
+      return {RuntimeError{std::string{"catalogue lacks RaJ2000, DecJ2000 or band columns: "} + fpath}};
+    offsets_[i] = desc->Offset;
+  }
+
+  if (fd_ >= 0)
+    ::close(fd_);
+  fd_ = ::open(fpath, O_RDONLY);
+  if (fd_ < 0)
+    return {RuntimeError{std::string{"could not open file "} + fpath}};
+  fpath_ = fpath;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Started again after Stop, the prefetch resumes the view left.
+    stop_ = false;
+    pending_ = viewSet_;
+  }
+  prefetcher_ = std::thread([this] { Prefetch(); });
+  return {};
+}
+
+void TileCache::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  viewCv_.notify_all();
+  if (prefetcher_.joinable())
+    prefetcher_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_ = busy_ = false;
+  idleCv_.notify_all();
+}
+
+void TileCache::SetView(Vec3 const &axis, double const radius, double const limit) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (viewSet_ && radius == view_.Radius && limit == view_.Limit &&
+        SkyAngle(axis, view_.Axis) < kViewTolerance)
+      return;
+    view_ = View{axis, radius, limit};
+    viewSet_ = true;
+    ++generation_;
+    pending_ = true;
+  }
+  viewCv_.notify_one();
+}
+
+void TileCache::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idleCv_.wait(lock, [this] { return stop_ || (!pending_ && !busy_); });
+}
+
+std::vector<std::shared_ptr<TileData const>> TileCache::Resident() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::shared_ptr<TileData const>> resident;
+  resident.reserve(entries_.size());
+  for (auto const tile : lru_)
+    resident.push_back(entries_.at(tile).Data);
+  return resident;
+}
+
+TileCacheStats TileCache::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {entries_.size(), bytes_, budget_, loads_, evictions_, readBytes_, readNanos_};
+}
+
+Fallible<std::shared_ptr<TileData const>> TileCache::Read(std::uint32_t const tile, double const limit) const {
+  auto const &t = tiles_->Tiles()[tile];
+  auto const rows = lod_.Prefix(t, limit);
+
+  auto data = std::make_shared<TileData>();
+  data->Tile  = tile;
+  data->Limit = limit;
+  std::vector<double> *columns[] = {&data->RaJ2000, &data->DecJ2000, &data->Mag};
+  for (std::size_t i = 0; i < 3; ++i) {
+    columns[i]->resize(rows);
+    auto rv = ReadAt(fd_, reinterpret_cast<char *>(columns[i]->data()), rows * sizeof(double),
+                     offsets_[i] + t.Begin * sizeof(double));
+    if (!rv)
+      return {RuntimeError{"could not read tile " + std::to_string(t.Key) + " of " + fpath_}};
+  }
+  return {std::shared_ptr<TileData const>{std::move(data)}};
+}
+
+std::vector<std::uint32_t> TileCache::Rank(View const &view) const {
+  std::vector<std::pair<double, std::uint32_t>> ranked;
+  auto const *first = tiles_->Tiles().data();
+  tiles_->ForEachInCone(view.Axis, view.Radius, [&](CatalogueTile const &tile) {
+    // Angle from the axis to the nearest point of the cap.
+    auto const angle = SkyAngle(view.Axis, Vec3{tile.Axis[0], tile.Axis[1], tile.Axis[2]}) - tile.Radius;
+    ranked.emplace_back(std::max(angle, 0.0), static_cast<std::uint32_t>(&tile - first));
+  });
+  std::sort(ranked.begin(), ranked.end());
+
+  std::vector<std::uint32_t> order;
+  order.reserve(ranked.size());
+  for (auto const &r : ranked)
+    order.push_back(r.second);
+  return order;
+}
+
+void TileCache::Prefetch() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    viewCv_.wait(lock, [this] { return stop_ || pending_; });
+    if (stop_)
+      break;
+    pending_ = false;
+    busy_ = true;
+    auto const view = view_;
+    auto const generation = generation_;
+
+    lock.unlock();
+    auto const order = Rank(view);
+    lock.lock();
+
+    // Tiles of the view become the most recently used, the nearest last.
+    auto const pass = ++pass_;
+    for (auto rank = order.size(); rank-- > 0;) {
+      auto const it = entries_.find(order[rank]);
+      if (it == entries_.end())
+        continue;
+      it->second.Pass = pass;
+      it->second.Rank = rank;
+      lru_.splice(lru_.begin(), lru_, it->second.Lru);
+    }
+
+    std::size_t reads = 0;
+    for (std::size_t rank = 0; rank < order.size() && !stop_ &&
+                               (reads < kPassReads || generation == generation_); ++rank) {
+      auto const tile = order[rank];
+      auto const rows = lod_.Prefix(tiles_->Tiles()[tile], view.Limit);
+      if (rows == 0)
+        continue;
+      if (auto const it = entries_.find(tile); it != entries_.end() && it->second.Data->Rows() >= rows)
+        continue;
+
+      ++reads;
+      lock.unlock();
+      auto const start = std::chrono::steady_clock::now();
+      auto data = Read(tile, view.Limit);
+      auto const nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+      lock.lock();
+
+      if (!data) {
+        ERROR() << data.Err();
+        continue;
+      }
+      readBytes_ += (*data)->Rows() * 3 * sizeof(double);
+      readNanos_ += static_cast<std::uint64_t>(nanos);
+      if (!Admit(std::move(*data), rank))
+        break;
+    }
+
+    busy_ = false;
+    if (!pending_)
+      idleCv_.notify_all();
+  }
+}
+
+bool TileCache::Admit(std::shared_ptr<TileData const> data, std::size_t const rank) {
+  auto const tile = data->Tile;
+  // A tile read up to a fainter limit replaces the one resident.
+  std::shared_ptr<TileData const> previous;
+  if (auto const it = entries_.find(tile); it != entries_.end()) {
+    previous = it->second.Data;
+    bytes_ -= previous->Bytes();
+    lru_.erase(it->second.Lru);
+    entries_.erase(it);
+  }
+
+  // Tiles are evicted only if that makes room for the data, not in vain.
+  auto available = budget_ > bytes_ ? budget_ - bytes_ : 0;
+  auto victims = 0;
+  for (auto it = lru_.rbegin(); available < data->Bytes() && it != lru_.rend(); ++it, ++victims) {
+    auto const &victim = entries_.at(*it);
+    if (victim.Pass == pass_ && victim.Rank < rank)
+      break;
+    available += victim.Data->Bytes();
+  }
+
+  bool const fits = available >= data->Bytes();
+  if (fits) {
+    while (victims-- > 0)
+      Evict(lru_.back());
+    ++loads_;
+  } else if (previous) {
+    // The rows resident before fit, as they did not count towards bytes_.
+    data = std::move(previous);
+  } else {
+    return false;
+  }
+
+  lru_.push_front(tile);
+  bytes_ += data->Bytes();
+  entries_.emplace(tile, Entry{std::move(data), lru_.begin(), pass_, rank});
+  return fits;
+}
+
+void TileCache::Evict(std::uint32_t const tile) {
+  auto const it = entries_.find(tile);
+  bytes_ -= it->second.Data->Bytes();
+  lru_.erase(it->second.Lru);
+  entries_.erase(it);
+  ++evictions_;
+}
+
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "catalogue.hxx"
+#include "errors.hxx"
+#include "lod.hxx"
+#include "tiles.hxx"
+#include "vec.hxx"
+
+namespace the {
+
+// Out-of-core streaming of a tiled catalogue.
+//
+// The full PPMXL does not fit in memory, so instead of walking every row of
+// the catalogue rows of tiles around the view are read from the file into a
+// cache bounded by a budget in bytes. A background thread ranks tiles in the
+// view by the angle to its axis and reads them nearest first, as many rows
+// of a tile as are brighter than the magnitude limit. Tiles of the view are
+// reordered in the LRU list on every pass so that tiles out of the view are
+// evicted first and the farthest ones of the view after them; once only
+// nearer tiles are left the pass stops, whatever else is in the view. A new
+// view starts a new pass, though not before the pass has read a few tiles,
+// so that a view turning faster than tiles are ranked still gets some.
+
+/// Leading rows of a tile read from the catalogue file.
+struct TileData {
+  /// Index of the tile in TileIndex::Tiles().
+  std::uint32_t       Tile;
+  /// Magnitude limit the rows have been read up to.
+  double              Limit;
+  std::vector<double> RaJ2000;
+  std::vector<double> DecJ2000;
+  /// Magnitudes in the band of the tile directory, brightest first.
+  std::vector<double> Mag;
+
+  std::size_t Rows() const { return Mag.size(); }
+
+  /// Returns memory held by the tile in bytes.
+  std::size_t Bytes() const {
+    return sizeof(TileData) + Rows() * 3 * sizeof(double);
+  }
+};
+
+struct TileCacheStats {
+  /// Tiles and bytes resident.
+  std::size_t   Tiles;
+  std::size_t   Bytes;
+  std::size_t   Budget;
+  std::uint64_t Loads;
+  std::uint64_t Evictions;
+  std::uint64_t ReadBytes;
+  std::uint64_t ReadNanos;
+};
+
+std::ostream & operator << (std::ostream &os, TileCacheStats const &stats);
+
+std::size_t constexpr kDefaultTileCacheBudget = std::size_t{4} << 30;
+
+/// Implements a memory-bounded LRU cache of tiles of a tiled catalogue
+/// with a prefetch thread following the view.
+/// Neither the catalogue nor the index is copied; both must outlive the object.
+struct TileCache final {
+  TileCache(Catalogue const &catalogue, TileIndex const &tiles,
+            std::size_t budget = kDefaultTileCacheBudget);
+  TileCache(TileCache const &) = delete;
+  ~TileCache();
+
+  TileCache & operator = (TileCache const &) = delete;
+
+  /// Opens the catalogue file for reading tiles and starts the prefetch thread.
+  /// A cache stopped may be started again, resuming the last view set.
+  Fallible<> Start(char const *fpath);
+
+  /// Stops the prefetch thread. Tiles resident stay in the cache.
+  void Stop();
+
+  /// Sets the view the prefetch thread loads tiles for. Views within a fraction
+  /// of a degree of the last one with the same radius and limit are ignored.
+  /// @param axis Unit vector of the view direction in equatorial coordinates.
+  /// @param radius Angular radius of the view in radians.
+  /// @param limit Faintest magnitude in the band of the tile directory to load.
+  void SetView(Vec3 const &axis, double radius, double limit);
+
+  /// Blocks until the prefetch thread has finished with the last view.
+  void Wait();
+
+  /// Returns tiles resident. The tiles stay valid while they are referenced,
+  /// even if the cache evicts them meanwhile.
+  std::vector<std::shared_ptr<TileData const>> Resident() const;
+
+  /// Reads the leading rows of the tile brighter than the limit from the file,
+  /// bypassing the cache.
+  Fallible<std::shared_ptr<TileData const>> Read(std::uint32_t tile, double limit) const;
+
+  TileCacheStats Stats() const;
+
+ private:
+  struct View {
+    Vec3   Axis;
+    double Radius;
+    double Limit;
+  };
+
+  struct Entry {
+    std::shared_ptr<TileData const>    Data;
+    std::list<std::uint32_t>::iterator Lru;
+    /// Pass of the prefetch thread the tile was last in the view, and its rank then.
+    std::uint64_t                      Pass;
+    std::size_t                        Rank;
+  };
+
+  void Prefetch();
+  /// Returns tiles of the view, nearest first.
+  std::vector<std::uint32_t> Rank(View const &view) const;
+  /// Puts the tile into the cache evicting tiles out of the view or farther than it.
+  /// Returns false if the budget is taken by nearer tiles.
+  bool Admit(std::shared_ptr<TileData const> data, std::size_t rank);
+  void Evict(std::uint32_t tile);
+
+  Catalogue const *catalogue_;
+  TileIndex const *tiles_;
+  MagnitudeLod     lod_;
+  std::size_t      budget_;
+  std::string      fpath_;
+  int              fd_ = -1;
+  /// Offsets of RaJ2000, DecJ2000 and the band columns in the file.
+  std::uint64_t    offsets_[3] = {};
+
+  mutable std::mutex      mutex_;
+  std::condition_variable viewCv_, idleCv_;
+  std::thread             prefetcher_;
+  View                    view_{};
+  bool                    viewSet_ = false;
+  std::uint64_t           generation_ = 0;
+  bool                    pending_ = false;
+  bool                    busy_ = false;
+  bool                    stop_ = false;
+  std::uint64_t           pass_ = 0;
+
+  std::unordered_map<std::uint32_t, Entry> entries_;
+  /// Most recently used first.
+  std::list<std::uint32_t> lru_;
+  std::size_t              bytes_ = 0;
+  std::uint64_t            loads_ = 0;
+  std::uint64_t            evictions_ = 0;
+  std::uint64_t            readBytes_ = 0;
+  std::uint64_t            readNanos_ = 0;
+};
+
+}
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "consts.hxx"
+#include "tiles.hxx"
+
+namespace the {
+
+namespace {
+
+/// Number of Q3C pixels at the depth: 6 faces of 4^depth pixels.
+std::size_t TileKeys(unsigned const depth) {
+  return std::size_t{6} << (2 * depth);
+}
+
+double Dot3(Vec3 const &a, Vec3 const &b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/// Accumulates vectors of stars of a tile into a bounding cap.
+struct CapBuilder {
+  void Add(Vec3 const &v, double const weight = 1.0) {
+    for (int i = 0; i < 3; ++i)
+      sum[i] += weight * v[i];
+  }
+
+  /// Returns the axis, or false if the vectors cancel out.
+  bool Axis(Vec3 &axis) const {
+    auto const norm = std::sqrt(Dot3(sum, sum));
+    if (!(norm > 1e-12))
+      return false;
+    axis = sum / norm;
+    return true;
+  }
+
+  Vec3 sum{0.0, 0.0, 0.0};
+};
+
+// Margin for rounding of the measured radius.
+double constexpr kCapMargin = 1e-9;
+
+/// Rounds towards the direction, so the range of floats covers the range of doubles.
+float RoundFloat(double const value, float const direction) {
+  auto const rounded = static_cast<float>(value);
+  if ((direction < 0.0f && double(rounded) > value) || (direction > 0.0f && double(rounded) < value))
+    return std::nextafter(rounded, direction);
+  return rounded;
+}
+
+/// Reorders values of a column within [begin, begin + order.size()) so that
+/// the i-th value becomes the one at begin + order[i].
+template <typename T>
+void Permute(char *data, std::uint64_t const begin, std::vector<std::uint32_t> const &order,
+             std::vector<char> &buffer) {
+  auto *values = reinterpret_cast<T *>(data) + begin;
+  buffer.resize(order.size() * sizeof(T));
+  auto *sorted = reinterpret_cast<T *>(buffer.data());
+  for (std::size_t i = 0; i < order.size(); ++i)
+    sorted[i] = values[order[i]];
+  std::copy(sorted, sorted + order.size(), values);
+}
+
+template <typename T>
+void Scatter(char const *src, char *dst, gsl::span<std::uint64_t const> const ipix,
+             unsigned const depth, std::vector<std::uint64_t> cursor) {
+  auto const *from = reinterpret_cast<T const *>(src);
+  auto *to = reinterpret_cast<T *>(dst);
+  for (std::ptrdiff_t i = 0; i < ipix.size(); ++i)
+    to[cursor[TileKey(ipix[i], depth)]++] = from[i];
+}
+
+}
+
+std::string TileDirectoryPath(char const *catalogue) {
+  return std::string{catalogue} + ".tiles";
+}
+
+Vec3 SkyVector(double const ra, double const dec) {
+  return MakeVec3(Polar{ra * kRad, dec * kRad, 1.0});
+}
+
+double SkyAngle(Vec3 const &a, Vec3 const &b) {
+  auto const d = a - b;
+  return 2.0 * std::asin(std::min(1.0, std::sqrt(Dot3(d, d)) / 2.0));
+}
+
+SkyOverlap ConeOverlap(Vec3 const &coneAxis, double const coneRadius, Vec3 const &axis, double const radius) {
+  auto const angle = SkyAngle(coneAxis, axis);
+  if (angle > coneRadius + radius)
+    return SkyOverlap::Outside;
+  if (angle + radius <= coneRadius)
+    return SkyOverlap::Inside;
+  return SkyOverlap::Partial;
+}
+
+SkyOverlap PlanesOverlap(gsl::span<Vec3 const> const normals, Vec3 const &axis, double const radius) {
+  if (radius >= kPi / 2.0)
+    return SkyOverlap::Partial;
+
+  auto const s = std::sin(radius);
+  bool inside = true;
+  for (auto const &normal : normals) {
+    auto const d = Dot3(normal, axis) / std::sqrt(Dot3(normal, normal));
+    if (d < -s)
+      return SkyOverlap::Outside;
+    if (d < s)
+      inside = false;
+  }
+  return inside ? SkyOverlap::Inside : SkyOverlap::Partial;
+}
+
+Fallible<TileIndex> TileIndex::Open(char const *fpath) {
+  TileIndex index;
+
+  if (auto rv = MappedFile::Open(fpath); !rv) {
+    return {RuntimeError{std::string{"could not open tile directory: "} + fpath}};
+  } else {
+    index.file_ = std::move(*rv);
+  }
+
+  auto const size = index.file_.size();
+  if (size < sizeof(TileDirectoryHeader))
+    return {RuntimeError{"tile directory is truncated"}};
+
+  auto const *header = reinterpret_cast<TileDirectoryHeader const *>(index.file_.data());
+  if (std::memcmp(header->Magic, kTileDirectoryMagic, sizeof(kTileDirectoryMagic)) != 0)
+    return {RuntimeError{"not a tile directory"}};
+  if (header->Version != kTileDirectoryVersion)
+    return {RuntimeError{"unsupported tile directory version " + std::to_string(header->Version)}};
+  if (header->Depth > kMaxTileDepth)
+    return {RuntimeError{"tile depth " + std::to_string(header->Depth) + " is too large"}};
+  if ((size - sizeof(TileDirectoryHeader)) / sizeof(CatalogueTile) < header->Tiles)
+    return {RuntimeError{"tile directory is truncated"}};
+
+  index.header_ = header;
+  index.tiles_  = reinterpret_cast<CatalogueTile const *>(header + 1);
+
+  auto const depth = header->Depth;
+  auto const tiles = index.Tiles();
+
+  // Build levels bottom up: a node of a level bounds caps of its children sharing a key prefix.
+  index.levels_.resize(depth + 1);
+  std::vector<std::uint64_t> keys, counts;
+  auto &leaves = index.levels_[depth];
+  // Rows of tiles are read at Begin without further checks, so tiles must
+  // follow one another within the catalogue.
+  std::uint64_t const keyEnd = std::uint64_t{6} << (2 * depth);
+  std::uint64_t rows = 0;
+  for (std::ptrdiff_t i = 0; i < tiles.size(); ++i) {
+    auto const &tile = tiles[i];
+    if (i > 0 && tile.Key <= tiles[i - 1].Key)
+      return {RuntimeError{"tiles are not sorted by key"}};
+    if (tile.Key >= keyEnd || tile.Begin != rows || tile.Count > header->Rows - tile.Begin)
+      return {RuntimeError{"tile #" + std::to_string(i) + " is malformed"}};
+    rows += tile.Count;
+    leaves.push_back({Vec3{tile.Axis[0], tile.Axis[1], tile.Axis[2]}, tile.Radius,
+                      static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(i + 1)});
+    keys.push_back(tile.Key);
+    counts.push_back(tile.Count);
+  }
+
+  for (auto level = depth; level-- > 0;) {
+    auto const &children = index.levels_[level + 1];
+    auto &parents = index.levels_[level];
+    std::vector<std::uint64_t> parentKeys, parentCounts;
+
+    for (std::size_t begin = 0; begin < children.size();) {
+      auto const key = keys[begin] >> 2;
+      auto end = begin;
+      CapBuilder cap;
+      std::uint64_t count = 0;
+      for (; end < children.size() && keys[end] >> 2 == key; ++end) {
+        cap.Add(children[end].Axis, double(counts[end]));
+        count += counts[end];
+      }
+
+      Node node{Vec3{0.0, 0.0, 1.0}, kPi, static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end)};
+      if (cap.Axis(node.Axis)) {
+        node.Radius = 0.0;
+        for (auto i = begin; i < end; ++i)
+          node.Radius = std::max(node.Radius, SkyAngle(node.Axis, children[i].Axis) + children[i].Radius);
+        node.Radius = std::min(kPi, node.Radius + kCapMargin);
+      }
+      parents.push_back(node);
+      parentKeys.push_back(key);
+      parentCounts.push_back(count);
+      begin = end;
+    }
+
+    keys = std::move(parentKeys);
+    counts = std::move(parentCounts);
+  }
+
+  return {std::move(index)};
+}
+
+Fallible<> WriteTiledCatalogue(Catalogue const &catalogue, char const *fpath, unsigned const depth,
+                               PPMXLColumn const band) {
+  if (depth > kMaxTileDepth)
+    return {RuntimeError{"tile depth must not exceed " + std::to_string(kMaxTileDepth)}};
+  if (!catalogue.Has(PPMXLColumn::Ipix) || !catalogue.Has(PPMXLColumn::RaJ2000) ||
+      !catalogue.Has(PPMXLColumn::DecJ2000))
+    return {RuntimeError{"catalogue lacks one of Ipix, RaJ2000 or DecJ2000 columns"}};
+  if (!catalogue.Has(band))
+    return {RuntimeError{std::string{"catalogue lacks column "} + PPMXLColumnName(band)}};
+
+  auto const ipix = catalogue.Ipix();
+  auto const keys = TileKeys(depth);
+
+  // Counting sort: offsets[key] is the first row of the tile in the output.
+  std::vector<std::uint64_t> offsets(keys + 1, 0);
+  for (auto const id : ipix) {
+    auto const key = TileKey(id, depth);
+    if (key >= keys)
+      return {RuntimeError{"Ipix " + std::to_string(id) + " is not a Q3C pixel"}};
+    ++offsets[key + 1];
+  }
+  for (std::size_t key = 0; key < keys; ++key)
+    offsets[key + 1] += offsets[key];
+
+  auto const bytes = catalogue.Bytes();
+  auto out = MappedFile::Create(fpath, static_cast<std::size_t>(bytes.size()));
+  if (!out)
+    return {RuntimeError{std::string{"could not create catalogue "} + fpath}};
+  auto *dst = out->MutableData();
+
+  auto const columns = catalogue.Columns();
+  std::memcpy(dst, bytes.data(), sizeof(CatalogueHeader) + columns.size() * sizeof(CatalogueColumn));
+
+  CatalogueColumn const *ras = nullptr, *decs = nullptr, *mags = nullptr;
+  for (auto const &col : columns) {
+    auto const *src = bytes.data() + col.Offset;
+    if (col.Width == 8)
+      Scatter<std::uint64_t>(src, dst + col.Offset, ipix, depth, offsets);
+    else
+      Scatter<std::uint32_t>(src, dst + col.Offset, ipix, depth, offsets);
+
+    if (col.Id == static_cast<std::uint16_t>(PPMXLColumn::RaJ2000))
+      ras = &col;
+    if (col.Id == static_cast<std::uint16_t>(PPMXLColumn::DecJ2000))
+      decs = &col;
+    if (col.Id == static_cast<std::uint16_t>(band))
+      mags = &col;
+  }
+  if (ras->Type != CatalogueType::Float64 || decs->Type != CatalogueType::Float64 ||
+      mags->Type != CatalogueType::Float64)
+    return {RuntimeError{"RaJ2000, DecJ2000 and the band must be stored as Float64"}};
+
+  auto const *ra  = reinterpret_cast<double const *>(dst + ras->Offset);
+  auto const *dec = reinterpret_cast<double const *>(dst + decs->Offset);
+  auto const *mag = reinterpret_cast<double const *>(dst + mags->Offset);
+
+  std::vector<CatalogueTile> tiles;
+  std::vector<std::uint32_t> order;
+  std::vector<char> buffer;
+  for (std::size_t key = 0; key < keys; ++key) {
+    auto const begin = offsets[key], end = offsets[key + 1];
+    if (begin == end)
+      continue;
+
+    CatalogueTile tile = {};
+    tile.Key   = key;
+    tile.Begin = begin;
+    tile.Count = end - begin;
+
+    // Brightest first, missing magnitudes last.
+    order.resize(tile.Count);
+    for (std::uint32_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [m = mag + begin](std::uint32_t a, std::uint32_t b) {
+      return m[a] < m[b] || (!std::isnan(m[a]) && std::isnan(m[b]));
+    });
+    for (auto const &col : columns) {
+      if (col.Width == 8)
+        Permute<std::uint64_t>(dst + col.Offset, begin, order, buffer);
+      else
+        Permute<std::uint32_t>(dst + col.Offset, begin, order, buffer);
+    }
+
+    auto const *last = std::partition_point(mag + begin, mag + end, [](double m) { return !std::isnan(m); });
+    tile.Brightest = last == mag + begin ? NAN : RoundFloat(mag[begin], -INFINITY);
+    tile.Faintest  = last == mag + begin ? NAN : RoundFloat(last[-1], INFINITY);
+
+    CapBuilder cap;
+    for (auto i = begin; i < end; ++i) {
+      if (!std::isnan(ra[i]) && !std::isnan(dec[i]))
+        cap.Add(SkyVector(ra[i], dec[i]));
+    }
+    Vec3 axis{0.0, 0.0, 1.0};
+    double radius = kPi;
+    if (cap.Axis(axis)) {
+      radius = 0.0;
+      for (auto i = begin; i < end; ++i) {
+        if (!std::isnan(ra[i]) && !std::isnan(dec[i]))
+          radius = std::max(radius, SkyAngle(axis, SkyVector(ra[i], dec[i])));
+      }
+      radius = std::min(kPi, radius + kCapMargin);
+    }
+    std::copy(axis.begin(), axis.end(), tile.Axis);
+    tile.Radius = radius;
+    tiles.push_back(tile);
+  }
+
+  TileDirectoryHeader header = {};
+  std::memcpy(header.Magic, kTileDirectoryMagic, sizeof(kTileDirectoryMagic));
+  header.Version = kTileDirectoryVersion;
+  header.Depth   = depth;
+  header.Tiles   = tiles.size();
+  header.Rows    = catalogue.Rows();
+  header.Band    = static_cast<std::uint32_t>(band);
+
+  auto const path = TileDirectoryPath(fpath);
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    return {RuntimeError{"could not create tile directory " + path}};
+  bool const written =
+      std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+      std::fwrite(tiles.data(), sizeof(CatalogueTile), tiles.size(), file) == tiles.size();
+  if (std::fclose(file) != 0 || !written)
+    return {RuntimeError{"could not write tile directory " + path}};
+
+  return {};
+}
+
+}
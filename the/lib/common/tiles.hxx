@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gsl.h>
+
+#include "catalogue.hxx"
+#include "errors.hxx"
+#include "utils.hxx"
+#include "vec.hxx"
+
+namespace the {
+
+// Spatial tiling of a binary catalogue.
+//
+// PPMXL Ipix are Q3C pixels at nside 2^30: three bits of a cube face
+// followed by 30 interleaved bits of x and y on the face. Dropping the
+// 2 * (30 - depth) lowest bits yields the pixel containing the star at the
+// given depth, so pixels of one depth tile the sky hierarchically.
+//
+// A tiled catalogue has its rows sorted by tile, and a tile directory in a
+// file next to it (see TileDirectoryPath) lists, for every non-empty tile,
+// its rows and a spherical cap bounding its stars. Caps are measured on the
+// stars themselves, so queries stay exact whatever the shape of pixels is.
+// Within a tile rows are sorted by magnitude in one band, brightest first
+// and missing magnitudes last, so stars brighter than any limit make up a
+// prefix of the tile (see MagnitudeLod in lod.hxx).
+
+/// Depth of Q3C pixels stored in Ipix.
+unsigned constexpr kQ3CDepth = 30;
+unsigned constexpr kDefaultTileDepth = 8;
+/// Deeper tiles make the directory larger than the tiles are worth.
+unsigned constexpr kMaxTileDepth = 10;
+
+/// Returns the key of a tile at the depth containing the Q3C pixel.
+inline constexpr
+std::uint64_t TileKey(std::uint64_t const ipix, unsigned const depth) {
+  return ipix >> (2 * (kQ3CDepth - depth));
+}
+
+struct TileDirectoryHeader {
+  char          Magic[8];
+  std::uint32_t Version;
+  std::uint32_t Depth;
+  /// Number of tiles following the header.
+  std::uint64_t Tiles;
+  /// Number of rows of the catalogue.
+  std::uint64_t Rows;
+  /// PPMXLColumn rows of every tile are sorted by.
+  std::uint32_t Band;
+  std::uint32_t Reserved0;
+  std::uint64_t Reserved[3];
+};
+static_assert(sizeof(TileDirectoryHeader) == 64, "tile directory header must be 64 bytes");
+
+struct CatalogueTile {
+  std::uint64_t Key;
+  /// First row of the tile in the catalogue.
+  std::uint64_t Begin;
+  /// Number of rows of the tile.
+  std::uint64_t Count;
+  /// Unit vector to the centre of the cap bounding stars of the tile.
+  double        Axis[3];
+  /// Angular radius of the cap in radians.
+  double        Radius;
+  /// Magnitude range of the tile in the band, NaN if no star of the tile has it.
+  float         Brightest;
+  float         Faintest;
+};
+static_assert(sizeof(CatalogueTile) == 64, "catalogue tile must be 64 bytes");
+
+char constexpr kTileDirectoryMagic[8] = {'T', 'H', 'E', 'T', 'I', 'L', 'E', 'S'};
+std::uint32_t constexpr kTileDirectoryVersion = 2;
+
+/// Returns a path of the tile directory of the catalogue.
+std::string TileDirectoryPath(char const *catalogue);
+
+/// Returns a unit vector pointing to equatorial coordinates given in degrees.
+Vec3 SkyVector(double ra, double dec);
+
+/// Returns an angle between unit vectors in radians, accurate for small angles too.
+double SkyAngle(Vec3 const &a, Vec3 const &b);
+
+/// Result of testing a cap against a region.
+enum class SkyOverlap {
+  Outside,
+  Partial,
+  Inside,
+};
+
+/// Tests a cap against a cone.
+SkyOverlap ConeOverlap(Vec3 const &coneAxis, double coneRadius, Vec3 const &axis, double radius);
+
+/// Tests a cap against a convex region bounded by planes through the origin,
+/// e.g. the sides of a view frustum. A point v is inside if Dot(n, v) >= 0 for every normal n.
+SkyOverlap PlanesOverlap(gsl::span<Vec3 const> normals, Vec3 const &axis, double radius);
+
+/// Implements a read-only view of a tile directory mapped into memory,
+/// with a hierarchy of caps over it for queries in logarithmic time.
+struct TileIndex final {
+  static Fallible<TileIndex> Open(char const *fpath);
+
+  unsigned      Depth() const { return header_ ? header_->Depth : 0; }
+  std::uint64_t Rows()  const { return header_ ? header_->Rows : 0; }
+  PPMXLColumn   Band()  const { return header_ ? static_cast<PPMXLColumn>(header_->Band) : PPMXLColumn::Jmag; }
+
+  gsl::span<CatalogueTile const> Tiles() const {
+    return {tiles_, header_ ? static_cast<std::ptrdiff_t>(header_->Tiles) : 0};
+  }
+
+  /// Calls fn(tile, overlap) for every tile the test(axis, radius) does not
+  /// report as Outside. Children of a node reported Inside are not tested.
+  template <typename Test, typename Fn>
+  void Query(Test &&test, Fn &&fn) const {
+    if (!levels_.empty())
+      Visit(0, 0, levels_[0].size(), test, fn, false);
+  }
+
+  /// Calls fn(tile) for every tile overlapping the cone.
+  /// @param radius Angular radius of the cone in radians.
+  template <typename Fn>
+  void ForEachInCone(Vec3 const &axis, double const radius, Fn &&fn) const {
+    Query([&](Vec3 const &a, double r) { return ConeOverlap(axis, radius, a, r); },
+          [&](CatalogueTile const &tile, SkyOverlap) { fn(tile); });
+  }
+
+  /// Calls fn(tile) for every tile overlapping the region bounded by planes through the origin.
+  template <typename Fn>
+  void ForEachInPlanes(gsl::span<Vec3 const> const normals, Fn &&fn) const {
+    Query([&](Vec3 const &a, double r) { return PlanesOverlap(normals, a, r); },
+          [&](CatalogueTile const &tile, SkyOverlap) { fn(tile); });
+  }
+
+ private:
+  struct Node {
+    Vec3          Axis;
+    double        Radius;
+    /// Children in the next level, or the tile at the last level.
+    std::uint32_t Begin, End;
+  };
+
+  template <typename Test, typename Fn>
+  void Visit(std::size_t const level, std::size_t const begin, std::size_t const end,
+             Test &test, Fn &fn, bool const inside) const {
+    auto const &nodes = levels_[level];
+    bool const leaves = level + 1 == levels_.size();
+    for (auto i = begin; i < end; ++i) {
+      auto const &node = nodes[i];
+      auto const overlap = inside ? SkyOverlap::Inside : test(node.Axis, node.Radius);
+      if (overlap == SkyOverlap::Outside)
+        continue;
+      if (leaves)
+        fn(tiles_[node.Begin], overlap);
+      else
+        Visit(level + 1, node.Begin, node.End, test, fn, overlap == SkyOverlap::Inside);
+    }
+  }
+
+  MappedFile                     file_;
+  TileDirectoryHeader const     *header_ = nullptr;
+  CatalogueTile const           *tiles_  = nullptr;
+  /// Levels of caps from cube faces down to tiles.
+  std::vector<std::vector<Node>> levels_;
+};
+
+/// Writes rows of the catalogue sorted by tiles of the depth, and by the
+/// magnitude band within a tile, into a new catalogue, and its tile directory
+/// next to it. Rows of equal magnitude keep their order. Memory used depends
+/// on the size of the largest tile only.
+/// The catalogue must have Ipix, RaJ2000, DecJ2000 and band columns.
+Fallible<> WriteTiledCatalogue(Catalogue const &catalogue, char const *fpath,
+                               unsigned depth = kDefaultTileDepth,
+                               PPMXLColumn band = PPMXLColumn::Jmag);
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace the {
+
+/// Implements a lock-free triple buffer handing values over from one producer
+/// thread to one consumer thread.
+///
+/// The producer fills Back() and publishes it; the consumer takes the value
+/// published last with Update() and reads it as Front(). Neither ever waits for
+/// the other: values published faster than they are taken are skipped, and the
+/// consumer keeps its value until a newer one is published. Slots are reused,
+/// so memory a value holds, e.g. the capacity of a vector, is recycled.
+template <typename T>
+struct TripleBuffer final {
+  TripleBuffer() = default;
+  TripleBuffer(TripleBuffer const &) = delete;
+
+  TripleBuffer & operator = (TripleBuffer const &) = delete;
+
+  /// Returns the slot the producer writes.
+  T & Back() { return slots_[back_].Value; }
+
+  /// Makes Back() the value published, and gives the producer another slot.
+  /// Returns whether the value published before was skipped, in which case
+  /// the new Back() is that value, never read by the consumer; otherwise it
+  /// is a value the consumer has let go of.
+  bool Publish() {
+    auto const middle = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_ = middle & kIndex;
+    return middle & kFresh;
+  }
+
+  /// Makes the value published last Front(), unless it already is.
+  /// Returns whether Front() has changed.
+  bool Update() {
+    if (!(middle_.load(std::memory_order_acquire) & kFresh))
+      return false;
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+
+  /// Returns the slot the consumer reads, value-initialised until the first Update.
+  T &       Front()       { return slots_[front_].Value; }
+  T const & Front() const { return slots_[front_].Value; }
+
+ private:
+  /// Marks the slot between the threads as published and not taken yet.
+  static constexpr unsigned kFresh = 4;
+  static constexpr unsigned kIndex = 3;
+
+  // Slots and indices of either thread are kept apart on cache lines.
+  struct alignas(64) Slot {
+    T Value{};
+  };
+
+  std::array<Slot, 3>                 slots_;
+  alignas(64) unsigned                back_ = 0;
+  alignas(64) std::atomic<unsigned>   middle_{1};
+  alignas(64) unsigned                front_ = 2;
+};
+
+}
@@ -1,5 +1,11 @@
 #include <fstream>
 #include <iomanip>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "errors.hxx"
 #include "utils.hxx"
@@ -18,4 +24,79 @@ std::vector<char> LoadFile(char const *fpath) {
   return std::move(data);
 }
 
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}
+    , size_{std::exchange(other.size_, 0)}
+    , writable_{std::exchange(other.writable_, false)}
+{}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    ::munmap(const_cast<char *>(data_), size_);
+}
+
+MappedFile & MappedFile::operator = (MappedFile &&other) noexcept {
+  if (this != &other) {
+    if (data_)
+      ::munmap(const_cast<char *>(data_), size_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    writable_ = std::exchange(other.writable_, false);
+  }
+  return *this;
+}
+
+Fallible<MappedFile> MappedFile::Open(char const *fpath) {
+  int const fd = ::open(fpath, O_RDONLY);
+  if (fd < 0)
+    return {RuntimeError{std::string{"could not open file "} + fpath}};
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return {RuntimeError{std::string{"could not stat file "} + fpath}};
+  }
+
+  MappedFile file;
+  file.size_ = static_cast<std::size_t>(st.st_size);
+  if (file.size_ > 0) {
+    void *addr = ::mmap(nullptr, file.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      return {RuntimeError{std::string{"could not map file "} + fpath}};
+    }
+    file.data_ = static_cast<char const *>(addr);
+  }
+  // The mapping holds a reference to the file on its own.
+  ::close(fd);
+
+  return {std::move(file)};
+}
+
+Fallible<MappedFile> MappedFile::Create(char const *fpath, std::size_t const size) {
+  int const fd = ::open(fpath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return {RuntimeError{std::string{"could not create file "} + fpath}};
+
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    ::close(fd);
+    return {RuntimeError{std::string{"could not resize file "} + fpath}};
+  }
+
+  MappedFile file;
+  file.size_ = size;
+  file.writable_ = true;
+  if (file.size_ > 0) {
+    void *addr = ::mmap(nullptr, file.size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      return {RuntimeError{std::string{"could not map file "} + fpath}};
+    }
+    file.data_ = static_cast<char const *>(addr);
+  }
+  ::close(fd);
+
+  return {std::move(file)};
+}
+
 }
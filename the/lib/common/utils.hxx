@@ -1,11 +1,46 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 // #include <type_traits>
 // #include <utility>
 
+#include <gsl.h>
+
+#include "errors.hxx"
+
 namespace the {
 
 std::vector<char> LoadFile(char const *fpath);
 
+/// Maps a whole file into memory for reading, or for writing if created by Create.
+/// The mapping is released when the object is destroyed.
+struct MappedFile final {
+  MappedFile() = default;
+  MappedFile(MappedFile const &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  MappedFile & operator = (MappedFile const &) = delete;
+  MappedFile & operator = (MappedFile &&other) noexcept;
+
+  static Fallible<MappedFile> Open(char const *fpath);
+  /// Creates or truncates a file of the given size and maps it for writing.
+  static Fallible<MappedFile> Create(char const *fpath, std::size_t size);
+
+  char const * data() const { return data_; }
+  /// Returns the writable mapping, or nullptr if the file has been opened for reading.
+  char *       MutableData() const { return writable_ ? const_cast<char *>(data_) : nullptr; }
+  std::size_t  size() const { return size_; }
+
+  gsl::span<char const> Bytes() const {
+    return {data_, static_cast<std::ptrdiff_t>(size_)};
+  }
+
+ private:
+  char const *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool        writable_ = false;
+};
+
 }
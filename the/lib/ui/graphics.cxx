@@ -1,4 +1,14 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
 #include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 #include "the/lib/ui/errors.hxx"
 #include "the/lib/ui/graphics.hxx"
@@ -9,6 +19,50 @@ int Graphics::windowWidth_;
 int Graphics::windowHeight_;
 
 OglFallible<> Graphics::Init() {
+  if (auto rv = headless_ ? InitHeadless() : InitWindow(); !rv)
+    return rv;
+
+  // start GLEW extension handler
+  glewExperimental = GL_TRUE;
+  // GLEW looks for a GLX display it has no need of with EGL.
+  if (auto const err = glewInit(); err != GLEW_OK && !(headless_ && err == GLEW_ERROR_NO_GLX_DISPLAY)) {
+    return {RuntimeError{std::string{"could not start GLEW: "} +
+                         reinterpret_cast<char const *>(glewGetErrorString(err))}};
+  }
+  FALL_ON_GL_ERROR();
+  streamStars_ = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+  INFO() << (streamStars_ ? "streaming stars through a persistently mapped buffer" :
+                            "uploading stars every frame");
+  computeCulling_ = computeCulling_ && GLEW_VERSION_4_3;
+
+  // tell GL to only draw onto a pixel if the shape is closer to the viewer
+  glEnable(GL_DEPTH_TEST); // enable depth-testing
+  FALL_ON_GL_ERROR();
+  glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+  FALL_ON_GL_ERROR();
+  glDepthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
+  FALL_ON_GL_ERROR();
+
+  if (headless_) {
+    // Frames go into renderbuffers of colour and depth of the size of the window.
+    glGenFramebuffers(1, &framebuffer_);
+    glGenRenderbuffers(2, renderbuffers_);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers_[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, windowWidth_, windowHeight_);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers_[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, windowWidth_, windowHeight_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers_[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers_[1]);
+    FALL_ON_GL_ERROR();
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      return {RuntimeError{"offscreen framebuffer is incomplete"}};
+  }
+
+  return {};
+}
+
+OglFallible<> Graphics::InitWindow() {
   using namespace std::placeholders;
 
   glfwSetErrorCallback(Graphics::OnGlfwErrorCallback_);
@@ -48,23 +102,61 @@ OglFallible<> Graphics::Init() {
   glfwMakeContextCurrent(window_);
   FALL_ON_GL_ERROR();
 
-  // start GLEW extension handler
-  glewExperimental = GL_TRUE;
-  glewInit();
-  FALL_ON_GL_ERROR();
+  return {};
+}
 
-  // tell GL to only draw onto a pixel if the shape is closer to the viewer
-  glEnable(GL_DEPTH_TEST); // enable depth-testing
-  FALL_ON_GL_ERROR();
-  glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
-  FALL_ON_GL_ERROR();
-  glDepthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
-  FALL_ON_GL_ERROR();
+OglFallible<> Graphics::InitHeadless() {
+#if defined(__linux__)
+  // A display of no window system, and a context current without a surface.
+  auto const getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  EGLDisplay display = getPlatformDisplay ?
+      getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+  if (display == EGL_NO_DISPLAY)
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    return {RuntimeError{"could not initialise an EGL display"}};
+  eglDisplay_ = display;
+
+  if (!eglBindAPI(EGL_OPENGL_API))
+    return {RuntimeError{"EGL does not support OpenGL"}};
+  // Configs default to window surfaces, which a display without a window system has not.
+  EGLint const configAttributes[] = {
+    EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE,
+  };
+  EGLConfig config;
+  EGLint configs = 0;
+  if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0)
+    return {RuntimeError{"could not choose an EGL config for OpenGL"}};
+
+  // The shaders take OpenGL 4.0.
+  EGLint const contextAttributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 0,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE,
+  };
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+  if (context == EGL_NO_CONTEXT)
+    return {RuntimeError{"could not create an OpenGL 4.0 context with EGL"}};
+  eglContext_ = context;
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    return {RuntimeError{"could not make the EGL context current without a surface"}};
 
   return {};
+#else
+  return {RuntimeError{"headless rendering takes EGL, which is available on Linux only"}};
+#endif
 }
 
 OglFallible<> Graphics::Deinit() {
+  if (framebuffer_) {
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteRenderbuffers(2, renderbuffers_);
+    framebuffer_ = 0;
+  }
   // close GL context and any other GLFW resources
   if (!glfwInitialized_) {
     glfwTerminate();
@@ -72,12 +164,230 @@ OglFallible<> Graphics::Deinit() {
   }
   // TODO: Delete only if it has been compiled before.
   glDeleteProgram(starsPipeline_.programme);
+  ReleaseStarRegions();
+  glDeleteBuffers(1, &starsPipeline_.vbo);
   glDeleteVertexArrays(1, &starsPipeline_.vao);
+  starsPipeline_.vbo = 0;
+  starsPipeline_.vao = 0;
   FALL_ON_GL_ERROR();
+  if (starsPipeline_.staticVbo) {
+    glDeleteBuffers(1, &starsPipeline_.staticVbo);
+    glDeleteVertexArrays(1, &starsPipeline_.staticVao);
+    FALL_ON_GL_ERROR();
+  }
+  if (starsPipeline_.culledVbo) {
+    glDeleteBuffers(1, &starsPipeline_.culledVbo);
+    glDeleteBuffers(1, &starsPipeline_.indirectBuffer);
+    glDeleteVertexArrays(1, &starsPipeline_.culledVao);
+    FALL_ON_GL_ERROR();
+  }
+  if (starsPipeline_.cullProgramme)
+    glDeleteProgram(starsPipeline_.cullProgramme);
+
+#if defined(__linux__)
+  if (eglDisplay_) {
+    eglMakeCurrent(eglDisplay_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (eglContext_)
+      eglDestroyContext(eglDisplay_, eglContext_);
+    eglTerminate(eglDisplay_);
+    eglDisplay_ = nullptr;
+    eglContext_ = nullptr;
+  }
+#endif
 
   return {};
 }
 
+gsl::span<Graphics::Star> Graphics::MapStars(std::size_t const count) {
+  for (;;) {
+    if (auto const region = AcquireStarRegion(count); region.Index < kStarRegions) {
+      DrawStarRegion(region.Index, count);
+      return region.Stars;
+    }
+    // Every region is drawn or too small.
+    ReclaimStarRegions(true);
+  }
+}
+
+Graphics::StarRegion Graphics::AcquireStarRegion(std::size_t const count) {
+  auto free = freeStarRegions_.load(std::memory_order_relaxed);
+  unsigned bit;
+  do {
+    if (!free)
+      return {};
+    bit = free & -free;
+  } while (!freeStarRegions_.compare_exchange_weak(free, free & ~bit, std::memory_order_acquire,
+                                                   std::memory_order_relaxed));
+
+  // Regions are replaced only while all of them are free, so not while one is held.
+  auto const &pipeline = starsPipeline_;
+  if (!pipeline.mapped || count > pipeline.regionSize) {
+    wantedStarRegionSize_.store(std::max<std::size_t>(count, 1), std::memory_order_relaxed);
+    ReleaseStarRegion(static_cast<std::size_t>(__builtin_ctz(bit)));
+    return {};
+  }
+
+  auto const index = static_cast<std::size_t>(__builtin_ctz(bit));
+  return {index, {pipeline.mapped + index * pipeline.regionSize, static_cast<std::ptrdiff_t>(count)}};
+}
+
+void Graphics::DrawStarRegion(std::size_t const index, std::size_t const count) {
+  auto &pipeline = starsPipeline_;
+  if (pipeline.region < kStarRegions && pipeline.region != index) {
+    // A region never drawn is free at once.
+    if (pipeline.fences[pipeline.region])
+      pipeline.retired |= 1u << pipeline.region;
+    else
+      ReleaseStarRegion(pipeline.region);
+  }
+
+  pipeline.region = index;
+  size_ = index < kStarRegions ? count : 0;
+  pipeline.first = index < kStarRegions ? index * pipeline.regionSize : 0;
+}
+
+void Graphics::ReclaimStarRegions(bool const wait) {
+  auto &pipeline = starsPipeline_;
+  for (std::size_t i = 0; i < kStarRegions; ++i) {
+    if (!(pipeline.retired & (1u << i)))
+      continue;
+    auto &fence = pipeline.fences[i];
+    GLenum status;
+    do {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1'000'000'000 : 0);
+    } while (wait && status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_WAIT_FAILED) {
+      PANIC_ON_GL_ERROR;
+    }
+    if (status == GL_TIMEOUT_EXPIRED)
+      continue;
+    glDeleteSync(fence);
+    fence = nullptr;
+    pipeline.retired &= ~(1u << i);
+    ReleaseStarRegion(i);
+  }
+
+  if (wantedStarRegionSize_.load(std::memory_order_relaxed) > pipeline.regionSize)
+    GrowStarRegions();
+}
+
+void Graphics::GrowStarRegions() {
+  auto &pipeline = starsPipeline_;
+  auto const drawn = pipeline.region < kStarRegions ? 1u << pipeline.region : 0u;
+
+  // Taking every region the render thread does not hold keeps other threads
+  // from taking one while the buffer is replaced.
+  auto expected = kAllStarRegions & ~(drawn | pipeline.retired);
+  if (!freeStarRegions_.compare_exchange_strong(expected, 0, std::memory_order_acquire,
+                                                std::memory_order_relaxed))
+    return;
+
+  std::vector<Star> stars;
+  if (drawn)
+    stars.assign(pipeline.mapped + pipeline.first, pipeline.mapped + pipeline.first + size_);
+
+  // Half as much again, so that a growing number of stars seldom reallocates.
+  auto const count = wantedStarRegionSize_.load(std::memory_order_relaxed);
+  AllocateStarRegions(count + count / 2);
+
+  // Stars drawn are drawn from the first region until others are.
+  std::copy(stars.begin(), stars.end(), pipeline.mapped);
+  pipeline.region = drawn ? 0 : kStarRegions;
+  freeStarRegions_.store(kAllStarRegions & ~(drawn ? 1u : 0u), std::memory_order_release);
+}
+
+void Graphics::AllocateStarRegions(std::size_t const count) {
+  ReleaseStarRegions();
+
+  // Storage of a buffer cannot be respecified, so the buffer is replaced.
+  // OpenGL deletes the old one once the GPU is done drawing from it.
+  glDeleteBuffers(1, &starsPipeline_.vbo);
+  glGenBuffers(1, &starsPipeline_.vbo);
+  if (!starsPipeline_.vao)
+    glGenVertexArrays(1, &starsPipeline_.vao);
+  glBindVertexArray(starsPipeline_.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, starsPipeline_.vbo);
+
+  // Coherent, so stars written reach draws issued after without flushing.
+  GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  auto const size = static_cast<GLsizeiptr>(kStarRegions * count * sizeof(Star));
+  glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+  starsPipeline_.mapped = static_cast<Star *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+  PANIC_ON_GL_ERROR;
+  starsPipeline_.regionSize = count;
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+  PANIC_ON_GL_ERROR;
+}
+
+void Graphics::ReleaseStarRegions() {
+  for (auto &fence : starsPipeline_.fences) {
+    if (fence)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (starsPipeline_.mapped) {
+    glBindBuffer(GL_ARRAY_BUFFER, starsPipeline_.vbo);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    starsPipeline_.mapped = nullptr;
+  }
+  starsPipeline_.regionSize = 0;
+  starsPipeline_.region = kStarRegions;
+  starsPipeline_.first = 0;
+  starsPipeline_.retired = 0;
+}
+
+void Graphics::AllocateCulledStars() {
+  auto &pipeline = starsPipeline_;
+  if (!pipeline.culledVbo) {
+    glGenBuffers(1, &pipeline.culledVbo);
+    glGenBuffers(1, &pipeline.indirectBuffer);
+    glGenVertexArrays(1, &pipeline.culledVao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pipeline.indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, 4 * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    PANIC_ON_GL_ERROR;
+  }
+
+  // Written and read by the GPU alone.
+  glBindVertexArray(pipeline.culledVao);
+  glBindBuffer(GL_ARRAY_BUFFER, pipeline.culledVbo);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(pipeline.staticSize * sizeof(Star)), nullptr,
+               GL_DYNAMIC_COPY);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+  PANIC_ON_GL_ERROR;
+}
+
+void Graphics::CullStaticStars(Mat<4, 4, GLfloat> const &camera) {
+  static constexpr GLuint kGroupSize = 256;
+  static constexpr GLuint kMaxGroups = 65535;
+  auto &pipeline = starsPipeline_;
+
+  auto const count = static_cast<GLuint>(pipeline.staticSize);
+  glProgramUniformMatrix4fv(pipeline.cullProgramme, pipeline.cullModelToWorldMatrix, 1, GL_FALSE, &camera[0][0]);
+  glProgramUniformMatrix3fv(pipeline.cullProgramme, pipeline.cullSkyRotation, 1, GL_TRUE,
+                            &pipeline.staticRotation[0][0]);
+  glProgramUniform1ui(pipeline.cullProgramme, pipeline.cullStarCount, count);
+  glProgramUniform1f(pipeline.cullProgramme, pipeline.cullMaxPointSize, pipeline.maxPointSize);
+
+  // No stars are drawn until the shader counts them in.
+  GLuint const command[] = {0, 1, 0, 0};
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pipeline.indirectBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), command);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pipeline.staticVbo);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, pipeline.culledVbo);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, pipeline.indirectBuffer);
+
+  glUseProgram(pipeline.cullProgramme);
+  auto const groups = (count + kGroupSize - 1) / kGroupSize;
+  auto const columns = std::min(groups, kMaxGroups);
+  glDispatchCompute(columns, (groups + columns - 1) / columns, 1);
+  // The draw reads the stars as vertices and the count as a command.
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+  PANIC_ON_GL_ERROR;
+}
+
 OglFallible<> Graphics::LoadShaders() {
   auto vertexShader   = LoadFile("the/lib/ui/shaders/vertex.glsl");
   auto fragmentShader = LoadFile("the/lib/ui/shaders/fragment.glsl");
@@ -91,6 +401,34 @@ OglFallible<> Graphics::LoadShaders() {
 
   starsPipeline_.programme = starsPipeline_.shader.Programme();
   starsPipeline_.modelToWorldMatrix = glGetUniformLocation(starsPipeline_.programme, "modelToWorldMatrix");
+  starsPipeline_.skyRotation        = glGetUniformLocation(starsPipeline_.programme, "skyRotation");
+
+  if (computeCulling_) {
+    if (auto rv = LoadCullShader(); !rv) {
+      WARN() << "drawing every static star, as the compute shader culling them failed to build: " << rv.Err();
+      computeCulling_ = false;
+    } else {
+      INFO() << "culling static stars with a compute shader";
+    }
+  }
+
+  return {};
+}
+
+OglFallible<> Graphics::LoadCullShader() {
+  auto cullShader = LoadFile("the/lib/ui/shaders/cull.comp.glsl");
+  auto &pipeline = starsPipeline_;
+
+  if (auto rv = pipeline.cullShader.CompileCompute(cullShader); !rv)
+    return rv;
+  if (auto rv = pipeline.cullShader.LinkProgramme(); !rv)
+    return rv;
+
+  pipeline.cullProgramme          = pipeline.cullShader.Programme();
+  pipeline.cullModelToWorldMatrix = glGetUniformLocation(pipeline.cullProgramme, "modelToWorldMatrix");
+  pipeline.cullSkyRotation        = glGetUniformLocation(pipeline.cullProgramme, "skyRotation");
+  pipeline.cullStarCount          = glGetUniformLocation(pipeline.cullProgramme, "starCount");
+  pipeline.cullMaxPointSize       = glGetUniformLocation(pipeline.cullProgramme, "maxPointSize");
 
   return {};
 }
@@ -101,6 +439,9 @@ OglFallible<> Graphics::Loop() {
   static constexpr auto perfectFps = 60u;
   static constexpr auto frameTimeslice = 1s / perfectFps;
 
+  if (headless_)
+    return LoopHeadless();
+
   while (!glfwWindowShouldClose(window_)) {
     auto const renderingAt = std::chrono::steady_clock::now();
 
@@ -139,6 +480,65 @@ OglFallible<> Graphics::Loop() {
   return {};
 }
 
+OglFallible<> Graphics::LoopHeadless() {
+  auto const startedAt = std::chrono::steady_clock::now();
+  for (unsigned frame = 0; frame < headlessFrames_; ++frame) {
+    auto const renderingAt = std::chrono::steady_clock::now();
+
+    if (auto rv = HandleInput(); !rv) {
+      ERROR() << "failed to handle the input: " << rv.Err();
+    }
+
+    glViewport(0, 0, windowWidth_, windowHeight_);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    FALL_ON_GL_ERROR();
+
+    if (auto rv = Render(); !rv) {
+      ERROR() << "failed to render a frame: " << rv.Err();
+    }
+
+    // Nothing is swapped, so waiting for the GPU is what makes a frame take its time.
+    if (!dumpDir_.empty()) {
+      if (auto rv = DumpFrame(frame); !rv)
+        return rv;
+    } else {
+      glFinish();
+    }
+    FALL_ON_GL_ERROR();
+
+    lastFrameTook_ = std::chrono::steady_clock::now() - renderingAt;
+  }
+
+  auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count();
+  INFO() << headlessFrames_ << " frames of " << windowWidth_ << 'x' << windowHeight_
+         << " rendered offscreen in " << seconds << " s, "
+         << double(headlessFrames_) / seconds << " frames per second";
+
+  return {};
+}
+
+OglFallible<> Graphics::DumpFrame(unsigned const frame) {
+  auto const width  = static_cast<std::size_t>(windowWidth_);
+  auto const height = static_cast<std::size_t>(windowHeight_);
+  std::vector<unsigned char> pixels(width * height * 3);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, windowWidth_, windowHeight_, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+  FALL_ON_GL_ERROR();
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "/frame-%06u.ppm", frame);
+  auto const fpath = dumpDir_ + name;
+  std::ofstream os(fpath, std::ios::binary);
+  // Rows are read from the bottom up.
+  os << "P6\n" << width << ' ' << height << "\n255\n";
+  for (auto row = height; row-- > 0;)
+    os.write(reinterpret_cast<char const *>(pixels.data() + row * width * 3), static_cast<std::streamsize>(width * 3));
+  if (!os)
+    return {RuntimeError{"could not write the frame " + fpath}};
+
+  return {};
+}
+
 void Graphics::OnGlfwWindowSizeCallback_(GLFWwindow *window, int width, int height) {
   glfwGetFramebufferSize(window, &width, &height);
   // auto const dim = std::min(width, height);
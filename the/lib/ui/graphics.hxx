@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <functional>
+#include <limits>
+#include <string>
 #include <gsl.h>
 
 #include <GL/glew.h>
@@ -23,46 +27,169 @@ struct Graphics {
     float mag;
   };
 
+  /// Regions of the streamed star buffer, see AcquireStarRegion: one written,
+  /// one waiting to be drawn, one drawn and one the GPU may still be reading.
+  static constexpr std::size_t kStarRegions = 4;
+  static constexpr unsigned kAllStarRegions = (1u << kStarRegions) - 1;
+
+  /// Region of the streamed star buffer, Index kStarRegions if none.
+  struct StarRegion {
+    std::size_t Index = kStarRegions;
+    gsl::span<Star> Stars;
+  };
+
   struct StarsPipeline {
     Shader shader;
     GLuint programme;
-    GLuint vbo;
-    GLuint vao;
+    GLuint vbo = 0;
+    GLuint vao = 0;
+    /// Stars the buffer holds per region, when it is persistently mapped.
+    std::size_t regionSize = 0;
+    /// Region drawn, kStarRegions if none, and the first vertex of it.
+    std::size_t region = kStarRegions;
+    std::size_t first = 0;
+    Star   *mapped = nullptr;
+    /// Signalled once the GPU has drawn a region.
+    GLsync  fences[kStarRegions] = {};
+    /// Regions drawn before, a bit each, freed once their fences are signalled.
+    unsigned retired = 0;
     GLuint modelToWorldMatrix;
+    GLuint skyRotation;
+    /// Stars uploaded once and rotated by skyRotation in the vertex shader.
+    GLuint staticVbo = 0;
+    GLuint staticVao = 0;
+    std::size_t staticSize = 0;
+    Mat3f  staticRotation = Mat3f::Id();
+    /// Compute programme culling static stars, see SetComputeCulling.
+    Shader cullShader;
+    GLuint cullProgramme = 0;
+    GLint  cullModelToWorldMatrix;
+    GLint  cullSkyRotation;
+    GLint  cullStarCount;
+    GLint  cullMaxPointSize;
+    /// Static stars the programme kept, rotated, and the command drawing them.
+    GLuint culledVbo = 0;
+    GLuint culledVao = 0;
+    GLuint indirectBuffer = 0;
+    float  maxPointSize = std::numeric_limits<float>::infinity();
   };
 
   virtual OglFallible<> Init();
   virtual OglFallible<> Deinit();
 
+  /// Makes Init render into a framebuffer of a surfaceless EGL context instead
+  /// of a window, so that rendering runs on hosts without a display or a GPU,
+  /// e.g. with Mesa llvmpipe. Loop then renders the number of frames as fast
+  /// as it can, logs the rate and returns. Frames are written into dumpDir as
+  /// PPM images, unless it is empty.
+  void SetHeadless(unsigned frames, std::string dumpDir = {}) {
+    headless_ = true;
+    headlessFrames_ = frames;
+    dumpDir_ = std::move(dumpDir);
+  }
+
+  /// Makes static stars culled on the GPU: a compute shader rotates them, leaves
+  /// out those off the view or fainter than SetMaxPointSize and compacts the
+  /// rest into a buffer drawn by an indirect draw it writes the count of, so
+  /// the CPU never sees them. It takes OpenGL 4.3; without it, or if the shader
+  /// fails to build, every static star is drawn. Off by default, as GPUs draw
+  /// points off the view cheaply and renderers in software, such as llvmpipe,
+  /// run compute shaders slower than they clip; to be called before Init.
+  void SetComputeCulling(bool const enabled) {
+    computeCulling_ = enabled;
+  }
+
+  /// Tells whether static stars are culled by the compute shader.
+  bool ComputeCulling() const { return computeCulling_; }
+
+  /// Sets the size of points of the faintest static stars drawn when they are
+  /// culled by the compute shader; points of fainter stars are larger.
+  void SetMaxPointSize(float const size) {
+    starsPipeline_.maxPointSize = size;
+  }
+
   void LoadStars(gsl::span<Star const> const &stars) {
+    if (!starsPipeline_.vbo) {
+      glGenBuffers(1, &starsPipeline_.vbo);
+      glGenVertexArrays(1, &starsPipeline_.vao);
+      PANIC_ON_GL_ERROR;
+    }
+    UpdateStars(stars);
+  }
+
+  void UpdateStars(gsl::span<Star const> const &stars) {
+    if (streamStars_) {
+      auto const out = MapStars(stars.size());
+      std::copy(stars.begin(), stars.end(), out.begin());
+      return;
+    }
+
     size_ = stars.size();
-    glGenBuffers(1, &starsPipeline_.vbo);
-    PANIC_ON_GL_ERROR;
-    // glBindBuffer(GL_ARRAY_BUFFER, starsPipeline_.vbo);
-    // PANIC_ON_GL_ERROR;
-    // glBufferData(GL_ARRAY_BUFFER,
-    //              stars.size_bytes(), reinterpret_cast<GLfloat const *>(stars.data()),
-    //              GL_DYNAMIC_DRAW);
-    // PANIC_ON_GL_ERROR;
-
-    glGenVertexArrays(1, &starsPipeline_.vao);
+    starsPipeline_.first = 0;
     glBindVertexArray(starsPipeline_.vao);
-    glEnableVertexAttribArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, starsPipeline_.vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 stars.size_bytes(), reinterpret_cast<GLfloat const *>(stars.data()),
+                 GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
     PANIC_ON_GL_ERROR;
   }
 
-  void UpdateStars(gsl::span<Star const> const &stars) {
-    size_ = stars.size();
-    glBindBuffer(GL_ARRAY_BUFFER, starsPipeline_.vbo);
-    PANIC_ON_GL_ERROR;
-    // glBufferSubData(GL_ARRAY_BUFFER, 0,
-    //                 stars.size_bytes(), reinterpret_cast<GLfloat const *>(stars.data()));
+  /// Tells whether MapStars can be used, which takes OpenGL 4.4 or ARB_buffer_storage.
+  bool StreamsStars() const { return streamStars_; }
+
+  /// Returns memory for count stars drawn by the next RenderStars, in place of
+  /// those given before, waiting for the GPU to be done with a region if none
+  /// is free. Not to be used while other threads hold regions.
+  /// The memory is valid until the next call.
+  gsl::span<Star> MapStars(std::size_t count);
+
+  /// Takes a free region of the streamed star buffer for count stars. The
+  /// regions are a ring of kStarRegions in a buffer mapped for good, so any
+  /// thread may take one and write stars into it, without calling OpenGL, and
+  /// the stars reach the GPU without a copy while it draws from the others.
+  /// Returns no region if none is free, or if the regions are too small, in
+  /// which case RenderStars makes them larger once they are all free again.
+  /// A region taken is drawn once handed to DrawStarRegion, and freed
+  /// by ReleaseStarRegion if it never is.
+  StarRegion AcquireStarRegion(std::size_t count);
+
+  /// Frees a region taken and never drawn, from any thread.
+  void ReleaseStarRegion(std::size_t const index) {
+    freeStarRegions_.fetch_or(1u << index, std::memory_order_release);
+  }
+
+  /// Makes RenderStars draw count stars of a region taken, or none if index
+  /// is kStarRegions, in place of the region drawn before, which is freed
+  /// once the GPU is done with it.
+  void DrawStarRegion(std::size_t index, std::size_t count);
+
+  /// Uploads stars that do not move relative to each other once.
+  /// They are drawn every frame after rotating them by the matrix set with SetSkyRotation,
+  /// so their cost per frame does not depend on their number.
+  void LoadStaticStars(gsl::span<Star const> const &stars) {
+    if (!starsPipeline_.staticVbo) {
+      glGenBuffers(1, &starsPipeline_.staticVbo);
+      glGenVertexArrays(1, &starsPipeline_.staticVao);
+      PANIC_ON_GL_ERROR;
+    }
+    starsPipeline_.staticSize = stars.size();
+    glBindVertexArray(starsPipeline_.staticVao);
+    glBindBuffer(GL_ARRAY_BUFFER, starsPipeline_.staticVbo);
     glBufferData(GL_ARRAY_BUFFER,
                  stars.size_bytes(), reinterpret_cast<GLfloat const *>(stars.data()),
-                 GL_DYNAMIC_DRAW);
+                 GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
     PANIC_ON_GL_ERROR;
+    if (computeCulling_)
+      AllocateCulledStars();
+  }
+
+  /// Sets a rotation of static stars into the frame stars given to UpdateStars are in.
+  void SetSkyRotation(Mat3f const &rotation) {
+    starsPipeline_.staticRotation = rotation;
   }
 
   static Mat<4, 4, GLfloat> ComputeCameraMatrix() {
@@ -90,9 +217,31 @@ struct Graphics {
     glProgramUniformMatrix4fv(starsPipeline_.programme, starsPipeline_.modelToWorldMatrix, 1, GL_FALSE, &mat[0][0]);
     PANIC_ON_GL_ERROR;
 
+    bool const culled = computeCulling_ && starsPipeline_.staticSize > 0;
+    if (culled)
+      CullStaticStars(mat);
+
     glUseProgram(starsPipeline_.programme);
     PANIC_ON_GL_ERROR;
 
+    auto const id = Mat3f::Id();
+    if (culled) {
+      // The compute shader has rotated the stars, and counted them into the command.
+      glProgramUniformMatrix3fv(starsPipeline_.programme, starsPipeline_.skyRotation, 1, GL_TRUE, &id[0][0]);
+      glBindVertexArray(starsPipeline_.culledVao);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, starsPipeline_.indirectBuffer);
+      glDrawArraysIndirect(GL_POINTS, nullptr);
+      PANIC_ON_GL_ERROR;
+    } else if (starsPipeline_.staticSize > 0) {
+      // Rows of the matrix are consecutive, so it is transposed on the way.
+      glProgramUniformMatrix3fv(starsPipeline_.programme, starsPipeline_.skyRotation, 1, GL_TRUE,
+                                &starsPipeline_.staticRotation[0][0]);
+      glBindVertexArray(starsPipeline_.staticVao);
+      glDrawArrays(GL_POINTS, 0, GLuint(starsPipeline_.staticSize));
+      PANIC_ON_GL_ERROR;
+    }
+
+    glProgramUniformMatrix3fv(starsPipeline_.programme, starsPipeline_.skyRotation, 1, GL_TRUE, &id[0][0]);
     glBindVertexArray(starsPipeline_.vao);
     PANIC_ON_GL_ERROR;
 
@@ -106,8 +255,19 @@ struct Graphics {
 
     // Draw points 0-3 from the currently bound VAO with current in-use shader.
     // glPointSize(2.5f);
-    glDrawArrays(GL_POINTS, 0, GLuint(size_));
+    glDrawArrays(GL_POINTS, GLint(starsPipeline_.first), GLuint(size_));
     PANIC_ON_GL_ERROR;
+
+    if (starsPipeline_.mapped && starsPipeline_.region < kStarRegions) {
+      // A fence of the region drawn again is superseded.
+      auto &fence = starsPipeline_.fences[starsPipeline_.region];
+      if (fence)
+        glDeleteSync(fence);
+      fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      PANIC_ON_GL_ERROR;
+    }
+    if (streamStars_)
+      ReclaimStarRegions(false);
   }
 
   OglFallible<> LoadShaders();
@@ -127,13 +287,45 @@ struct Graphics {
 
 
  protected:
+  OglFallible<> InitWindow();
+  OglFallible<> InitHeadless();
+  OglFallible<> LoopHeadless();
+  /// Writes the frame rendered offscreen into dumpDir_.
+  OglFallible<> DumpFrame(unsigned frame);
+
   static void OnGlfwWindowSizeCallback_(GLFWwindow *window, int width, int height);
   static void OnGlfwErrorCallback_(int error, char const *description);
 
-  GLFWwindow *window_;
-  std::size_t size_;
+  /// Makes the star buffer persistently mapped storage of kStarRegions regions of
+  /// at least count stars each.
+  void AllocateStarRegions(std::size_t count);
+  void ReleaseStarRegions();
+  /// Frees regions drawn before the GPU is done with, waiting for it if wait
+  /// is set, then makes the regions larger if they were too small for stars.
+  void ReclaimStarRegions(bool wait);
+  /// Replaces the regions with ones as large as wanted, keeping the stars
+  /// drawn, unless a region is held by another thread.
+  void GrowStarRegions();
+
+  /// Makes the buffers the compute shader culls static stars into as large as the static buffer.
+  void AllocateCulledStars();
+  /// Builds the compute programme culling static stars.
+  OglFallible<> LoadCullShader();
+  /// Dispatches the compute shader culling static stars to the view of the camera matrix.
+  void CullStaticStars(Mat<4, 4, GLfloat> const &camera);
+
+  /// Null when headless.
+  GLFWwindow *window_ = nullptr;
+  std::size_t size_ = 0;
 
   StarsPipeline starsPipeline_;
+  bool streamStars_ = false;
+  bool computeCulling_ = false;
+  /// Regions of the star buffer no thread holds, a bit each, cleared as
+  /// regions are taken and set as they are freed.
+  std::atomic<unsigned> freeStarRegions_{kAllStarRegions};
+  /// Stars the regions were last found too small for.
+  std::atomic<std::size_t> wantedStarRegionSize_{0};
 
   static int windowWidth_;
   static int windowHeight_;
@@ -141,6 +333,16 @@ struct Graphics {
  private:
   std::chrono::steady_clock::duration lastFrameTook_ = std::chrono::seconds{1};
   bool glfwInitialized_ = false;
+
+  bool        headless_ = false;
+  unsigned    headlessFrames_ = 0;
+  std::string dumpDir_;
+  /// EGLDisplay and EGLContext, kept opaque to spare includers EGL headers.
+  void       *eglDisplay_ = nullptr;
+  void       *eglContext_ = nullptr;
+  /// Framebuffer frames are rendered into when headless, and its renderbuffers.
+  GLuint      framebuffer_ = 0;
+  GLuint      renderbuffers_[2] = {};
 };
 
 }
@@ -46,6 +46,7 @@ Shader::Shader() {
 Shader::~Shader() {
   glDeleteShader(vertexShader_);
   glDeleteShader(fragmentShader_);
+  glDeleteShader(computeShader_);
 }
 
 OglFallible<> Shader::CompileVertex(gsl::span<char const> shaderSource) {
@@ -78,13 +79,30 @@ OglFallible<> Shader::CompileFragment(gsl::span<char const> shaderSource) {
   return {};
 }
 
+OglFallible<> Shader::CompileCompute(gsl::span<char const> shaderSource) {
+  if (computeShader_) {
+    glDeleteShader(computeShader_);
+    computeShader_ = 0;
+  }
+
+  if (auto rv = CompileShader(GL_COMPUTE_SHADER, shaderSource); !rv) {
+    return rv;
+  } else {
+    computeShader_ = *rv;
+  }
+
+  return {};
+}
+
 OglFallible<> Shader::LinkProgramme() {
   GLuint programme = glCreateProgram();
   FALL_ON_GL_ERROR();
-  glAttachShader(programme, fragmentShader_);
-  FALL_ON_GL_ERROR();
-  glAttachShader(programme, vertexShader_);
-  FALL_ON_GL_ERROR();
+  for (auto const shader : {fragmentShader_, vertexShader_, computeShader_}) {
+    if (!shader)
+      continue;
+    glAttachShader(programme, shader);
+    FALL_ON_GL_ERROR();
+  }
   glLinkProgram(programme);
   FALL_ON_GL_ERROR();
 
@@ -14,6 +14,9 @@ struct Shader final {
 
   OglFallible<> CompileVertex(gsl::span<char const> shaderSource);
   OglFallible<> CompileFragment(gsl::span<char const> shaderSource);
+  /// Compiles a compute shader, which takes OpenGL 4.3, to be linked alone.
+  OglFallible<> CompileCompute(gsl::span<char const> shaderSource);
+  /// Links the shaders compiled.
   OglFallible<> LinkProgramme();
   OglFallible<> UsingProgramme(std::function<OglFallible<> ()> const fn) const;
 
@@ -22,6 +25,7 @@ struct Shader final {
  private:
   GLuint vertexShader_   = 0;
   GLuint fragmentShader_ = 0;
+  GLuint computeShader_  = 0;
   GLuint programme_      = 0;
   GLuint vbo_;
   GLuint vao_;
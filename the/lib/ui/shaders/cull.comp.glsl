@@ -0,0 +1,68 @@
+#version 430 core
+
+// Rotates the static stars into the model frame, and appends those in the view
+// and not fainter than the limit to the culled stars, counting them in the
+// command of the indirect draw that draws the culled stars.
+
+layout (local_size_x = 256) in;
+
+struct DrawArraysIndirectCommand {
+  uint count;
+  uint instanceCount;
+  uint first;
+  uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer StaticStars {
+  vec4 stars[];
+};
+layout (std430, binding = 1) writeonly buffer CulledStars {
+  vec4 culled[];
+};
+layout (std430, binding = 2) buffer Command {
+  DrawArraysIndirectCommand command;
+};
+
+uniform mat4 modelToWorldMatrix = mat4(1.0);
+uniform mat3 skyRotation = mat3(1.0);
+uniform uint starCount = 0;
+// Stars of larger points, i.e. fainter, are culled.
+uniform float maxPointSize = 3.4e38;
+// Points reach beyond their centres, so they are kept within a margin
+// of the view, in parts of the half width of it.
+uniform float margin = 0.05;
+
+shared uint groupCount;
+shared uint groupFirst;
+
+void main() {
+  // Groups of a dispatch are laid out in rows, as a row has 65535 of them at most.
+  uint i = (gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x) * gl_WorkGroupSize.x +
+           gl_LocalInvocationIndex;
+
+  bool keep = false;
+  vec4 star;
+  if (i < starCount) {
+    star = stars[i];
+    star.xyz = skyRotation * star.xyz;
+    vec4 clip = modelToWorldMatrix * vec4(star.xyz, 1.0);
+    float bound = clip.w * (1.0 + margin);
+    keep = star.w <= maxPointSize && clip.w > 0.0 && abs(clip.x) <= bound && abs(clip.y) <= bound;
+  }
+
+  // A group reserves room for its survivors with one atomic on the command
+  // rather than one per star.
+  if (gl_LocalInvocationIndex == 0)
+    groupCount = 0;
+  barrier();
+  uint slot = 0;
+  if (keep)
+    slot = atomicAdd(groupCount, 1);
+  barrier();
+  if (gl_LocalInvocationIndex == 0)
+    groupFirst = atomicAdd(command.count, groupCount);
+  barrier();
+
+  if (keep)
+    culled[groupFirst + slot] = star;
+}
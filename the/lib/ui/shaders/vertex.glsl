@@ -1,6 +1,9 @@
 #version 400 core
 
 uniform mat4 modelToWorldMatrix = mat4(1.0);
+// Rotates stars given in the equatorial frame into the model frame.
+// Stars rotated on the CPU are drawn with the identity.
+uniform mat3 skyRotation = mat3(1.0);
 
 // layout (location = 0) in VS_IN {
 //   vec3 vp;
@@ -54,7 +57,7 @@ void main() {
   // );
   // mat4 view = cam * trans;
 
-  gl_Position = modelToWorldMatrix * vec4(vp.x, vp.y, vp.z, 1.0);
+  gl_Position = modelToWorldMatrix * vec4(skyRotation * vp.xyz, 1.0);
   gl_PointSize = vp.w;//mag;
   // vs_out.color = color;
 }
@@ -1,12 +1,82 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <iomanip>
+#include <vector>
 
-#include "lib/consts.hxx"
-#include "lib/sun.hxx"
-#include "lib/time.hxx"
+#include "the/lib/common/consts.hxx"
+#include "the/lib/common/logging.hxx"
+#include "the/lib/common/sun.hxx"
+#include "the/lib/common/suntable.hxx"
+#include "the/lib/common/textbuffer.hxx"
+#include "the/lib/common/threadpool.hxx"
+#include "the/lib/common/time.hxx"
 
-int main() {
+namespace {
+
+/// Rows a thread computes and formats at a time.
+std::size_t constexpr kChunkRows = 16384;
+
+void PrintUsage(char const *argv0) {
+  std::cerr << "Usage: " << argv0 << " [-b] [-j THREADS] [-o OUTPUT] BEGIN END STEP\n"
+            << "Writes a table of the sun from BEGIN to END every STEP, or prints where it is now.\n"
+            << "BEGIN and END are MJD or YYYY-MM-DD[THH:MM[:SS]] of UTC; STEP is days,\n"
+            << "or a number suffixed by s, m, h or d.\n"
+            << "Rows are MJD, ecliptic L, B and R in AU, and RA and Dec of date, in degrees.\n"
+            << "  -b  write binary SunRow records after a SunTableHeader rather than CSV\n"
+            << "  -j  compute on THREADS threads (default: one per core)\n"
+            << "  -o  write to OUTPUT rather than stdout\n";
+}
+
+bool ParseEpoch(char const *str, double &mjd) {
+  int year, month, day, length = 0;
+  if (std::sscanf(str, "%d-%d-%d%n", &year, &month, &day, &length) == 3 && str[length] != '.') {
+    int hour = 0, minute = 0;
+    double second = 0.0;
+    char const *rest = str + length;
+    if (*rest == 'T' || *rest == ' ') {
+      if (std::sscanf(rest + 1, "%d:%d%n", &hour, &minute, &length) != 2)
+        return false;
+      rest += 1 + length;
+      if (*rest == ':') {
+        if (std::sscanf(rest + 1, "%lf%n", &second, &length) != 1)
+          return false;
+        rest += 1 + length;
+      }
+    }
+    mjd = the::MJD(year, month, day, hour, minute, second);
+    return *rest == '\0' || (*rest == 'Z' && rest[1] == '\0');
+  }
+  char *end;
+  mjd = std::strtod(str, &end);
+  return end != str && *end == '\0';
+}
+
+bool ParseStep(char const *str, double &days) {
+  char *end;
+  days = std::strtod(str, &end);
+  if (end == str)
+    return false;
+  if (*end != '\0') {
+    if (end[1] != '\0')
+      return false;
+    switch (*end) {
+      case 's': days /= 86400.0; break;
+      case 'm': days /= 1440.0;  break;
+      case 'h': days /= 24.0;    break;
+      case 'd': break;
+      default:  return false;
+    }
+  }
+  return days > 0.0 && std::isfinite(days);
+}
+
+void PrintNow() {
   std::time_t const now = std::time(nullptr);
   std::tm tm = *std::gmtime(&now);
   double const epoch = the::MJD(tm.tm_year + 1900, tm.tm_mon+1, tm.tm_mday,
@@ -26,18 +96,137 @@ int main() {
   std::cout << "         o  '  \"             o  '  \"" << std::endl;
   std::cout << "  L = " << std::setprecision(2) << std::setw(12)
             << the::kDeg * sunPolar.Phi;
-  std::cout << "    B = " << std::setprecision(1) << std::showpos << std::setw(11) 
+  std::cout << "    B = " << std::setprecision(1) << std::showpos << std::setw(11)
             << the::kDeg * sunPolar.Theta << std::noshowpos;
 
   // Equator
   // std::cout << "         h  m  s               o  '  \"" << std::endl;
   // std::cout << "  RA = " << std::setprecision(2) << std::setw(11)
   // << Angle(the::kDeg*m_R[phi]/15.0,DMMSSs);
-  // std::cout << "    Dec = " << std::setprecision(1) << std::showpos << std::setw(11) 
+  // std::cout << "    Dec = " << std::setprecision(1) << std::showpos << std::setw(11)
   // << Angle(the::kDeg*m_R[theta],DMMSSs) << std::noshowpos;
 
-  std::cout << "    R = " << std::setprecision(8) << std::setw(12) 
+  std::cout << "    R = " << std::setprecision(8) << std::setw(12)
             << sunPolar.R << std::endl;
+}
+
+/// Buffers of a chunk of rows, allocated once and reused by every wave.
+struct Chunk {
+  std::vector<the::SunRow> Rows;
+  std::vector<char>        Text;
+  std::size_t              Size = 0;
+  /// Some row of the chunk was wider than kSunCsvRowSize.
+  bool                     Overflowed = false;
+};
+
+}
+
+int main(int argc, char *argv[]) {
+  bool binary = false;
+  unsigned threads = 0;
+  char const *output = nullptr;
+  char const *args[3];
+  int nargs = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-b") == 0) {
+      binary = true;
+    } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if ((argv[i][0] != '-' || std::isdigit(static_cast<unsigned char>(argv[i][1]))) && nargs < 3) {
+      args[nargs++] = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (argc == 1) {
+    PrintNow();
+    return 0;
+  }
+
+  double begin, end, step;
+  if (nargs != 3 || !ParseEpoch(args[0], begin) || !ParseEpoch(args[1], end) || !ParseStep(args[2], step) ||
+      end < begin) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  // END is taken in if it is a whole number of steps away, give or take rounding.
+  auto const rows = static_cast<std::size_t>(std::floor((end - begin) / step * (1.0 + 1e-12))) + 1;
+
+  std::FILE *file = output ? std::fopen(output, "wb") : stdout;
+  if (!file) {
+    ERROR() << "could not open " << output;
+    return 1;
+  }
+
+  if (binary) {
+    the::SunTableHeader header = {};
+    std::memcpy(header.Magic, the::kSunTableMagic, sizeof(the::kSunTableMagic));
+    header.Version = the::kSunTableVersion;
+    header.RowSize = sizeof(the::SunRow);
+    header.Rows    = rows;
+    header.Begin   = begin;
+    header.Step    = step;
+    std::fwrite(&header, sizeof(header), 1, file);
+  } else {
+    std::fputs(the::kSunCsvHeader, file);
+  }
+
+  // The range is cut into chunks computed in waves, a few chunks a thread, and
+  // written in order after every wave, so output streams in bounded memory.
+  the::ThreadPool pool{threads};
+  std::vector<Chunk> chunks(2 * pool.Size());
+  for (auto &chunk : chunks) {
+    chunk.Rows.resize(kChunkRows);
+    if (!binary)
+      chunk.Text.resize(kChunkRows * the::kSunCsvRowSize);
+  }
+
+  for (std::size_t first = 0; first < rows; first += chunks.size() * kChunkRows) {
+    auto const count = std::min(chunks.size(), (rows - first + kChunkRows - 1) / kChunkRows);
+    pool.ParallelFor(0, count, 1, [&](std::size_t const from, std::size_t const to) {
+      for (auto c = from; c < to; ++c) {
+        auto &chunk = chunks[c];
+        auto const start = first + c * kChunkRows;
+        auto const size = std::min(kChunkRows, rows - start);
+        the::SunTable(begin, step, start, {chunk.Rows.data(), static_cast<std::ptrdiff_t>(size)});
+        if (binary) {
+          chunk.Size = size * sizeof(the::SunRow);
+          continue;
+        }
+        the::TextBuffer text{{chunk.Text.data(), static_cast<std::ptrdiff_t>(chunk.Text.size())}};
+        chunk.Overflowed = false;
+        for (std::size_t i = 0; i < size && !chunk.Overflowed; ++i) {
+          auto const before = text.size();
+          the::FormatCsv(chunk.Rows[i], text);
+          // A row wider than its share would leave later ones out.
+          chunk.Overflowed = text.Overflowed() || text.size() - before > the::kSunCsvRowSize;
+        }
+        chunk.Size = text.size();
+      }
+    });
+    for (std::size_t c = 0; c < count; ++c) {
+      if (chunks[c].Overflowed) {
+        ERROR() << "rows from " << first + c * kChunkRows << " on are too wide to format";
+        return 1;
+      }
+    }
+    for (std::size_t c = 0; c < count; ++c) {
+      auto const *data = binary ? static_cast<void const *>(chunks[c].Rows.data()) : chunks[c].Text.data();
+      std::fwrite(data, 1, chunks[c].Size, file);
+    }
+  }
+
+  if (std::fflush(file) != 0 || std::ferror(file)) {
+    ERROR() << "could not write " << (output ? output : "stdout");
+    return 1;
+  }
+  if (output)
+    std::fclose(file);
+  INFO() << rows << " rows of the sun written on " << pool.Size() << " threads";
 
   return 0;
 }
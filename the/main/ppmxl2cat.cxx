@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "the/lib/common/catalogue.hxx"
+#include "the/lib/common/logging.hxx"
+#include "the/lib/common/ppmxlingest.hxx"
+#include "the/lib/common/ppmxlparser.hxx"
+#include "the/lib/common/ppmxlreader.hxx"
+#include "the/lib/common/tiles.hxx"
+
+using the::PPMXLColumn;
+using the::PPMXLReader;
+
+namespace {
+
+PPMXLColumn const kDefaultColumns[] = {
+  PPMXLColumn::Ipix,
+  PPMXLColumn::RaJ2000,
+  PPMXLColumn::DecJ2000,
+  PPMXLColumn::PmRA,
+  PPMXLColumn::PmDE,
+  PPMXLColumn::Jmag,
+  PPMXLColumn::Hmag,
+  PPMXLColumn::Kmag,
+};
+
+void PrintUsage(char const *argv0) {
+  std::cerr << "Usage: " << argv0 << " [-c COLUMN,...] [-f COLUMN:MIN:MAX,...] [-n LIMIT] [-t DEPTH] OUTPUT < ppmxl.txt\n"
+            << "Converts pipe-delimited PPMXL rows read from stdin into a binary catalogue.\n"
+            << "The input may be gzip-compressed as well.\n"
+            << "  -c  columns to store (default: Ipix,RaJ2000,DecJ2000,PmRA,PmDE,Jmag,Hmag,Kmag)\n"
+            << "  -f  keep only rows with every COLUMN within [MIN, MAX], e.g. Jmag:0:2.5;\n"
+            << "      an empty bound is open, MIN > MAX on RaJ2000 wraps through 0\n"
+            << "  -n  stop after LIMIT rows\n"
+            << "  -t  sort rows by sky tiles of Q3C DEPTH (0-" << the::kMaxTileDepth << ", "
+            << the::kDefaultTileDepth << " suits the whole PPMXL), then by Jmag within a tile,\n"
+            << "      and write the tile directory to OUTPUT.tiles\n";
+}
+
+bool ParseColumns(char const *list, std::vector<PPMXLColumn> &columns) {
+  std::string const str{list};
+  std::size_t pos = 0;
+  while (pos <= str.size()) {
+    auto const end = std::min(str.find(',', pos), str.size());
+    auto const name = str.substr(pos, end - pos);
+    bool found = false;
+    for (std::size_t i = 0; i < the::kPPMXLColumns; ++i) {
+      auto const column = static_cast<PPMXLColumn>(i);
+      if (name == the::PPMXLColumnName(column)) {
+        columns.push_back(column);
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      ERROR() << "unknown column " << std::quoted(name);
+      return false;
+    }
+    pos = end + 1;
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<PPMXLColumn> columns;
+  std::size_t limit = 0;
+  char const *output = nullptr;
+  the::PPMXLFilter filter;
+  int tileDepth = -1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      if (!ParseColumns(argv[++i], columns))
+        return 1;
+    } else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      auto rv = the::PPMXLFilter::Parse(argv[++i]);
+      if (!rv) {
+        ERROR() << rv.Err();
+        return 1;
+      }
+      filter = *rv;
+    } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      limit = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      tileDepth = std::atoi(argv[++i]);
+      if (tileDepth < 0 || tileDepth > static_cast<int>(the::kMaxTileDepth)) {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (argv[i][0] != '-' && !output) {
+      output = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (!output) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  if (columns.empty())
+    columns.assign(std::begin(kDefaultColumns), std::end(kDefaultColumns));
+  if (tileDepth >= 0) {
+    for (auto const required : {PPMXLColumn::Ipix, PPMXLColumn::RaJ2000, PPMXLColumn::DecJ2000, PPMXLColumn::Jmag}) {
+      if (std::find(columns.begin(), columns.end(), required) == columns.end()) {
+        ERROR() << "tiling needs column " << the::PPMXLColumnName(required);
+        return 1;
+      }
+    }
+  }
+
+  // Tiling reorders rows of a complete catalogue, so rows go to a temporary one first.
+  std::string const target = output;
+  std::string const written = tileDepth >= 0 ? target + ".untiled.tmp" : target;
+
+  std::cin.sync_with_stdio(false);
+  std::cin.tie(nullptr);
+
+  auto writer = the::CatalogueWriter::Create(written.c_str(), {columns.data(), static_cast<std::ptrdiff_t>(columns.size())});
+  if (!writer)
+    the::Panic(writer.Err());
+
+  the::PPMXLColumns mask = 0;
+  for (auto const column : columns)
+    mask |= the::ColumnBit(column);
+
+  the::PPMXLParser const parser{mask, filter};
+  PPMXLReader reader{std::cin, limit};
+  auto const append = [&](PPMXLReader::Row const &row) {
+    writer->Append(row);
+  };
+  the::PPMXLIngestStats stats;
+  // A gzip stream starts with 1f 8b.
+  if (std::cin.peek() == 0x1f) {
+    if (auto rv = reader.ReadGzip(parser, 0, append, &stats); !rv)
+      the::Panic(rv.Err());
+  } else {
+    reader.ReadParallel(parser, 0, append, &stats);
+  }
+  INFO() << "Ingest: " << stats;
+
+  if (auto rv = writer->Finish(); !rv)
+    the::Panic(rv.Err());
+
+  INFO() << writer->Rows() << " rows written to " << written;
+
+  if (tileDepth >= 0) {
+    auto untiled = the::Catalogue::Open(written.c_str());
+    if (!untiled)
+      the::Panic(untiled.Err());
+    if (auto rv = the::WriteTiledCatalogue(*untiled, output, static_cast<unsigned>(tileDepth)); !rv)
+      the::Panic(rv.Err());
+    std::remove(written.c_str());
+    INFO() << "rows sorted by tiles of depth " << tileDepth << " into " << output
+           << ", tile directory written to " << the::TileDirectoryPath(output);
+  }
+
+  return 0;
+}
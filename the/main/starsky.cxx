@@ -1,17 +1,40 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <thread>
 #include <utility>
 
+#include "the/lib/common/catalogue.hxx"
+#include "the/lib/common/compactstar.hxx"
 #include "the/lib/common/consts.hxx"
+#include "the/lib/common/culling.hxx"
+#include "the/lib/common/frames.hxx"
+#include "the/lib/common/lod.hxx"
 #include "the/lib/common/logging.hxx"
+#include "the/lib/common/planets.hxx"
+#include "the/lib/common/ppmxlingest.hxx"
+#include "the/lib/common/ppmxlparser.hxx"
 #include "the/lib/common/ppmxlreader.hxx"
+#include "the/lib/common/precnut.hxx"
+#include "the/lib/common/simdmath.hxx"
 #include "the/lib/common/spheric.hxx"
+#include "the/lib/common/starstore.hxx"
 #include "the/lib/common/sun.hxx"
+#include "the/lib/common/threadpool.hxx"
+#include "the/lib/common/tilecache.hxx"
+#include "the/lib/common/tiles.hxx"
+#include "the/lib/common/triplebuffer.hxx"
 #include "the/lib/common/time.hxx"
 #include "the/lib/common/utils.hxx"
 #include "the/lib/ui/errors.hxx"
@@ -88,6 +111,13 @@ void PrintGraphicsInfo() {
 
 using the::PPMXLReader;
 
+/// Stars a thread of the pool vertexizes at a time.
+std::size_t constexpr kVertexGrain = std::size_t{1} << 14;
+/// Angle in radians out of the view stars are still drawn within, as their points have a size.
+double constexpr kCullMargin = 0.01;
+/// Julian centuries the sun is fitted ahead of the time of the sky, a year.
+double constexpr kSunEphemerisSpan = 1.0 / 100.0;
+
 struct Almanac {
   Almanac()
   {}
@@ -114,11 +144,80 @@ struct Almanac {
 
   void LoadStars(std::istream &is) {
     PPMXLReader reader(is);
-    PPMXLReader::Row data;
-    while (reader >> data) {
-      entries_.push_back(data);
+    the::PPMXLIngestStats stats;
+    auto const sink = [this](PPMXLReader::Row const &data) {
+      entries_.Append(the::CompactStar::FromRow(data));
+    };
+    the::PPMXLParser const parser{the::kCompactPPMXLColumns, filter_};
+    // A gzip stream starts with 1f 8b.
+    if (is.peek() == 0x1f) {
+      if (auto rv = reader.ReadGzip(parser, 0, sink, &stats); !rv)
+        the::Panic(rv.Err());
+    } else {
+      reader.ReadParallel(parser, 0, sink, &stats);
     }
-    INFO() << entries_.size() << " stars loaded from the catalogue";
+    entries_.SortByMagnitude();
+    INFO() << entries_.Size() << " stars loaded from the catalogue";
+    INFO() << "Ingest: " << stats;
+  }
+
+  void LoadStars(gsl::span<char const> text) {
+    the::PPMXLIngestStats stats;
+    the::IngestPPMXL(the::PPMXLParser{the::kCompactPPMXLColumns, filter_}, text, 0, 0, [this](PPMXLReader::Row const &data) {
+      entries_.Append(the::CompactStar::FromRow(data));
+    }, the::kPPMXLChunkSize, &stats);
+    entries_.SortByMagnitude();
+    INFO() << entries_.Size() << " stars loaded from the catalogue";
+    INFO() << "Ingest: " << stats;
+  }
+
+  void LoadStars(the::Catalogue &&catalogue) {
+    catalogue_ = std::move(catalogue);
+    if (catalogue_.RaJ2000().empty() || catalogue_.DecJ2000().empty() || catalogue_.Jmag().empty())
+      the::Panic(the::RuntimeError{"catalogue lacks one of RaJ2000, DecJ2000 or Jmag columns"});
+    if (!filter_.Empty())
+      WARN() << "the filter is not applied to binary catalogues, convert them with ppmxl2cat -f";
+    INFO() << catalogue_.Rows() << " stars mapped from the catalogue";
+  }
+
+  /// Sets the spatial index of the catalogue loaded.
+  void LoadTiles(the::TileIndex &&tiles) {
+    tiles_ = std::move(tiles);
+    lod_ = the::MagnitudeLod{catalogue_, tiles_};
+    INFO() << tiles_.Tiles().size() << " tiles of depth " << tiles_.Depth() << " indexed";
+  }
+
+  /// Reads tiles of the catalogue around the view from the file as it moves,
+  /// keeping at most budget bytes of them, instead of walking every row.
+  void StreamTiles(char const *path, std::size_t const budget) {
+    cache_ = std::make_unique<the::TileCache>(catalogue_, tiles_, budget);
+    if (auto rv = cache_->Start(path); !rv)
+      the::Panic(rv.Err());
+    INFO() << "streaming tiles within " << budget / (1 << 20) << " MB";
+  }
+
+  /// Sets the number of threads vertexizing stars, 0 for one per core.
+  void SetThreads(unsigned const threads) {
+    pool_ = std::make_unique<the::ThreadPool>(threads);
+  }
+
+  /// Leaves out stars fainter than the limit in Jmag.
+  void SetMagnitudeLimit(double const limit) {
+    magnitudeLimit_ = limit;
+  }
+
+  double MagnitudeLimit() const {
+    return magnitudeLimit_;
+  }
+
+  /// Returns the size of points of stars of the magnitude in Jmag.
+  static float JmagPointSize(double const jmag) {
+    return PointSize(jmag / (2.5 / 10.0) + 5.0);
+  }
+
+  /// Sets predicates rows of PPMXL text have to pass to be loaded.
+  void SetFilter(the::PPMXLFilter const &filter) {
+    filter_ = filter;
   }
 
   void SetTime(chrono::system_clock::time_point const &time) {
@@ -130,60 +229,184 @@ struct Almanac {
     viewAngleY_ = viewAngleY;
   }
 
-  void ToggleExtra() {
-    showExtra_ = !showExtra_;
+  /// Draws stars loaded from a static buffer rotated on the GPU, see CatalogueVectors.
+  void SetGpuRotation(bool const enabled) {
+    gpuRotation_ = enabled;
   }
 
-  void VertexizeStars() {
-    Reset();
-
-    auto time = std::time_t(chrono::duration_cast<chrono::seconds>(time_.time_since_epoch()).count());
-    std::tm tm = *std::gmtime(&time);
-    using milliseconds_type = std::chrono::duration<double, std::chrono::milliseconds::period>;
-    auto secs = tm.tm_sec + chrono::duration_cast<milliseconds_type>(time_.time_since_epoch()).count();
-    secs = std::fmod(secs, 1.0);
-    double const mjd = the::MJD(tm.tm_year + 1900, tm.tm_mon+1, tm.tm_mday,
-                                tm.tm_hour, tm.tm_min, secs);
-    double const gmst = the::GMST(mjd) + positionLongitude_;
+  /// Tiles streamed change as the view moves, so they are always rotated on the CPU.
+  bool GpuRotation() const {
+    return gpuRotation_ && !cache_;
+  }
 
-    for (auto const &data : entries_) {
-      // Filter out stars invisible for naked eye.
-      // if (data.Jmag <= 0.0 || data.Jmag >= 2.5)
-      //   continue;
+  /// Returns unit vectors in the equatorial frame of stars loaded, with point sizes,
+  /// to be rotated by SkyRotation.
+  /// The vectors are not kept, as the GPU rotates them from then on.
+  std::vector<Graphics::Star> CatalogueVectors() {
+    PrepareVectors();
+    std::vector<Graphics::Star> stars(vectors_.Size());
+    vectors_.Rotate(the::Mat3f::Id(), Floats(stars));
+    vectors_ = the::StarVectors{};
+    return stars;
+  }
 
-      double ra, delta;
-      ra    = data.RaJ2000 * the::kRad;
-      delta = data.DecJ2000 * the::kRad;
-      // DEBUG("data: ipix=%llu, ra=%lf (%lf), delta=%lf (%lf)\n",
-      //       data.Ipix, data.RaJ2000, ra, data.DecJ2000, delta);
+  /// Returns the rotation of equatorial unit vectors into the frame DrawStar
+  /// projects from: to the true equator of date, to the hour angle at the
+  /// current sidereal time, then by the view.
+  the::Mat3f SkyRotation() const {
+    double const mjd = Mjd();
+    return ToFloat(SkyMatrix(mjd, SiderealTime(mjd)));
+  }
 
-      ProcessStar(gmst - ra, delta, data.Jmag / (2.5 / 10.0) + 5.0);
+  /// Returns SkyRotation at the epoch and local sidereal time.
+  the::Mat3 SkyMatrix(double const mjd, double const lst) const {
+    double const s = std::sin(lst);
+    double const c = std::cos(lst);
+    // (sin(ha) cos(delta), sin(delta), cos(ha) cos(delta)) with ha = lst - ra.
+    the::Mat3 const sidereal{
+        s,  -c, 0.0,
+      0.0, 0.0, 1.0,
+        c,   s, 0.0,
+    };
+    // Taken from the cache of the thread, the simulation's or the render's.
+    auto const precession = the::FrameCache::Shared().At(the::Frame::J2000ToTrue, (mjd - the::kMJD_J2000) / 36525.0);
+    return the::Mat3::RotateY(viewAngleY_) * the::Mat3::RotateX(viewAngleX_) * sidereal * precession;
+  }
 
-      // double const tau = gmst - ra;
+  static the::Mat3f ToFloat(the::Mat3 const &m) {
+    the::Mat3f rotation;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j)
+        rotation[i][j] = float(m[i][j]);
+    }
+    return rotation;
+  }
 
-      // std::cerr << "Star #" << data.Ipix << '\n';
-      // std::cerr << "RA:       " << the::FormatHMS(ra * the::kDeg) << '\t';
-      // std::cerr << "Delta:    " << the::FormatDMS(delta * the::kDeg) << '\n';
+  void SetShowExtra(bool const enabled) {
+    showExtra_ = enabled;
+  }
 
-      // double az, elev;
-      // the::Equ2Hor(delta, tau, positionLatitude_, elev, az);
+  /// Vertexizes stars of the frame into Stars.
+  void VertexizeStars() {
+    VertexizeStars([this](std::size_t const count) {
+      stars_.resize(count);
+      return gsl::span<Graphics::Star>(stars_);
+    });
+  }
 
-      // std::cerr << "Azimuth:  " << the::FormatDMS(az * the::kDeg) << '\t';
-      // std::cerr << "Altitude: " << the::FormatDMS(elev * the::kDeg) << '\n';
-      // std::cerr << '\n';
+  /// Vertexizes stars of the frame into memory allocate(count) returns for
+  /// count stars, such as a region of Graphics::AcquireStarRegion, from the
+  /// threads of the pool.
+  /// Stars out of the view, or below the horizon if cut there, are left out.
+  template <typename Allocate>
+  void VertexizeStars(Allocate &&allocate) {
+    Reset();
 
-      // int x = std::cos(elev) * std::cos(az) * Graphics::WindowWidth()/2;
-      // int y = std::sin(elev) * Graphics::WindowHeight()/2;
-      // std::cerr << "x: " << float{x}/Graphics::WindowWidth()*2.0 << '\t';
-      // std::cerr << "y: " << y << '\n';
-      // std::cerr << '\n';
+    double const mjd = Mjd();
+    double const lst = SiderealTime(mjd);
+    viewRotation_ = the::Mat3::RotateY(viewAngleY_) * the::Mat3::RotateX(viewAngleX_);
+    auto const sky = SkyMatrix(mjd, lst);
+    SetViewPlanes(sky);
+
+    // The few extra stars are drawn first, to know how many stars there are.
+    if (showExtra_)
+      DrawExtras(mjd, lst);
+    auto const extras = static_cast<std::ptrdiff_t>(extras_.size());
+
+    // Pieces of tiles or of vectors_ in the view, their stars numbered consecutively.
+    pieces_.clear();
+    pieceOffsets_.assign(1, 0);
+    if (cache_) {
+      cache_->SetView(ViewAxis(sky), viewRadius_, magnitudeLimit_);
+      auto const tiles = cache_->Resident();
+      MarkTilesInView();
+      for (auto const &tile : tiles) {
+        auto const overlap = overlaps_[tile->Tile];
+        if (overlap == the::SkyOverlap::Outside)
+          continue;
+        // A tile may have been read up to a fainter limit before.
+        auto const end = std::isinf(magnitudeLimit_) ? tile->Mag.end() :
+            std::partition_point(tile->Mag.begin(), tile->Mag.end(), [this](double const m) {
+              return m <= magnitudeLimit_;
+            });
+        AddPiece(tile.get(), 0, static_cast<std::size_t>(end - tile->Mag.begin()), overlap);
+      }
+      for (auto const tile : tilesInView_)
+        overlaps_[tile] = the::SkyOverlap::Outside;
+      VertexizePieces(sky);
+    } else if (!gpuRotation_) {
+      PrepareVectors();
+      if (tileOffsets_.empty()) {
+        AddPiece(nullptr, 0, vectors_.Size(), the::SkyOverlap::Partial);
+      } else {
+        // Stars read from text come before the tiles of the catalogue, in no order.
+        AddPiece(nullptr, 0, tileOffsets_.front(), the::SkyOverlap::Partial);
+        auto const caps = tiles_.Tiles();
+        tiles_.Query([this](the::Vec3 const &axis, double const radius) {
+          return the::PlanesOverlap(skyPlanes_, axis, radius + kCullMargin);
+        }, [&, this](the::CatalogueTile const &tile, the::SkyOverlap const overlap) {
+          auto const i = static_cast<std::size_t>(&tile - caps.data());
+          AddPiece(nullptr, tileOffsets_[i], tileOffsets_[i + 1], overlap);
+        });
+      }
+      VertexizePieces(sky);
     }
 
-    if (!showExtra_)
-      return;
+    // Every chunk keeps its stars in view at its front, gathered here into place.
+    auto const chunks = chunkCounts_.size();
+    std::vector<std::size_t> offsets(chunks + 1, 0);
+    for (std::size_t c = 0; c < chunks; ++c)
+      offsets[c + 1] = offsets[c] + chunkCounts_[c];
+    auto const out = allocate(offsets.back() + extras_.size());
+    pool_->ParallelFor(0, chunks, 1, [&](std::size_t c, std::size_t const last) {
+      for (; c < last; ++c) {
+        auto const *const from = scratch_.data() + c * kVertexGrain;
+        std::copy(from, from + chunkCounts_[c], out.data() + offsets[c]);
+      }
+    });
+    std::copy(extras_.begin(), extras_.end(), out.end() - extras);
+  }
 
+  /// Stars left out when vertexized on the CPU.
+  enum class Culling {
+    None,
+    /// Stars out of the view set with SetProjection.
+    View,
+    /// Stars out of the view or below the horizon.
+    Horizon,
+  };
+
+  void SetCulling(Culling const culling) {
+    culling_ = culling;
+  }
+
+  /// Sets the projection stars are drawn with, for culling stars out of the view.
+  /// The projection takes points of the frame DrawStar projects from to clip coordinates.
+  void SetProjection(the::Mat4f const &projection) {
+    frustum_ = the::FrustumNormals(projection);
+    frustumSet_ = true;
+
+    // A corner of the view is on a vertical and a horizontal side, in front of the eye.
+    viewRadius_ = 0.0;
+    for (std::size_t const vertical : {0, 1}) {
+      for (std::size_t const horizontal : {2, 3}) {
+        auto const &u = frustum_[vertical];
+        auto const &v = frustum_[horizontal];
+        the::Vec3 corner{u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        corner = corner / std::sqrt(corner[0] * corner[0] + corner[1] * corner[1] + corner[2] * corner[2]);
+        auto const &axis = frustum_[4];
+        if (corner[0] * axis[0] + corner[1] * axis[1] + corner[2] * axis[2] < 0.0)
+          corner = corner * -1.0;
+        viewRadius_ = std::max(viewRadius_, the::SkyAngle(axis, corner));
+      }
+    }
+    viewRadius_ += kCullMargin;
+  }
+
+  /// Draws the poles, Cassiopeia, the Sun and the planets into extras_.
+  void DrawExtras(double const mjd, double const lst) {
     // North and South poles.
-    ProcessStar(gmst,  the::kPi/2.0, 40);
+    ProcessStar(lst,  the::kPi/2.0, 40);
     // ProcessStar(0.0, -the::kPi/2.0, gmst, 40);
 
     // Deneb
@@ -195,18 +418,25 @@ struct Almanac {
     // ProcessStar(the::FromDMS(5, 40, 45.52666) * 15.0, the::FromDMS(-1,  56, 34.2649));
 
     // Cassiopeiea
-    ProcessStar(gmst - the::FromDMS(0, 40, 30.4405)  * 15.0 * the::kRad, the::FromDMS(56, 32, 14.3920) * the::kRad, 30);
-    ProcessStar(gmst - the::FromDMS(0,  9, 10.68518) * 15.0 * the::kRad, the::FromDMS(59,  8, 59.2120) * the::kRad, 30);
-    ProcessStar(gmst - the::FromDMS(0, 56, 42.50108) * 15.0 * the::kRad, the::FromDMS(60, 43,  0.2984) * the::kRad, 30);
-    ProcessStar(gmst - the::FromDMS(1, 25, 48.95147) * 15.0 * the::kRad, the::FromDMS(60, 14,  7.0225) * the::kRad, 30);
-    ProcessStar(gmst - the::FromDMS(1, 54, 23.72567) * 15.0 * the::kRad, the::FromDMS(63, 40, 12.3628) * the::kRad, 30);
+    ProcessStar(lst - the::FromDMS(0, 40, 30.4405)  * 15.0 * the::kRad, the::FromDMS(56, 32, 14.3920) * the::kRad, 30);
+    ProcessStar(lst - the::FromDMS(0,  9, 10.68518) * 15.0 * the::kRad, the::FromDMS(59,  8, 59.2120) * the::kRad, 30);
+    ProcessStar(lst - the::FromDMS(0, 56, 42.50108) * 15.0 * the::kRad, the::FromDMS(60, 43,  0.2984) * the::kRad, 30);
+    ProcessStar(lst - the::FromDMS(1, 25, 48.95147) * 15.0 * the::kRad, the::FromDMS(60, 14,  7.0225) * the::kRad, 30);
+    ProcessStar(lst - the::FromDMS(1, 54, 23.72567) * 15.0 * the::kRad, the::FromDMS(63, 40, 12.3628) * the::kRad, 30);
 
-    // Sun
+    // Sun and planets
     {
       double epoch = (mjd - the::kMJD_J2000) / 36525.0;
-      auto vec = the::SunPos(epoch);
+      // Looked up rather than summed up every frame.
+      if (!sunEphemeris_.Covers(epoch))
+        sunEphemeris_ = the::FitSunPos(epoch, epoch + kSunEphemerisSpan);
+      auto const sunVec = the::SunPos(sunEphemeris_, epoch);
+      // The planets share the epoch's frame with the sun looked up.
+      planets_.Update({&epoch, 1}, {&sunVec, 1});
+      auto const ecl2equ = the::FrameCache::Shared().At(the::Frame::Ecl2True, epoch);
+      auto vec = planets_.Sun()[0];
       // std::cerr << "ecl sun = " << vec << '\n';
-      vec = the::Ecl2EquMatrix(epoch) * vec;
+      vec = ecl2equ * vec;
       // std::cerr << "equ sun = " << vec << '\n';
       // The z axis is directed towards to the north celestial polar.
       // To align with the model axis it has to be rotated relatively x on 90 degrees.
@@ -215,16 +445,22 @@ struct Almanac {
       // vec[2] = -vec[2];
       auto sun = the::MakePolar(vec);
       // std::cerr << "polar sun = " << vec << '\n';
-      // ProcessStar(sun.Phi, sun.Theta, 75);
+      // Of the hour angle and declination, as the stars are.
+      ProcessStar(lst - sun.Phi, sun.Theta, 75);
       double elev, az;
-      the::Equ2Hor(sun.Theta, gmst - sun.Phi, positionLatitude_, elev, az);
+      the::Equ2Hor(sun.Theta, lst - sun.Phi, positionLatitude_, elev, az);
       // std::cerr << "elev = " << elev << "; az = " << az << '\n';
-      ProcessStar(az, elev, 75);
 
       std::cout << "sun (az=" << az / the::kRad << ", elev=" << elev / the::kRad << ')' << '\r';
       // std::stringstream ss;
       // ss << "sun (az=" << az * the::kRad << ", elev=" << elev * the::kRad << ')';
       // textPipeline_.debugLine = ss.str();
+
+      // Planets
+      for (std::size_t p = 0; p < the::kPlanets; ++p) {
+        auto const planet = the::MakePolar(ecl2equ * planets_.Geocentric(static_cast<the::Planet>(p))[0]);
+        ProcessStar(lst - planet.Phi, planet.Theta, 40);
+      }
     }
   }
 
@@ -246,9 +482,7 @@ struct Almanac {
     // float y = std::sin(decl);
     // float z = std::cos(ra) * std::cos(decl);
 
-    auto vec = the::Vec3{x, y, z};
-    vec = the::Mat3::RotateX(viewAngleX_) * vec;
-    vec = the::Mat3::RotateY(viewAngleY_) * vec;
+    auto const vec = viewRotation_ * the::Vec3{x, y, z};
     x = vec[0];
     y = vec[1];
     z = vec[2];
@@ -260,12 +494,40 @@ struct Almanac {
 
     // DEBUG("vertexing a star: x=% .08f, y=% .08f, z=% .08f, mag=%2i, d=%f\n", x, y, z, mag, d);
 
-    Graphics::Star v{x, y, z, float(double(mag/3.15))};
-    stars_.emplace_back(v);
+    Graphics::Star v{x, y, z, PointSize(mag)};
+    extras_.emplace_back(v);
+  }
+
+  /// Draws rows [begin, end) of the tile into out as DrawStar does, turned by
+  /// SkyMatrix, with sines and cosines computed in SIMD lanes. Safe to call
+  /// from several threads.
+  void DrawStars(the::TileData const &tile, std::size_t const begin, std::size_t const end,
+                 the::Mat3 const &sky, Graphics::Star *out) const {
+    std::size_t constexpr kBatch = 256;
+    double ra[kBatch], decl[kBatch], raSin[kBatch], raCos[kBatch], declSin[kBatch], declCos[kBatch];
+    for (auto first = begin; first < end; first += kBatch) {
+      auto const count = std::min(kBatch, end - first);
+      auto const size = static_cast<std::ptrdiff_t>(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        ra[i]   = tile.RaJ2000[first + i] * the::kRad;
+        decl[i] = tile.DecJ2000[first + i] * the::kRad;
+      }
+      the::simd::SinCos(gsl::span<double const>(ra, size), {raSin, size}, {raCos, size});
+      the::simd::SinCos(gsl::span<double const>(decl, size), {declSin, size}, {declCos, size});
+
+      for (std::size_t i = 0; i < count; ++i) {
+        // Of J2000, to be turned to the true equator of date.
+        the::Vec3 const j2000{raCos[i] * declCos[i], raSin[i] * declCos[i], declSin[i]};
+        auto const vec = sky * j2000;
+        double const jmag = std::isnan(tile.Mag[first + i]) ? -1.0 : tile.Mag[first + i];
+        *out++ = {float(vec[0]), float(vec[1]), float(vec[2]), PointSize(jmag / (2.5 / 10.0) + 5.0)};
+      }
+    }
   }
 
   void Reset() {
-    stars_.clear();
+    extras_.clear();
+    chunkCounts_.clear();
   }
 
   std::vector<Graphics::Star> const & Stars() const {
@@ -273,6 +535,212 @@ struct Almanac {
   }
 
  protected:
+  /// Calls fn(ra, delta, mag) for every star loaded not fainter than the limit,
+  /// tiles streamed aside, with coordinates in radians and the magnitude
+  /// in the scale ProcessStar takes.
+  template <typename Fn>
+  void ForEachStar(Fn &&fn) const {
+    // Stars are sorted by magnitude, so the ones bright enough come first.
+    auto const visible = std::isinf(magnitudeLimit_) ? entries_.Size() : entries_.CountBrighter(magnitudeLimit_);
+    auto const ras  = entries_.Ra();
+    auto const decs = entries_.Dec();
+    auto const mags = entries_.Mag();
+    for (std::size_t i = 0; i < visible; ++i) {
+      double ra, delta;
+      ra    = ras[i] * (the::kCompactAngleStep * the::kRad);
+      delta = decs[i] * (the::kCompactAngleStep * the::kRad);
+      // DEBUG("data: ipix=%llu, ra=%lf (%lf), delta=%lf (%lf)\n",
+      //       data.Ipix, data.RaJ2000, ra, data.DecJ2000, delta);
+
+      // Missing magnitudes are NaN.
+      double const jmag = mags[i] == the::kCompactMissing ? -1.0 : mags[i] * 1e-3;
+      fn(ra, delta, jmag / (2.5 / 10.0) + 5.0);
+
+      // double const tau = gmst - ra;
+
+      // std::cerr << "Star #" << data.Ipix << '\n';
+      // std::cerr << "RA:       " << the::FormatHMS(ra * the::kDeg) << '\t';
+      // std::cerr << "Delta:    " << the::FormatDMS(delta * the::kDeg) << '\n';
+
+      // double az, elev;
+      // the::Equ2Hor(delta, tau, positionLatitude_, elev, az);
+
+      // std::cerr << "Azimuth:  " << the::FormatDMS(az * the::kDeg) << '\t';
+      // std::cerr << "Altitude: " << the::FormatDMS(elev * the::kDeg) << '\n';
+      // std::cerr << '\n';
+
+      // int x = std::cos(elev) * std::cos(az) * Graphics::WindowWidth()/2;
+      // int y = std::sin(elev) * Graphics::WindowHeight()/2;
+      // std::cerr << "x: " << float{x}/Graphics::WindowWidth()*2.0 << '\t';
+      // std::cerr << "y: " << y << '\n';
+      // std::cerr << '\n';
+    }
+
+    {
+      auto const ras   = catalogue_.RaJ2000();
+      auto const decs  = catalogue_.DecJ2000();
+      auto const jmags = catalogue_.Jmag();
+      auto const process = [&](std::uint64_t const begin, std::uint64_t const end) {
+        for (auto i = static_cast<std::ptrdiff_t>(begin); i < static_cast<std::ptrdiff_t>(end); ++i) {
+          // Missing magnitudes are NaN.
+          double const jmag = std::isnan(jmags[i]) ? -1.0 : jmags[i];
+          fn(ras[i] * the::kRad, decs[i] * the::kRad, jmag / (2.5 / 10.0) + 5.0);
+        }
+      };
+      if (!lod_.Empty()) {
+        // Stars bright enough are a prefix of every tile.
+        for (auto const &tile : tiles_.Tiles())
+          process(tile.Begin, tile.Begin + lod_.Prefix(tile, magnitudeLimit_));
+      } else if (std::isinf(magnitudeLimit_)) {
+        process(0, catalogue_.Rows());
+      } else {
+        for (std::ptrdiff_t i = 0; i < jmags.size(); ++i) {
+          if (jmags[i] <= magnitudeLimit_)
+            process(i, i + 1);
+        }
+      }
+    }
+  }
+
+  /// Computes unit vectors of stars loaded, once.
+  void PrepareVectors() {
+    if (vectorsReady_)
+      return;
+    ForEachStar([this](double const ra, double const delta, double const mag) {
+      vectors_.Append(ra, delta, PointSize(mag));
+    });
+    vectorsReady_ = true;
+
+    tileOffsets_.clear();
+    if (!lod_.Empty()) {
+      // Stars of the catalogue come last, tile by tile, see ForEachStar.
+      std::size_t stars = 0;
+      for (auto const &tile : tiles_.Tiles())
+        stars += lod_.Prefix(tile, magnitudeLimit_);
+      tileOffsets_.push_back(vectors_.Size() - stars);
+      for (auto const &tile : tiles_.Tiles())
+        tileOffsets_.push_back(tileOffsets_.back() + lod_.Prefix(tile, magnitudeLimit_));
+    }
+  }
+
+  /// Sets planes bounding the view in the frame stars are drawn in, and in the
+  /// equatorial frame sky rotates from.
+  void SetViewPlanes(the::Mat3 const &sky) {
+    planes_.clear();
+    if (frustumSet_ && culling_ != Culling::None)
+      planes_.assign(frustum_.begin(), frustum_.end());
+    if (culling_ == Culling::Horizon) {
+      // The zenith is at the hour angle 0 and the declination of the latitude.
+      planes_.push_back(viewRotation_ * the::Vec3{0.0, std::sin(positionLatitude_), std::cos(positionLatitude_)});
+    }
+    auto const inverse = sky.Transpose();
+    skyPlanes_.clear();
+    for (auto const &plane : planes_)
+      skyPlanes_.push_back(inverse * plane);
+  }
+
+  /// Sets overlaps_ of tiles of tiles_ in the view, walking the hierarchy of
+  /// caps of the index, and lists them in tilesInView_.
+  void MarkTilesInView() {
+    auto const caps = tiles_.Tiles();
+    overlaps_.resize(static_cast<std::size_t>(caps.size()), the::SkyOverlap::Outside);
+    tilesInView_.clear();
+    tiles_.Query([this](the::Vec3 const &axis, double const radius) {
+      return the::PlanesOverlap(skyPlanes_, axis, radius + kCullMargin);
+    }, [&, this](the::CatalogueTile const &tile, the::SkyOverlap const overlap) {
+      auto const i = static_cast<std::size_t>(&tile - caps.data());
+      overlaps_[i] = overlap;
+      tilesInView_.push_back(i);
+    });
+  }
+
+  /// Stars [begin, end) of a tile, or of vectors_ if tile is null.
+  struct Piece {
+    the::TileData const *Tile;
+    std::size_t          Begin;
+    std::size_t          End;
+    /// Whether stars are to be tested against the view one by one.
+    bool                 Partial;
+  };
+
+  void AddPiece(the::TileData const *tile, std::size_t const begin, std::size_t const end,
+                the::SkyOverlap const overlap) {
+    if (begin == end)
+      return;
+    pieces_.push_back({tile, begin, end, overlap == the::SkyOverlap::Partial && !planes_.empty()});
+    pieceOffsets_.push_back(pieceOffsets_.back() + (end - begin));
+  }
+
+  /// Vertexizes stars of pieces_ into scratch_ in chunks of kVertexGrain, one
+  /// chunk per task, culling them to the front of the chunk; sets chunkCounts_.
+  void VertexizePieces(the::Mat3 const &sky) {
+    auto const rotation = ToFloat(sky);
+    auto const total = pieceOffsets_.back();
+    scratch_.resize(total);
+    chunkCounts_.resize((total + kVertexGrain - 1) / kVertexGrain);
+    pool_->ParallelFor(0, chunkCounts_.size(), 1, [&](std::size_t c, std::size_t const last) {
+      for (; c < last; ++c) {
+        auto first = c * kVertexGrain;
+        auto const end = std::min(total, first + kVertexGrain);
+        auto i = static_cast<std::size_t>(
+            std::upper_bound(pieceOffsets_.begin(), pieceOffsets_.end(), first) - pieceOffsets_.begin()) - 1;
+        auto *kept = scratch_.data() + c * kVertexGrain;
+        for (; first < end; ++i) {
+          auto const &piece = pieces_[i];
+          auto const stop = std::min(end, pieceOffsets_[i + 1]);
+          auto const begin = piece.Begin + (first - pieceOffsets_[i]);
+          auto const count = stop - first;
+          auto *const stars = scratch_.data() + first;
+          auto const floats = Floats({stars, static_cast<std::ptrdiff_t>(count)});
+          if (piece.Tile)
+            DrawStars(*piece.Tile, begin, begin + count, sky, stars);
+          else
+            vectors_.Rotate(rotation, floats, begin, begin + count);
+          auto const visible = piece.Partial ? the::CullQuadruples(planes_, kCullMargin, floats) : count;
+          if (kept != stars)
+            std::copy(stars, stars + visible, kept);
+          kept += visible;
+          first = stop;
+        }
+        chunkCounts_[c] = static_cast<std::size_t>(kept - (scratch_.data() + c * kVertexGrain));
+      }
+    });
+  }
+
+  /// Returns stars as quadruples of floats. Graphics::Star is packed, yet
+  /// vectors allocate it aligned as any fundamental type.
+  static gsl::span<float> Floats(gsl::span<Graphics::Star> const stars) {
+    void *data = stars.data();
+    return {static_cast<float *>(data), 4 * static_cast<std::ptrdiff_t>(stars.size())};
+  }
+
+  static float PointSize(double const mag) {
+    return float(mag / 3.15);
+  }
+
+  double Mjd() const {
+    auto time = std::time_t(chrono::duration_cast<chrono::seconds>(time_.time_since_epoch()).count());
+    std::tm tm = *std::gmtime(&time);
+    using milliseconds_type = std::chrono::duration<double, std::chrono::milliseconds::period>;
+    auto secs = tm.tm_sec + chrono::duration_cast<milliseconds_type>(time_.time_since_epoch()).count();
+    secs = std::fmod(secs, 1.0);
+    return the::MJD(tm.tm_year + 1900, tm.tm_mon+1, tm.tm_mday, tm.tm_hour, tm.tm_min, secs);
+  }
+
+  /// Returns the local apparent sidereal time at mjd, that of the true
+  /// equinox of date the sky is turned to.
+  double SiderealTime(double const mjd) const {
+    double const T = (mjd - the::kMJD_J2000) / 36525.0;
+    return the::GMST(mjd) + the::EquationOfEquinoxes(T) + positionLongitude_;
+  }
+
+  /// Returns the equatorial unit vector of J2000 at the centre of the view.
+  the::Vec3 ViewAxis(the::Mat3 const &sky) const {
+    // Inverse of the rotation in DrawStar applied to the nearest point of the sphere, (0, 0, -1).
+    return sky.Transpose() * the::Vec3{0.0, 0.0, -1.0};
+  }
+
+
   // Dublin's home.
   double const positionLatitude_  = 53.319927 * the::kRad;
   double const positionLongitude_ = -6.264353 * the::kRad;
@@ -280,17 +748,84 @@ struct Almanac {
   // TODO: Switch to real clock and increment gradually with timeFactor.
   chrono::system_clock::time_point time_;
   bool showExtra_ = true;
+  bool gpuRotation_ = false;
 
   // Look at the North polar star.
   double viewAngleX_ = 0.0;
   double viewAngleY_ = 0.0;
 
+  /// Stars of the frame, unless vertexized into memory of the caller.
   std::vector<Graphics::Star> stars_;
-  std::vector<PPMXLReader::Row> entries_;
+  /// Stars drawn one at a time by DrawStar.
+  std::vector<Graphics::Star> extras_;
+  /// Stars of the frame before they are gathered; every chunk of kVertexGrain
+  /// of them keeps chunkCounts_ stars in the view at its front.
+  std::vector<Graphics::Star> scratch_;
+  std::vector<std::size_t> chunkCounts_;
+  std::vector<Piece> pieces_;
+  std::vector<std::size_t> pieceOffsets_;
+  /// Planes bounding the view of the frame being drawn, in its frame and in the equatorial one.
+  std::vector<the::Vec3> planes_;
+  std::vector<the::Vec3> skyPlanes_;
+  std::array<the::Vec3, 5> frustum_;
+  bool frustumSet_ = false;
+  /// Angle from the axis of the view to its corners and the margin, the whole sky until SetProjection.
+  double viewRadius_ = the::kPi;
+  Culling culling_ = Culling::View;
+  /// Overlaps of tiles of tiles_ with the view, Outside but for tilesInView_.
+  std::vector<the::SkyOverlap> overlaps_;
+  std::vector<std::size_t> tilesInView_;
+  /// Offsets of tiles of tiles_ in vectors_, if the catalogue is tiled.
+  std::vector<std::size_t> tileOffsets_;
+  the::StarStore entries_;
+  /// Unit vectors of entries_ and catalogue_ stars drawn on the CPU.
+  the::StarVectors vectors_;
+  bool vectorsReady_ = false;
+  /// View rotation of the frame being drawn.
+  the::Mat3 viewRotation_ = the::Mat3::Id();
+  /// Threads vertexizing stars on the CPU.
+  std::unique_ptr<the::ThreadPool> pool_ = std::make_unique<the::ThreadPool>();
+  the::Catalogue catalogue_;
+  /// Spatial index of catalogue_, empty unless the catalogue has been tiled by ppmxl2cat -t.
+  the::TileIndex tiles_;
+  the::MagnitudeLod lod_;
+  /// Positions of the sun from the time of the sky on.
+  the::ChebyshevEphemeris sunEphemeris_;
+  /// Planets of the time of the sky, computed along with the sun every frame.
+  the::EphemerisFrame planets_;
+  /// Tiles of catalogue_ around the view, unless the whole catalogue is mapped.
+  std::unique_ptr<the::TileCache> cache_;
+  double magnitudeLimit_ = std::numeric_limits<double>::infinity();
+  /// Applied to PPMXL text while it is being parsed.
+  the::PPMXLFilter filter_;
+};
+
+/// Sky of a moment produced by the simulation thread of GraphicsProgram.
+struct SkySnapshot {
+  /// Region of the streamed star buffer the stars are written into, and their
+  /// number; Graphics::kStarRegions if none.
+  std::size_t Region = Graphics::kStarRegions;
+  std::size_t StarCount = 0;
+  /// Stars, unless streamed, see Graphics::StreamsStars.
+  std::vector<Graphics::Star> Stars;
+  the::Mat3f SkyRotation = the::Mat3f::Id();
+  /// The heads-up line rasterised, none if it has failed.
+  std::optional<the::ui::Image<std::uint8_t[4]>> Hud;
+};
+
+/// State of the view the render thread hands over to the simulation thread.
+struct ViewInput {
+  double ViewAngleX;
+  double ViewAngleY;
+  the::Mat4f Projection;
+  bool ShowExtra;
+  double Fps;
 };
 
 struct GraphicsProgram: public Graphics {
   static constexpr double timeScale = 3600.0;
+  /// Snapshots of the sky the simulation thread produces a second at most.
+  static constexpr unsigned simulationRate = 60;
 
   GraphicsProgram()
       : Graphics() {
@@ -303,46 +838,57 @@ struct GraphicsProgram: public Graphics {
       return std::move(rv);
     }
 
-    timeBeginning_ = chrono::steady_clock::now();
     timeIn_ = chrono::system_clock::now();
 
     almanac_->SetTime(timeIn_);
     almanac_->SetRotation(viewAngleX_, viewAngleY_);
+    // RenderStars hands the camera matrix to OpenGL untransposed.
+    almanac_->SetProjection(ComputeCameraMatrix().Transpose());
     almanac_->VertexizeStars();
 
     LoadStars(almanac_->Stars());
+    if (almanac_->GpuRotation()) {
+      auto const stars = almanac_->CatalogueVectors();
+      LoadStaticStars(stars);
+      INFO() << stars.size() << " stars uploaded to the GPU";
+    }
+    magnitudeLimit_ = std::min(almanac_->MagnitudeLimit(), maxMagnitudeLimit);
 
     return {};
   }
 
   OglFallible<> Deinit() override {
-    if (auto rv = this->Graphics::Deinit(); !rv) {
-      return std::move(rv);
-    }
-
+    StopSimulation();
+    // Released while the context Graphics::Deinit destroys is still current.
     glDeleteBuffers(1, &textPipeline_.vboVertices);
     glDeleteBuffers(1, &textPipeline_.vboIndices);
     glDeleteVertexArrays(1, &textPipeline_.vao);
     glDeleteTextures(1, &textPipeline_.textureID);
     FALL_ON_GL_ERROR();
 
-    return {};
+    return this->Graphics::Deinit();
   }
 
   OglFallible<> Render() override {
-    auto now = chrono::steady_clock::now();
-    timeIn_ += std::chrono::duration_cast<std::chrono::system_clock::duration>(
-        timeScale * (now - timeBeginning_)
-    );
-    timeBeginning_ = now;
-    // timeIn_ += timeScale * (chrono::steady_clock::now() - timeBeginning_)).count();
-
-    almanac_->SetTime(timeIn_);
-    almanac_->SetRotation(viewAngleX_, viewAngleY_);
-    almanac_->VertexizeStars();
-
-    // LoadStars(almanac_->Stars());
-    UpdateStars(almanac_->Stars());
+    // Fonts are loaded with the shaders, so the simulation thread rasterising
+    // text starts with the first frame.
+    if (!simulation_.joinable())
+      StartSimulation();
+
+    if (snapshots_.Update()) {
+      auto const &snapshot = snapshots_.Front();
+      if (StreamsStars())
+        DrawStarRegion(snapshot.Region, snapshot.StarCount);
+      else
+        UpdateStars(snapshot.Stars);
+      SetSkyRotation(snapshot.SkyRotation);
+      if (snapshot.Hud) {
+        glBindTexture(GL_TEXTURE_2D, textPipeline_.textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, snapshot.Hud->Width(), snapshot.Hud->Height(), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, snapshot.Hud->data());
+        FALL_ON_GL_ERROR();
+      }
+    }
 
     RenderStars();
     if (auto rv = RenderText(); !rv) {
@@ -356,31 +902,10 @@ struct GraphicsProgram: public Graphics {
     return textPipeline_.shader.UsingProgramme([this]() -> OglFallible<> {
         glBindVertexArray(textPipeline_.vao);
         FALL_ON_GL_ERROR();
-
-        std::stringstream ss;
-        std::time_t t = std::chrono::system_clock::to_time_t(timeIn_);
-        std::tm tm = *std::localtime(&t);
-        if (!textPipeline_.debugLine.empty())
-          ss << textPipeline_.debugLine << ": ";
-
-        ss << "fps: " << std::fixed << std::setprecision(2) << std::round(Fps())
-           << " time: " << std::put_time(&tm, "%c %Z")
-           << std::fixed << std::showpoint << std::setprecision(3)
-           << " rot (x, y): "
-           << '(' << viewAngleX_ / the::kRad << ", " << viewAngleY_ / the::kRad << ')';
-        auto const &str = ss.str();
-        auto image = the::ui::RenderFont({str.c_str(), str.size()});
-        if (!image) {
-          ERROR() << "failed to render the text " << std::quoted(str) << ": " << image.Err();
-          return image;
-        }
-
         glActiveTexture(GL_TEXTURE0);
         FALL_ON_GL_ERROR();
         glBindTexture(GL_TEXTURE_2D, textPipeline_.textureID);
         FALL_ON_GL_ERROR();
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->Width(), image->Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image->data());
-        FALL_ON_GL_ERROR();
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
         FALL_ON_GL_ERROR();
 
@@ -388,7 +913,111 @@ struct GraphicsProgram: public Graphics {
       });
   }
 
+  /// Produces snapshots of the sky at simulationRate until stopped, independent
+  /// of the rate frames are rendered at, from the view last handed over.
+  void Simulate() {
+    using Clock = chrono::steady_clock;
+    auto const step = chrono::duration_cast<Clock::duration>(chrono::seconds{1}) / simulationRate;
+    auto last = Clock::now();
+    auto next = last;
+    while (!stopSimulation_.load(std::memory_order_relaxed)) {
+      inputs_.Update();
+      auto const &input = inputs_.Front();
+
+      auto const now = Clock::now();
+      timeIn_ += chrono::duration_cast<chrono::system_clock::duration>(timeScale * (now - last));
+      last = now;
+
+      almanac_->SetTime(timeIn_);
+      almanac_->SetRotation(input.ViewAngleX, input.ViewAngleY);
+      almanac_->SetProjection(input.Projection);
+      almanac_->SetShowExtra(input.ShowExtra);
+
+      auto &snapshot = snapshots_.Back();
+      almanac_->VertexizeStars([this, &snapshot](std::size_t const count) {
+        return AllocateStars(snapshot, count);
+      });
+      snapshot.SkyRotation = almanac_->SkyRotation();
+
+      std::stringstream ss;
+      std::time_t t = std::chrono::system_clock::to_time_t(timeIn_);
+      std::tm tm = *std::localtime(&t);
+      if (!textPipeline_.debugLine.empty())
+        ss << textPipeline_.debugLine << ": ";
+      ss << "fps: " << std::fixed << std::setprecision(2) << std::round(input.Fps)
+         << " time: " << std::put_time(&tm, "%c %Z")
+         << std::fixed << std::showpoint << std::setprecision(3)
+         << " rot (x, y): "
+         << '(' << input.ViewAngleX / the::kRad << ", " << input.ViewAngleY / the::kRad << ')';
+      auto const &str = ss.str();
+      if (auto image = the::ui::RenderFont({str.c_str(), str.size()}); image) {
+        snapshot.Hud.emplace(std::move(*image));
+      } else {
+        ERROR() << "failed to render the text " << std::quoted(str) << ": " << image.Err();
+        snapshot.Hud.reset();
+      }
+      if (snapshots_.Publish()) {
+        // Stars of a snapshot skipped are never drawn.
+        auto &skipped = snapshots_.Back();
+        if (skipped.Region < kStarRegions)
+          ReleaseStarRegion(skipped.Region);
+        skipped.Region = kStarRegions;
+      }
+
+      // Falls behind rather than catching up in a burst.
+      next = std::max(next + step, Clock::now());
+      std::this_thread::sleep_until(next);
+    }
+  }
+
+  /// Returns memory of a snapshot for count stars: a region of the streamed
+  /// star buffer once one is free, so the render thread only has to draw it.
+  gsl::span<Graphics::Star> AllocateStars(SkySnapshot &snapshot, std::size_t const count) {
+    snapshot.Region = kStarRegions;
+    snapshot.StarCount = count;
+    while (StreamsStars() && !stopSimulation_.load(std::memory_order_relaxed)) {
+      if (auto const region = AcquireStarRegion(count); region.Index < kStarRegions) {
+        snapshot.Region = region.Index;
+        return region.Stars;
+      }
+      // Regions are freed or made larger as frames are rendered.
+      std::this_thread::sleep_for(chrono::milliseconds{1});
+    }
+    snapshot.Stars.resize(count);
+    return gsl::span<Graphics::Star>(snapshot.Stars);
+  }
+
+  void StartSimulation() {
+    PublishInput();
+    stopSimulation_ = false;
+    simulation_ = std::thread([this] { Simulate(); });
+  }
+
+  void StopSimulation() {
+    stopSimulation_ = true;
+    if (simulation_.joinable())
+      simulation_.join();
+  }
+
+  /// Hands the view over to the simulation thread.
+  void PublishInput() {
+    auto &input = inputs_.Back();
+    input.ViewAngleX = viewAngleX_;
+    input.ViewAngleY = viewAngleY_;
+    // RenderStars hands the camera matrix to OpenGL untransposed.
+    input.Projection = ComputeCameraMatrix().Transpose();
+    input.ShowExtra = showExtra_;
+    input.Fps = Fps();
+    inputs_.Publish();
+  }
+
   OglFallible<> HandleInput() override {
+    // Headless, the view stays where it is.
+    if (!window_) {
+      PublishInput();
+      return {};
+    }
+
     double const rotationStep = the::kPi / 12.0 / 60.0;
     if (GLFW_PRESS == glfwGetKey(window_, GLFW_KEY_ESCAPE) || GLFW_PRESS == glfwGetKey(window_, GLFW_KEY_Q)) {
       glfwSetWindowShouldClose(window_, 1);
@@ -412,11 +1041,23 @@ struct GraphicsProgram: public Graphics {
       viewAngleY_ =  0;//the::kPi;
     }
     if (GLFW_PRESS == glfwGetKey(window_, GLFW_KEY_X)) {
-      almanac_->ToggleExtra();
+      showExtra_ = !showExtra_;
+    }
+    // Stars culled on the GPU are not uploaded again to change the limit,
+    // yet those left out as they were loaded stay out.
+    if (ComputeCulling()) {
+      if (GLFW_PRESS == glfwGetKey(window_, GLFW_KEY_LEFT_BRACKET))
+        magnitudeLimit_ -= magnitudeStep;
+      if (GLFW_PRESS == glfwGetKey(window_, GLFW_KEY_RIGHT_BRACKET))
+        magnitudeLimit_ = std::min(magnitudeLimit_ + magnitudeStep, maxMagnitudeLimit);
+      SetMaxPointSize(magnitudeLimit_ < maxMagnitudeLimit ? Almanac::JmagPointSize(magnitudeLimit_) :
+                                                            std::numeric_limits<float>::infinity());
     }
 
     FALL_ON_GL_ERROR();
 
+    PublishInput();
+
     return {};
   }
 
@@ -431,9 +1072,21 @@ struct GraphicsProgram: public Graphics {
   double viewAngleX_ = (90.0) * the::kRad; // the::kPi/2.0;
   double viewAngleY_ =  0; // the::kPi;
 
+  bool showExtra_ = true;
+  /// Limiting magnitude in Jmag of stars culled on the GPU, changed by keys
+  /// a step a frame; the maximum shows every star.
+  static constexpr double maxMagnitudeLimit = 20.0;
+  static constexpr double magnitudeStep = 0.05;
+  double magnitudeLimit_ = maxMagnitudeLimit;
+
+  /// Used by the simulation thread alone once it has started.
   Almanac *almanac_;
   chrono::system_clock::time_point timeIn_;
-  chrono::steady_clock::time_point timeBeginning_;
+
+  std::thread simulation_;
+  std::atomic<bool> stopSimulation_{false};
+  the::TripleBuffer<ViewInput> inputs_;
+  the::TripleBuffer<SkySnapshot> snapshots_;
 
   struct {
     the::ui::Shader shader;
@@ -557,7 +1210,7 @@ struct C1 {
   T x;
 } __attribute__ ((packed));
 
-int main() {
+int main(int argc, char *argv[]) {
   std::cin.sync_with_stdio(false);
   std::cin.tie(nullptr);
 
@@ -576,9 +1229,92 @@ int main() {
 
   auto almanac = std::make_unique<Almanac>();
   almanac->Init();
-  almanac->LoadStars(std::cin);
+  almanac->SetGpuRotation(true);
+  std::size_t budget = 0;
+  unsigned headlessFrames = 0;
+  std::string dumpDir;
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (std::strcmp(argv[arg], "-f") == 0) {
+      // Predicates on PPMXL columns, e.g. -f Jmag:0:2.5
+      auto filter = the::PPMXLFilter::Parse(argv[arg + 1]);
+      if (!filter)
+        the::Panic(filter.Err());
+      almanac->SetFilter(*filter);
+    } else if (std::strcmp(argv[arg], "-m") == 0) {
+      // Limiting magnitude in Jmag, e.g. -m 6
+      almanac->SetMagnitudeLimit(std::atof(argv[arg + 1]));
+    } else if (std::strcmp(argv[arg], "-r") == 0) {
+      // Where stars are rotated: gpu uploads them once, cpu every frame.
+      if (std::strcmp(argv[arg + 1], "cpu") != 0 && std::strcmp(argv[arg + 1], "gpu") != 0)
+        the::Panic(the::RuntimeError{std::string{"unknown rotation mode "} + argv[arg + 1]});
+      almanac->SetGpuRotation(std::strcmp(argv[arg + 1], "gpu") == 0);
+    } else if (std::strcmp(argv[arg], "-c") == 0) {
+      // Stars culled on the CPU: view leaves out those off the screen,
+      // horizon those below the horizon too, none draws every star;
+      // gpu culls as view and has stars rotated on the GPU culled there too.
+      auto const culling = std::string_view{argv[arg + 1]};
+      if (culling != "none" && culling != "view" && culling != "horizon" && culling != "gpu")
+        the::Panic(the::RuntimeError{std::string{"unknown culling mode "} + argv[arg + 1]});
+      almanac->SetCulling(culling == "none" ? Almanac::Culling::None :
+                          culling == "horizon" ? Almanac::Culling::Horizon : Almanac::Culling::View);
+      graphics.SetComputeCulling(culling == "gpu");
+    } else if (std::strcmp(argv[arg], "-n") == 0) {
+      // Renders that many frames offscreen, without a window, e.g. -n 600
+      headlessFrames = unsigned(std::atoi(argv[arg + 1]));
+    } else if (std::strcmp(argv[arg], "-d") == 0) {
+      // Directory frames rendered offscreen are written into as PPM images.
+      dumpDir = argv[arg + 1];
+    } else if (std::strcmp(argv[arg], "-j") == 0) {
+      // Threads vertexizing stars on the CPU, e.g. -j 4; one per core by default.
+      almanac->SetThreads(unsigned(std::atoi(argv[arg + 1])));
+    } else if (std::strcmp(argv[arg], "-b") == 0) {
+      // Memory for tiles streamed from a tiled catalogue in megabytes, e.g. -b 8192
+      budget = std::size_t(std::atoll(argv[arg + 1])) << 20;
+    } else {
+      break;
+    }
+  }
+
+  the::MappedFile text;
+  if (arg < argc) {
+    char const *path = argv[arg];
+    auto file = the::MappedFile::Open(path);
+    if (!file)
+      the::Panic(file.Err());
+    // Either a binary catalogue produced by ppmxl2cat or PPMXL text, told apart
+    // by the magic, so that a catalogue failing to open is not read as text.
+    if (file->size() >= sizeof(the::kCatalogueMagic) &&
+        std::memcmp(file->data(), the::kCatalogueMagic, sizeof(the::kCatalogueMagic)) == 0) {
+      auto catalogue = the::Catalogue::Open(path);
+      if (!catalogue)
+        the::Panic(catalogue.Err());
+      almanac->LoadStars(std::move(*catalogue));
+      if (auto tiles = the::TileIndex::Open(the::TileDirectoryPath(path).c_str())) {
+        almanac->LoadTiles(std::move(*tiles));
+        if (budget > 0)
+          almanac->StreamTiles(path, budget);
+      } else {
+        WARN() << "the catalogue has no tile directory" << (budget > 0 ? ", it is mapped as a whole" : "")
+               << ": " << tiles.Err();
+      }
+    } else {
+      if (file->size() >= 2 && file->data()[0] == '\x1f' && file->data()[1] == '\x8b') {
+        // Compressed text is inflated as it streams into the parsers.
+        std::ifstream gz(path, std::ios::binary);
+        almanac->LoadStars(gz);
+      } else {
+        text = std::move(*file);
+        almanac->LoadStars(text.Bytes());
+      }
+    }
+  } else {
+    almanac->LoadStars(std::cin);
+  }
 
   graphics.SetSky(almanac.get());
+  if (headlessFrames > 0)
+    graphics.SetHeadless(headlessFrames, dumpDir);
   if (auto rv = graphics.Init(); !rv)
     the::Panic(rv.Err());
 
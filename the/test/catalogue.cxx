@@ -0,0 +1,98 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/catalogue.hxx"
+
+using namespace the;
+
+TEST(CatalogueTest, WritesAndMapsColumns) {
+  std::string const fpath = ::testing::TempDir() + "catalogue-test.cat";
+  PPMXLColumn const columns[] = {
+    PPMXLColumn::Ipix, PPMXLColumn::RaJ2000, PPMXLColumn::DecJ2000, PPMXLColumn::Jmag,
+  };
+
+  {
+    auto writer = CatalogueWriter::Create(fpath.c_str(), columns);
+    ASSERT_TRUE(writer);
+
+    PPMXLReader::Row row;
+    for (int i = 0; i < 100; ++i) {
+      row.Ipix     = 161387954652791ull + i;
+      row.RaJ2000  = 314.709206 + i;
+      row.DecJ2000 = 35.640741 - i;
+      row.Jmag     = i % 10 == 0 ? std::nan("") : 15.634 + i;
+      writer->Append(row);
+    }
+    ASSERT_TRUE(writer->Finish());
+  }
+
+  auto cat = Catalogue::Open(fpath.c_str());
+  ASSERT_TRUE(cat);
+  ASSERT_EQ(100u, cat->Rows());
+  ASSERT_EQ(4, cat->Columns().size());
+  ASSERT_TRUE(cat->Has(PPMXLColumn::Jmag));
+  ASSERT_FALSE(cat->Has(PPMXLColumn::Hmag));
+  ASSERT_TRUE(cat->Hmag().empty());
+  // A column requested with a wrong type is not exposed.
+  ASSERT_TRUE(cat->Column<float>(PPMXLColumn::RaJ2000).empty());
+
+  auto const ipix = cat->Ipix();
+  auto const ra   = cat->RaJ2000();
+  auto const dec  = cat->DecJ2000();
+  auto const jmag = cat->Jmag();
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(ra.data()) % kCatalogueAlignment);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(161387954652791ull + i, ipix[i]);
+    ASSERT_DOUBLE_EQ(314.709206 + i, ra[i]);
+    ASSERT_DOUBLE_EQ(35.640741 - i, dec[i]);
+    if (i % 10 == 0)
+      ASSERT_TRUE(std::isnan(jmag[i]));
+    else
+      ASSERT_DOUBLE_EQ(15.634 + i, jmag[i]);
+  }
+
+  std::remove(fpath.c_str());
+}
+
+TEST(CatalogueTest, RejectsForeignFiles) {
+  std::string const fpath = ::testing::TempDir() + "catalogue-test.txt";
+  if (auto *file = std::fopen(fpath.c_str(), "wb")) {
+    std::fputs("161387954652791|314.709206|35.640741|2.31e-05|2.31e-05|-4.9444e-07|"
+               "-1.3944e-06|1.17e-06|1.17e-06|6|1984.55|1984.55|15.634|0.047\n", file);
+    std::fclose(file);
+  }
+
+  ASSERT_FALSE(Catalogue::Open(fpath.c_str()));
+  ASSERT_FALSE(Catalogue::Open((fpath + ".missing").c_str()));
+
+  std::remove(fpath.c_str());
+}
+
+TEST(CatalogueTest, RejectsRowsWrappingAroundColumnSize) {
+  std::string const fpath = ::testing::TempDir() + "catalogue-test-rows.cat";
+  PPMXLColumn const columns[] = {PPMXLColumn::Ipix, PPMXLColumn::RaJ2000};
+
+  {
+    auto writer = CatalogueWriter::Create(fpath.c_str(), columns);
+    ASSERT_TRUE(writer);
+    PPMXLReader::Row row;
+    for (int i = 0; i < 100; ++i)
+      writer->Append(row);
+    ASSERT_TRUE(writer->Finish());
+  }
+  ASSERT_TRUE(Catalogue::Open(fpath.c_str()));
+
+  // 8 * (2^61 + 100) wraps around to the 800 bytes actually stored.
+  if (auto *file = std::fopen(fpath.c_str(), "r+b")) {
+    std::uint64_t const rows = (std::uint64_t{1} << 61) + 100;
+    std::fseek(file, offsetof(CatalogueHeader, Rows), SEEK_SET);
+    std::fwrite(&rows, sizeof(rows), 1, file);
+    std::fclose(file);
+  }
+  ASSERT_FALSE(Catalogue::Open(fpath.c_str()));
+
+  std::remove(fpath.c_str());
+}
@@ -0,0 +1,76 @@
+#include <cmath>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/compactstar.hxx"
+
+using namespace the;
+
+TEST(CompactStarTest, KeepsPrecisionBounds) {
+  std::mt19937_64 rng{42};
+  std::uniform_real_distribution<double> ra{0.0, 360.0}, dec{-90.0, 90.0}, mag{-2.0, 20.0};
+  std::uniform_real_distribution<double> pm{-16.0 / 3600.0, 16.0 / 3600.0};
+
+  for (int i = 0; i < 100000; ++i) {
+    PPMXLReader::Row row;
+    row.RaJ2000  = ra(rng);
+    row.DecJ2000 = dec(rng);
+    row.PmRA     = pm(rng);
+    row.PmDE     = pm(rng);
+    row.Jmag     = mag(rng);
+    row.Kmag     = mag(rng);
+
+    auto const star = CompactStar::FromRow(row);
+    ASSERT_LE(std::abs(star.RaJ2000() - row.RaJ2000), 0.151e-3 / 3600.0);
+    ASSERT_LE(std::abs(star.DecJ2000() - row.DecJ2000), 0.151e-3 / 3600.0);
+    ASSERT_LE(std::abs(star.PmRADeg() - row.PmRA), 0.25e-3 / 3600.0 * (1.0 + 1e-9));
+    ASSERT_LE(std::abs(star.PmDEDeg() - row.PmDE), 0.25e-3 / 3600.0 * (1.0 + 1e-9));
+    ASSERT_LE(std::abs(star.Jmag() - row.Jmag), 0.5e-3 * (1.0 + 1e-9));
+    ASSERT_LE(std::abs(star.JKs() - (row.Jmag - row.Kmag)), 0.5e-3 * (1.0 + 1e-9));
+  }
+}
+
+TEST(CompactStarTest, HandlesEdges) {
+  PPMXLReader::Row row;
+  row.RaJ2000  = 360.0 - 1e-12;
+  row.DecJ2000 = 90.0;
+  row.PmRA     = 20.0 / 3600.0;
+  row.PmDE     = NAN;
+  row.Jmag     = NAN;
+  row.Kmag     = 5.0;
+
+  auto const star = CompactStar::FromRow(row);
+  ASSERT_EQ(0u, star.Ra);
+  ASSERT_DOUBLE_EQ(90.0, star.DecJ2000());
+  // Saturated.
+  ASSERT_NEAR(32767 * 0.5e-3 / 3600.0, star.PmRADeg(), 1e-15);
+  ASSERT_EQ(0.0, star.PmDEDeg());
+  ASSERT_TRUE(std::isnan(star.Jmag()));
+  ASSERT_TRUE(std::isnan(star.JKs()));
+
+  // Missing magnitudes sort after any other.
+  row.Jmag = 32.0;
+  ASSERT_LT(CompactStar::FromRow(row).Mag, star.Mag);
+}
+
+TEST(CompactStarTest, ZeroesPositionsNotFinite) {
+  PPMXLReader::Row row;
+  row.RaJ2000  = NAN;
+  row.DecJ2000 = NAN;
+  row.PmRA     = 0.0;
+  row.PmDE     = 0.0;
+  row.Jmag     = INFINITY;
+  row.Kmag     = NAN;
+
+  auto const star = CompactStar::FromRow(row);
+  ASSERT_EQ(0u, star.Ra);
+  ASSERT_EQ(0, star.Dec);
+  ASSERT_NEAR(32.766, star.Jmag(), 1e-12);
+  ASSERT_TRUE(std::isnan(star.JKs()));
+
+  // Declinations out of range saturate.
+  row.RaJ2000  = INFINITY;
+  row.DecJ2000 = -INFINITY;
+  ASSERT_EQ(0u, CompactStar::FromRow(row).Ra);
+  ASSERT_DOUBLE_EQ(-90.0, CompactStar::FromRow(row).DecJ2000());
+}
@@ -0,0 +1,88 @@
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/consts.hxx"
+#include "the/lib/common/culling.hxx"
+#include "the/lib/common/tiles.hxx"
+
+using namespace the;
+
+namespace {
+
+/// Returns a projection looking down -z with half-angles of view in radians.
+Mat4f Perspective(double const halfWidth, double const halfHeight) {
+  float const n = 0.1f, f = 10.0f;
+  return {
+    float(1.0 / std::tan(halfWidth)), 0.0f,                              0.0f,               0.0f,
+    0.0f,                             float(1.0 / std::tan(halfHeight)), 0.0f,               0.0f,
+    0.0f,                             0.0f,                              (f + n) / (n - f),  2.0f * f * n / (n - f),
+    0.0f,                             0.0f,                              -1.0f,              0.0f,
+  };
+}
+
+/// Returns the unit vector at angles off -z to the right and up.
+Vec3 Direction(double const right, double const up) {
+  return {std::cos(up) * std::sin(right), std::sin(up), -std::cos(up) * std::cos(right)};
+}
+
+bool Inside(std::array<Vec3, 5> const &normals, Vec3 const &v) {
+  for (auto const &n : normals) {
+    if (n[0] * v[0] + n[1] * v[1] + n[2] * v[2] < 0.0)
+      return false;
+  }
+  return true;
+}
+
+}
+
+TEST(CullingTest, FrustumNormalsBoundTheView) {
+  double const halfWidth = 40.0 * kRad, halfHeight = 30.0 * kRad;
+  auto const normals = FrustumNormals(Perspective(halfWidth, halfHeight));
+
+  ASSERT_TRUE(Inside(normals, Direction(0.0, 0.0)));
+  ASSERT_TRUE(Inside(normals, Direction(halfWidth - 1e-6, 0.0)));
+  ASSERT_FALSE(Inside(normals, Direction(halfWidth + 1e-6, 0.0)));
+  ASSERT_FALSE(Inside(normals, Direction(-halfWidth - 1e-6, 0.0)));
+  ASSERT_TRUE(Inside(normals, Direction(0.0, -halfHeight + 1e-6)));
+  ASSERT_FALSE(Inside(normals, Direction(0.0, halfHeight + 1e-6)));
+  // Behind the eye.
+  ASSERT_FALSE(Inside(normals, Direction(kPi, 0.0)));
+
+  for (auto const &n : normals)
+    ASSERT_NEAR(1.0, n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1e-12);
+}
+
+TEST(CullingTest, KeepsQuadruplesInOrder) {
+  auto const normals = FrustumNormals(Perspective(10.0 * kRad, 10.0 * kRad));
+  std::vector<float> quads;
+  std::vector<float> expected;
+  for (int i = 0; i < 100; ++i) {
+    // Every third star within the view, the rest off to the right.
+    auto const v = Direction((i % 3 == 0 ? 0.1 : 0.5) * i / 100.0, 0.0);
+    float const quad[] = {float(v[0]), float(v[1]), float(v[2]), float(i)};
+    quads.insert(quads.end(), quad, quad + 4);
+    if (i % 3 == 0 || 0.5 * i / 100.0 < 10.0 * kRad)
+      expected.insert(expected.end(), quad, quad + 4);
+  }
+
+  auto const kept = CullQuadruples(normals, 0.0, quads);
+  ASSERT_EQ(expected.size() / 4, kept);
+  quads.resize(4 * kept);
+  ASSERT_EQ(expected, quads);
+
+  // The margin lets in stars next to the sides.
+  std::vector<float> edge{0.0f, 0.0f, -1.0f, 1.0f};
+  auto const v = Direction(10.5 * kRad, 0.0);
+  edge.insert(edge.end(), {float(v[0]), float(v[1]), float(v[2]), 2.0f});
+  ASSERT_EQ(1u, CullQuadruples(normals, 0.0, edge));
+  ASSERT_EQ(2u, CullQuadruples(normals, 1.0 * kRad, edge));
+}
+
+TEST(CullingTest, PlanesRejectCaps) {
+  auto const normals = FrustumNormals(Perspective(10.0 * kRad, 10.0 * kRad));
+  ASSERT_EQ(SkyOverlap::Inside,  PlanesOverlap(normals, Direction(0.0, 0.0), 1.0 * kRad));
+  ASSERT_EQ(SkyOverlap::Partial, PlanesOverlap(normals, Direction(10.0 * kRad, 0.0), 1.0 * kRad));
+  ASSERT_EQ(SkyOverlap::Outside, PlanesOverlap(normals, Direction(0.0, 20.0 * kRad), 5.0 * kRad));
+  ASSERT_EQ(SkyOverlap::Outside, PlanesOverlap(normals, Direction(kPi, 0.0), 30.0 * kRad));
+}
@@ -0,0 +1,77 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/ephemeris.hxx"
+#include "the/lib/common/sun.hxx"
+
+using namespace the;
+
+namespace {
+
+double Distance(Vec3 const &a, Vec3 const &b) {
+  auto const d = a - b;
+  return std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+}
+
+}
+
+TEST(ChebyshevEphemerisTest, FitsPolynomialsExactly) {
+  auto const cubic = [](double const t) {
+    return Vec3{1.0 + t, 2.0 * t * t - 0.5, t * t * t - t};
+  };
+  auto const ephemeris = ChebyshevEphemeris::Fit(cubic, -2.0, 3.0, 0.7, 3);
+  ASSERT_EQ(-2.0, ephemeris.Begin());
+  ASSERT_GE(ephemeris.End(), 3.0);
+  ASSERT_FALSE(ephemeris.Covers(-2.1));
+  for (double t = -2.0; t <= 3.0; t += 0.01) {
+    ASSERT_TRUE(ephemeris.Covers(t));
+    ASSERT_LT(Distance(cubic(t), ephemeris(t)), 1e-12) << t;
+  }
+  ASSERT_FALSE(ChebyshevEphemeris{}.Covers(0.0));
+}
+
+TEST(ChebyshevEphemerisTest, MatchesSunPos) {
+  // A century either side of J2000, off the nodes and the ends of segments.
+  auto const ephemeris = FitSunPos(-1.0, 1.0);
+  for (int i = 0; i < 100000; ++i) {
+    double const T = -1.0 + 2.0 * (i + 0.37) / 100000.0;
+    ASSERT_LT(Distance(SunPos(T), SunPos(ephemeris, T)), 1e-12) << T;
+  }
+  // Beyond the ephemeris the series is summed up.
+  ASSERT_EQ(SunPos(1.5), SunPos(ephemeris, 1.5));
+}
+
+TEST(ChebyshevEphemerisTest, WritesAndOpens) {
+  std::string const fpath = ::testing::TempDir() + "ephemeris-test.eph";
+  auto const ephemeris = FitSunPos(0.2, 0.3);
+  ASSERT_TRUE(ephemeris.Write(fpath.c_str()));
+
+  auto opened = ChebyshevEphemeris::Open(fpath.c_str());
+  ASSERT_TRUE(opened);
+  ASSERT_EQ(ephemeris.Begin(), opened->Begin());
+  ASSERT_EQ(ephemeris.End(), opened->End());
+  for (double T = 0.2; T <= 0.3; T += 0.001)
+    ASSERT_EQ(ephemeris(T), (*opened)(T));
+
+  // A degree out of range would wrap the count of terms.
+  if (auto *file = std::fopen(fpath.c_str(), "r+b")) {
+    std::uint32_t const degree = UINT32_MAX;
+    std::fseek(file, offsetof(EphemerisHeader, Degree), SEEK_SET);
+    std::fwrite(&degree, sizeof(degree), 1, file);
+    std::fclose(file);
+  }
+  ASSERT_FALSE(ChebyshevEphemeris::Open(fpath.c_str()));
+
+  if (auto *file = std::fopen(fpath.c_str(), "r+b")) {
+    std::fputs("NOTEPHEM", file);
+    std::fclose(file);
+  }
+  ASSERT_FALSE(ChebyshevEphemeris::Open(fpath.c_str()));
+  ASSERT_FALSE(ChebyshevEphemeris::Open((fpath + ".missing").c_str()));
+
+  std::remove(fpath.c_str());
+}
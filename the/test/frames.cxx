@@ -0,0 +1,82 @@
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/consts.hxx"
+#include "the/lib/common/frames.hxx"
+#include "the/lib/common/precnut.hxx"
+#include "the/lib/common/spheric.hxx"
+#include "the/lib/common/time.hxx"
+
+using namespace the;
+
+namespace {
+
+void ExpectNear(Mat3 const &expected, Mat3 const &actual, double const error) {
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      EXPECT_NEAR(expected[i][j], actual[i][j], error) << i << ' ' << j;
+  }
+}
+
+}
+
+TEST(FramesTest, NutationMatchesMeeus) {
+  // 1987 April 10 at 0h TD, example 22.a of Meeus, Astronomical Algorithms:
+  // nutation in longitude -3.788" and in obliquity +9.443".
+  double const T = (MJD(1987, 4, 10, 0, 0, 0.0) - kMJD_J2000) / 36525.0;
+  // The mean pole of date seen from the true equator.
+  auto const pole = NutMatrix(T) * Vec3{0.0, 0.0, 1.0};
+  EXPECT_NEAR(-3.788, -pole[0] / std::sin(EclipticObliquity(T)) * kArcs, 0.5);
+  EXPECT_NEAR(9.443, -pole[1] * kArcs, 0.5);
+}
+
+TEST(FramesTest, ComposesMatrices) {
+  double const T = 0.26;
+  auto const frames = MakeFrames(T);
+  ExpectNear(PrecMatrixEcl(0.0, T), frames[Frame::PrecEcl], 0.0);
+  ExpectNear(Ecl2EquMatrix(T), frames[Frame::Ecl2Equ], 0.0);
+  ExpectNear(NutMatrix(T) * Ecl2EquMatrix(T), frames[Frame::Ecl2True], 0.0);
+  // Precession of the ecliptic turned into the equator is that of the equator,
+  // the two series agreeing to 0.01".
+  ExpectNear(NutMatrix(T) * Ecl2EquMatrix(T) * PrecMatrixEcl(0.0, T) * Equ2EclMatrix(0.0),
+             frames[Frame::J2000ToTrue], 5e-8);
+}
+
+TEST(FramesTest, InterpolatesBetweenNodes) {
+  FrameCache cache;
+  std::mt19937_64 random(25);
+  std::uniform_real_distribution<double> epochs(-2.0, 2.0);
+  for (int k = 0; k < 1000; ++k) {
+    double const T = epochs(random);
+    auto const expected = MakeFrames(T);
+    for (std::size_t f = 0; f < kFrames; ++f) {
+      auto const frame = static_cast<Frame>(f);
+      ExpectNear(expected[frame], cache.At(frame, T), 1e-10);
+    }
+  }
+}
+
+TEST(FramesTest, BatchesMatchSingleEpochs) {
+  FrameCache cache;
+  double T[50];
+  for (int i = 0; i < 50; ++i)
+    T[i] = 0.26 + 0.3 * kFrameStep * double(i);
+  Mat3 batch[50];
+  cache.At(Frame::J2000ToTrue, T, batch);
+  for (int i = 0; i < 50; ++i)
+    ExpectNear(FrameCache::Shared().At(Frame::J2000ToTrue, T[i]), batch[i], 0.0);
+}
+
+TEST(FramesTest, ThreadsKeepCachesOfTheirOwn) {
+  FrameCache *other = nullptr;
+  Mat3 matrix;
+  std::thread thread([&] {
+    other = &FrameCache::Shared();
+    matrix = FrameCache::Shared().At(Frame::Ecl2True, 0.26);
+  });
+  thread.join();
+  EXPECT_NE(&FrameCache::Shared(), other);
+  ExpectNear(FrameCache::Shared().At(Frame::Ecl2True, 0.26), matrix, 0.0);
+}
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/perturbations.hxx"
+#include "the/lib/common/simdmath.hxx"
+#include "the/lib/common/sun.hxx"
+
+using namespace the;
+
+namespace {
+
+PertTerm constexpr kTerms[] = {
+  { 1,  0, 0, -0.22, 6892.76, -16707.37, -0.54, 0.00,  0.00},
+  { 1,  0, 1, -0.06,  -17.35,     42.04, -0.15, 0.00,  0.00},
+  { 1,  0, 2, -0.01,   -0.05,      0.13, -0.02, 0.00,  0.00},
+  { 0, -1, 0,  0.03,   -0.07,     -0.16, -0.07, 0.02, -0.02},
+  {-1, -3, 0, -0.03,   -0.21,      0.38, -0.06, 0.00, -0.02},
+  { 4, -2, 0,  0.03,   -0.03,      0.10,  0.09, 0.01, -0.01},
+};
+PertSeries constexpr kSeries{-1, 4, -3, 0, kTerms, std::size(kTerms)};
+static_assert(Valid(kSeries));
+
+// Multiples out of the ranges, and powers of T not following their term.
+PertSeries constexpr kOutOfRange{0, 4, -3, 0, kTerms, std::size(kTerms)};
+static_assert(!Valid(kOutOfRange));
+PertSeries constexpr kOrphanPower{-1, 4, -3, 0, kTerms + 1, std::size(kTerms) - 1};
+static_assert(!Valid(kOrphanPower));
+
+/// Runs a test with every instruction set the CPU has.
+template <typename Fn>
+void ForEachIsa(Fn &&fn) {
+  for (auto const isa : {simd::Isa::Scalar, simd::Isa::SSE2, simd::Isa::AVX2}) {
+    if (isa > simd::SupportedIsa())
+      continue;
+    simd::UseIsa(isa);
+    SCOPED_TRACE(static_cast<int>(isa));
+    fn();
+  }
+  simd::UseIsa(simd::SupportedIsa());
+}
+
+}
+
+TEST(PerturbationsTest, SumsTermsInLanes) {
+  // A size not divisible by the widths of vectors leaves a tail.
+  std::size_t const n = 37;
+  std::vector<double> T(n), CM(n), SM(n), Cm(n), Sm(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    T[i] = -2.0 + 0.11 * double(i);
+    CM[i] = std::cos(0.3 * double(i));
+    SM[i] = std::sin(0.3 * double(i));
+    Cm[i] = std::cos(1.0 - 0.7 * double(i));
+    Sm[i] = std::sin(1.0 - 0.7 * double(i));
+  }
+
+  ForEachIsa([&] {
+    std::vector<double> dl(n, 1.0), dr(n, 2.0), db(n, 3.0);
+    AddPerturbations(kSeries, {T, CM, SM, Cm, Sm, dl, dr, db});
+    for (std::size_t i = 0; i < n; ++i) {
+      double l = 1.0, r = 2.0, b = 3.0;
+      for (auto const &term : kTerms) {
+        double const angle = term.I * 0.3 * double(i) + term.i * (1.0 - 0.7 * double(i));
+        double const power = std::pow(T[i], term.iT);
+        l += power * (term.dlc * std::cos(angle) + term.dls * std::sin(angle));
+        r += power * (term.drc * std::cos(angle) + term.drs * std::sin(angle));
+        b += power * (term.dbc * std::cos(angle) + term.dbs * std::sin(angle));
+      }
+      ASSERT_NEAR(l, dl[i], 1e-9) << i;
+      ASSERT_NEAR(r, dr[i], 1e-9) << i;
+      ASSERT_NEAR(b, db[i], 1e-9) << i;
+    }
+  });
+}
+
+TEST(PerturbationsTest, SunPosBatchesMatchScalar) {
+  ForEachIsa([] {
+    // Sizes about the batches of the series leave tails.
+    for (std::size_t const n : {0, 1, 127, 128, 1000}) {
+      std::vector<double> T(n);
+      for (std::size_t i = 0; i < n; ++i)
+        T[i] = -1.0 + 0.0021 * double(i);
+      std::vector<Vec3> out(n);
+      SunPos(T, out);
+      for (std::size_t i = 0; i < n; ++i)
+        ASSERT_EQ(SunPos(T[i]), out[i]) << T[i];
+    }
+  });
+}
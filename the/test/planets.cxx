@@ -0,0 +1,69 @@
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/consts.hxx"
+#include "the/lib/common/planets.hxx"
+#include "the/lib/common/spheric.hxx"
+#include "the/lib/common/sun.hxx"
+#include "the/lib/common/time.hxx"
+
+using namespace the;
+
+TEST(PlanetsTest, MatchesMeeus) {
+  // Venus on 1992 December 20 at 0h TD, of VSOP87 in Meeus, Astronomical
+  // Algorithms, example 32.a.
+  double const T = (MJD(1992, 12, 20, 0, 0, 0.0) - kMJD_J2000) / 36525.0;
+  EphemerisFrame frame;
+  frame.Update({&T, 1});
+  auto const venus = MakePolar(frame.Heliocentric(Planet::Venus)[0]);
+  ASSERT_NEAR(26.11428, std::remainder(kDeg * venus.Phi, 360.0), 0.01);
+  ASSERT_NEAR(-2.62070, kDeg * venus.Theta, 0.01);
+  ASSERT_NEAR(0.724603, venus.R, 1e-4);
+
+  // Apparent right ascension and declination of example 33.a, 21h04m41.454s and -18d53'16.84".
+  auto const equ = MakePolar(Ecl2EquMatrix(T) * frame.Geocentric(Planet::Venus)[0]);
+  ASSERT_NEAR(316.17273, kDeg * equ.Phi + 360.0, 0.01);
+  ASSERT_NEAR(-18.88801, kDeg * equ.Theta, 0.01);
+}
+
+TEST(PlanetsTest, StaysOnOrbits) {
+  double const axes[kPlanets] = {0.387, 0.723, 1.524, 5.203, 9.537, 19.189, 30.070, 39.482};
+  double const eccentricities[kPlanets] = {0.206, 0.007, 0.093, 0.048, 0.054, 0.047, 0.009, 0.249};
+  std::vector<double> T(1000);
+  for (std::size_t i = 0; i < T.size(); ++i)
+    T[i] = -1.0 + 0.0015 * double(i);
+  EphemerisFrame frame;
+  frame.Update(T);
+  for (std::size_t p = 0; p < kPlanets; ++p) {
+    auto const planet = static_cast<Planet>(p);
+    for (std::size_t i = 0; i < T.size(); ++i) {
+      auto const helio = MakePolar(frame.Heliocentric(planet)[i]);
+      ASSERT_GE(helio.R, axes[p] * (1.0 - eccentricities[p]) * 0.999) << p << ' ' << T[i];
+      ASSERT_LE(helio.R, axes[p] * (1.0 + eccentricities[p]) * 1.001) << p << ' ' << T[i];
+      ASSERT_LT(std::abs(helio.Theta), 17.2 * kRad) << p << ' ' << T[i];
+      ASSERT_EQ(frame.Heliocentric(planet)[i] + frame.Sun()[i], frame.Geocentric(planet)[i]);
+    }
+  }
+}
+
+TEST(PlanetsTest, BatchesMatchSingleEpochs) {
+  // Sizes not divisible by the vector width leave tails.
+  std::vector<double> T(37);
+  for (std::size_t i = 0; i < T.size(); ++i)
+    T[i] = 0.2 - 0.031 * double(i);
+  EphemerisFrame batch, single;
+  batch.Update(T);
+  ASSERT_EQ(37, batch.Size());
+  for (std::size_t i = 0; i < T.size(); ++i) {
+    auto const sun = SunPos(T[i]);
+    single.Update({&T[i], 1}, {&sun, 1});
+    ASSERT_EQ(1, single.Size());
+    ASSERT_EQ(batch.Sun()[i], single.Sun()[0]);
+    for (std::size_t p = 0; p < kPlanets; ++p) {
+      auto const planet = static_cast<Planet>(p);
+      ASSERT_EQ(batch.Heliocentric(planet)[i], single.Heliocentric(planet)[0]) << p;
+      ASSERT_EQ(batch.Geocentric(planet)[i], single.Geocentric(planet)[0]) << p;
+    }
+  }
+}
@@ -0,0 +1,130 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/ppmxlingest.hxx"
+
+using namespace the;
+
+namespace {
+
+std::string MakeText(int const rows) {
+  std::ostringstream ss;
+  for (int i = 0; i < rows; ++i) {
+    ss << 1000 + i << '|' << i * 0.5 << '|' << -i * 0.25
+       << "|0|0|0|0|0|0|1|2000|2000|" << (i % 3 ? std::to_string(i * 0.01) : "None") << "|0.1";
+    if (i + 1 < rows)
+      ss << '\n';
+  }
+  return ss.str();
+}
+
+std::string Gzip(std::string const &text) {
+  z_stream zs = {};
+  deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&zs, text.size()), '\0');
+  zs.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+  zs.avail_in  = static_cast<uInt>(text.size());
+  zs.next_out  = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return out;
+}
+
+}
+
+TEST(PPMXLIngestTest, KeepsOrderAcrossChunksAndThreads) {
+  auto const text = MakeText(1000);
+  PPMXLParser const parser{kPositionPPMXLColumns};
+
+  for (unsigned threads : {1u, 3u, 8u}) {
+    for (std::size_t chunkSize : {1ul, 100ul, 4096ul, kPPMXLChunkSize}) {
+      std::vector<std::uint64_t> ipix;
+      auto const rows = IngestPPMXL(parser, {text.data(), static_cast<std::ptrdiff_t>(text.size())},
+                                    0, threads, [&](PPMXLReader::Row const &row) {
+                                      ipix.push_back(row.Ipix);
+                                    }, chunkSize);
+      ASSERT_EQ(1000u, rows);
+      ASSERT_EQ(1000u, ipix.size());
+      for (std::size_t i = 0; i < ipix.size(); ++i)
+        ASSERT_EQ(1000 + i, ipix[i]) << "threads=" << threads << " chunkSize=" << chunkSize;
+    }
+  }
+}
+
+TEST(PPMXLIngestTest, StopsAtLimit) {
+  auto const text = MakeText(1000);
+  PPMXLParser const parser{kPositionPPMXLColumns};
+
+  std::vector<std::uint64_t> ipix;
+  auto const rows = IngestPPMXL(parser, {text.data(), static_cast<std::ptrdiff_t>(text.size())},
+                                123, 4, [&](PPMXLReader::Row const &row) {
+                                  ipix.push_back(row.Ipix);
+                                }, 64);
+  ASSERT_EQ(123u, rows);
+  ASSERT_EQ(123u, ipix.size());
+  ASSERT_EQ(1122u, ipix.back());
+}
+
+TEST(PPMXLIngestTest, ReaderReadsStreamInParallel) {
+  auto const text = MakeText(5000);
+
+  {
+    std::istringstream is{text};
+    PPMXLReader reader{is};
+    std::vector<std::uint64_t> ipix;
+    ASSERT_EQ(5000u, reader.ReadParallel(PPMXLParser{kPositionPPMXLColumns}, 4, [&](PPMXLReader::Row const &row) {
+      ipix.push_back(row.Ipix);
+    }));
+    for (std::size_t i = 0; i < ipix.size(); ++i)
+      ASSERT_EQ(1000 + i, ipix[i]);
+  }
+
+  {
+    std::istringstream is{text};
+    PPMXLReader reader{is, 10};
+    ASSERT_EQ(10u, reader.ReadParallel(PPMXLParser{kPositionPPMXLColumns}, 4, [](PPMXLReader::Row const &) {}));
+    ASSERT_EQ(0u, reader.ReadParallel(PPMXLParser{kPositionPPMXLColumns}, 4, [](PPMXLReader::Row const &) {}));
+  }
+}
+
+TEST(PPMXLIngestTest, ReaderInflatesGzipStream) {
+  auto const text = MakeText(5000);
+  // Two gzip members one after another, as produced by `cat a.gz b.gz`.
+  auto const half = text.find('\n', text.size() / 2) + 1;
+  std::istringstream is{Gzip(text.substr(0, half)) + Gzip(text.substr(half))};
+
+  PPMXLReader reader{is};
+  PPMXLIngestStats stats;
+  std::vector<std::uint64_t> ipix;
+  auto const rows = reader.ReadGzip(PPMXLParser{kPositionPPMXLColumns}, 4, [&](PPMXLReader::Row const &row) {
+    ipix.push_back(row.Ipix);
+  }, &stats);
+  ASSERT_TRUE(rows);
+  ASSERT_EQ(5000u, *rows);
+  for (std::size_t i = 0; i < ipix.size(); ++i)
+    ASSERT_EQ(1000 + i, ipix[i]);
+  ASSERT_EQ(text.size(), stats.TextBytes.load());
+  ASSERT_EQ(is.str().size(), stats.InputBytes.load());
+  ASSERT_EQ(5000u, stats.ParsedRows.load());
+}
+
+TEST(PPMXLIngestTest, ReaderReportsCorruptGzip) {
+  auto data = Gzip(MakeText(100));
+  data[data.size() / 2] ^= 0x55;
+  data[data.size() / 2 + 1] ^= 0x55;
+  std::istringstream is{data};
+
+  PPMXLReader reader{is};
+  auto const rows = reader.ReadGzip(PPMXLParser{kPositionPPMXLColumns}, 2, [](PPMXLReader::Row const &) {});
+  ASSERT_FALSE(rows);
+
+  std::istringstream truncated{Gzip(MakeText(100)).substr(0, 100)};
+  PPMXLReader truncatedReader{truncated};
+  ASSERT_FALSE(truncatedReader.ReadGzip(PPMXLParser{kPositionPPMXLColumns}, 2, [](PPMXLReader::Row const &) {}));
+}
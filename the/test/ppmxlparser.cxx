@@ -0,0 +1,165 @@
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/ppmxlparser.hxx"
+
+using namespace the;
+
+namespace {
+
+char const kRow[] =
+    "161387954652791|314.709206|35.640741|2.31e-05|2.31e-05|-4.9444e-07|-1.3944e-06|"
+    "1.17e-06|1.17e-06|6|1984.55|1984.55|15.634|0.047|15.238|0.094|15.264|0.170|"
+    "18.29|18.22|16.57|16.77|16.64|02137|0|-1.3633e-07|-1.0106e-07";
+
+char const kRowWithNones[] =
+    "161387954652792|314.709207|35.640742|2.31e-05|2.31e-05|-4.9444e-07|-1.3944e-06|"
+    "1.17e-06|1.17e-06|6|1984.55|1984.55|None|None|None|None|None|None|"
+    "18.29|18.22|16.57|16.77|16.64|02137|0|None|None";
+
+}
+
+TEST(PPMXLParserTest, ParsesAllColumns) {
+  PPMXLParser const parser;
+  PPMXLReader::Row row;
+
+  ASSERT_TRUE(parser.ParseRow(kRow, kRow + sizeof(kRow) - 1, row));
+  ASSERT_EQ(161387954652791ull, row.Ipix);
+  ASSERT_DOUBLE_EQ(314.709206, row.RaJ2000);
+  ASSERT_DOUBLE_EQ(35.640741, row.DecJ2000);
+  ASSERT_DOUBLE_EQ(-4.9444e-07, row.PmRA);
+  ASSERT_DOUBLE_EQ(-1.3944e-06, row.PmDE);
+  ASSERT_EQ(6u, row.NObs);
+  ASSERT_DOUBLE_EQ(15.634, row.Jmag);
+  ASSERT_DOUBLE_EQ(15.264, row.Kmag);
+  ASSERT_DOUBLE_EQ(16.64, row.Imag);
+  ASSERT_EQ("02137", row.MagSurveys);
+  ASSERT_EQ("0", row.Flags);
+  ASSERT_DOUBLE_EQ(-1.0106e-07, row.VickersPMDE);
+}
+
+TEST(PPMXLParserTest, ParsesNoneAsNaN) {
+  PPMXLParser const parser;
+  PPMXLReader::Row row;
+
+  ASSERT_TRUE(parser.ParseRow(kRowWithNones, kRowWithNones + sizeof(kRowWithNones) - 1, row));
+  ASSERT_DOUBLE_EQ(314.709207, row.RaJ2000);
+  ASSERT_TRUE(std::isnan(row.Jmag));
+  ASSERT_TRUE(std::isnan(row.E_Kmag));
+  ASSERT_DOUBLE_EQ(18.29, row.B1mag);
+  ASSERT_TRUE(std::isnan(row.VickersPMRA));
+}
+
+TEST(PPMXLParserTest, FillsOnlyRequestedColumns) {
+  PPMXLParser const parser{ColumnBit(PPMXLColumn::RaJ2000) | ColumnBit(PPMXLColumn::Jmag)};
+  PPMXLReader::Row row{};
+  row.Hmag = 42.0;
+
+  ASSERT_TRUE(parser.ParseRow(kRow, kRow + sizeof(kRow) - 1, row));
+  ASSERT_EQ(0u, row.Ipix);
+  ASSERT_DOUBLE_EQ(314.709206, row.RaJ2000);
+  ASSERT_DOUBLE_EQ(0.0, row.DecJ2000);
+  ASSERT_DOUBLE_EQ(15.634, row.Jmag);
+  ASSERT_DOUBLE_EQ(42.0, row.Hmag);
+
+  // Fields past the last requested one may be absent.
+  char const truncated[] = "1|2.5|3.5|0|0|0|0|0|0|1|2000|2000|7.25";
+  ASSERT_TRUE(parser.ParseRow(truncated, truncated + sizeof(truncated) - 1, row));
+  ASSERT_DOUBLE_EQ(7.25, row.Jmag);
+  ASSERT_FALSE(parser.ParseRow(truncated, truncated + 10, row));
+}
+
+TEST(PPMXLParserTest, ParsesBuffer) {
+  std::string const buffer = std::string{kRow} + "\r\n\n" + kRowWithNones + '\n' + kRow;
+  PPMXLParser const parser{kPositionPPMXLColumns};
+
+  std::vector<std::uint64_t> ipix;
+  auto const *rest = parser.Parse(buffer.data(), buffer.data() + buffer.size(),
+                                  [&](PPMXLReader::Row const &row) {
+                                    ipix.push_back(row.Ipix);
+                                    return true;
+                                  });
+  ASSERT_EQ(2u, ipix.size());
+  ASSERT_EQ(161387954652791ull, ipix[0]);
+  ASSERT_EQ(161387954652792ull, ipix[1]);
+  // The trailing row is incomplete until its newline arrives.
+  ASSERT_EQ(std::string{kRow}, std::string(rest, buffer.data() + buffer.size()));
+}
+
+TEST(PPMXLParserTest, ReaderReadsUpToLimit) {
+  std::string text;
+  for (int i = 0; i < 10; ++i)
+    text += std::string{kRow} + '\n';
+  text += kRowWithNones;  // no trailing newline
+
+  {
+    std::istringstream is{text};
+    PPMXLReader reader{is};
+    std::size_t count = 0;
+    ASSERT_EQ(11u, reader.Read(PPMXLParser{}, [&](PPMXLReader::Row const &) { ++count; }));
+    ASSERT_EQ(11u, count);
+  }
+
+  {
+    std::istringstream is{text};
+    PPMXLReader reader{is, 4};
+    ASSERT_EQ(4u, reader.Read(PPMXLParser{}, [](PPMXLReader::Row const &) {}));
+  }
+}
+
+TEST(PPMXLParserTest, FiltersByMagnitudeBoxAndIpix) {
+  PPMXLReader::Row row{};
+  auto const *end = kRow + sizeof(kRow) - 1;
+
+  ASSERT_TRUE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Magnitude(PPMXLColumn::Jmag, 15.0, 16.0))
+              .ParseRow(kRow, end, row));
+  ASSERT_DOUBLE_EQ(314.709206, row.RaJ2000);
+  ASSERT_FALSE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Magnitude(PPMXLColumn::Jmag, 0.0, 2.5))
+               .ParseRow(kRow, end, row));
+  ASSERT_FALSE(PPMXLParser(kAllPPMXLColumns, PPMXLFilter{}.Magnitude(PPMXLColumn::Imag, 0.0, 16.0))
+               .ParseRow(kRow, end, row));
+
+  ASSERT_TRUE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Box(314.0, 315.0, 35.0, 36.0))
+              .ParseRow(kRow, end, row));
+  ASSERT_TRUE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Box(300.0, 10.0, 35.0, 36.0))
+              .ParseRow(kRow, end, row));
+  ASSERT_FALSE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Box(320.0, 10.0, 35.0, 36.0))
+               .ParseRow(kRow, end, row));
+
+  ASSERT_TRUE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Ipix(161387954652791ull, 161387954652791ull))
+              .ParseRow(kRow, end, row));
+  ASSERT_FALSE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Ipix(0, 161387954652790ull))
+               .ParseRow(kRow, end, row));
+
+  // Missing magnitudes never pass.
+  ASSERT_FALSE(PPMXLParser(kPositionPPMXLColumns, PPMXLFilter{}.Magnitude(PPMXLColumn::Jmag, -100.0, 100.0))
+               .ParseRow(kRowWithNones, kRowWithNones + sizeof(kRowWithNones) - 1, row));
+}
+
+TEST(PPMXLParserTest, ParsesFilterSpec) {
+  auto filter = PPMXLFilter::Parse("Jmag::2.5,RaJ2000:300:10,Ipix:5:");
+  ASSERT_TRUE(filter);
+  ASSERT_EQ(ColumnBit(PPMXLColumn::Jmag) | ColumnBit(PPMXLColumn::RaJ2000) | ColumnBit(PPMXLColumn::Ipix),
+            filter->Columns());
+
+  PPMXLReader::Row row{};
+  row.Ipix = 5;
+  row.RaJ2000 = 5.0;
+  row.Jmag = 1.0;
+  ASSERT_TRUE(filter->Accepts(row));
+  row.Jmag = 2.6;
+  ASSERT_FALSE(filter->Accepts(row));
+
+  ASSERT_FALSE(PPMXLFilter::Parse("Jmag:1"));
+  ASSERT_FALSE(PPMXLFilter::Parse("Zmag:1:2"));
+  ASSERT_FALSE(PPMXLFilter::Parse("Jmag:x:2"));
+  ASSERT_FALSE(PPMXLFilter::Parse("Jmag:1:nan"));
+
+  // Bounds of Ipix as doubles saturate, and NaN ones pass nothing.
+  ASSERT_TRUE(PPMXLFilter{}.Range(PPMXLColumn::Ipix, -1.0, 1e30).Accepts(row));
+  ASSERT_FALSE(PPMXLFilter{}.Range(PPMXLColumn::Ipix, 0.0, NAN).Accepts(row));
+  ASSERT_FALSE(PPMXLFilter{}.Range(PPMXLColumn::Ipix, NAN, 10.0).Accepts(row));
+}
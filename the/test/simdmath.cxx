@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/simdmath.hxx"
+
+using namespace the;
+
+namespace {
+
+/// Returns values spread evenly over bit patterns of finite values of both
+/// signs, zeros, subnormals and infinities included.
+template <typename S, typename Bits>
+std::vector<S> FullRange(Bits const samples) {
+  S const inf = std::numeric_limits<S>::infinity();
+  Bits infBits;
+  std::memcpy(&infBits, &inf, sizeof(inf));
+
+  std::vector<S> values;
+  for (Bits i = 0; i <= samples; ++i) {
+    Bits const bits = infBits / samples * i;
+    S value;
+    std::memcpy(&value, &bits, sizeof(value));
+    values.push_back(value);
+    values.push_back(-value);
+  }
+  values.push_back(std::numeric_limits<S>::quiet_NaN());
+  return values;
+}
+
+/// Returns the error of got in ulps of S at the reference, or 0 if both are
+/// the same NaN, infinity or zero.
+template <typename S>
+double Ulps(S const value, double const expected) {
+  auto const got = static_cast<double>(value);
+  if (std::isnan(expected))
+    return std::isnan(got) ? 0.0 : HUGE_VAL;
+  if (std::isinf(expected) || expected == 0.0)
+    return got == expected && std::signbit(got) == std::signbit(expected) ? 0.0 : HUGE_VAL;
+  int const exponent = std::max(std::ilogb(static_cast<S>(expected)), std::numeric_limits<S>::min_exponent - 1);
+  return std::abs(got - expected) / std::ldexp(1.0, exponent - std::numeric_limits<S>::digits + 1);
+}
+
+template <typename S>
+struct Bounds;
+
+template <>
+struct Bounds<double> {
+  static constexpr double kSinCos = 2.0, kSinCosAbs = 0.0, kAtan2 = 2.0, kAsin = 2.0;
+};
+
+template <>
+struct Bounds<float> {
+  static constexpr double kSinCos = 3.0, kSinCosAbs = 1e-11, kAtan2 = 3.0, kAsin = 4.0;
+};
+
+/// Checks every function of element type S against libm in double.
+template <typename S, typename Bits>
+void ExpectBounds(Bits const samples) {
+  using B = Bounds<S>;
+  auto const x = FullRange<S>(samples);
+  auto const n = x.size();
+
+  std::vector<S> sin(n), cos(n);
+  simd::SinCos(gsl::span<S const>(x), gsl::span<S>(sin), gsl::span<S>(cos));
+  for (std::size_t i = 0; i < n; ++i) {
+    double const expectedSin = std::sin(double(x[i]));
+    double const expectedCos = std::cos(double(x[i]));
+    if (Ulps(sin[i], expectedSin) > B::kSinCos) {
+      ASSERT_NEAR(expectedSin, sin[i], B::kSinCosAbs) << "sin " << x[i];
+    }
+    if (Ulps(cos[i], expectedCos) > B::kSinCos) {
+      ASSERT_NEAR(expectedCos, cos[i], B::kSinCosAbs) << "cos " << x[i];
+    }
+  }
+
+  // Every x against a y of another magnitude.
+  std::vector<S> y(n), atan2(n);
+  for (std::size_t i = 0; i < n; ++i)
+    y[i] = x[i * 7919 % n];
+  simd::Atan2(gsl::span<S const>(y), gsl::span<S const>(x), gsl::span<S>(atan2));
+  for (std::size_t i = 0; i < n; ++i)
+    ASSERT_LE(Ulps(atan2[i], std::atan2(double(y[i]), double(x[i]))), B::kAtan2) << "atan2 " << y[i] << ' ' << x[i];
+
+  std::vector<S> unit;
+  for (auto const value : x) {
+    if (!(std::abs(value) > S(1)))
+      unit.push_back(value);
+  }
+  unit.insert(unit.end(), {S(1), S(-1), S(1.5), -std::numeric_limits<S>::infinity()});
+  std::vector<S> asin(unit.size());
+  simd::Asin(gsl::span<S const>(unit), gsl::span<S>(asin));
+  for (std::size_t i = 0; i < unit.size(); ++i)
+    ASSERT_LE(Ulps(asin[i], std::asin(double(unit[i]))), B::kAsin) << "asin " << unit[i];
+}
+
+/// Runs a test with every instruction set the CPU has.
+template <typename Fn>
+void ForEachIsa(Fn &&fn) {
+  for (auto const isa : {simd::Isa::Scalar, simd::Isa::SSE2, simd::Isa::AVX2}) {
+    if (isa > simd::SupportedIsa())
+      continue;
+    simd::UseIsa(isa);
+    SCOPED_TRACE(static_cast<int>(isa));
+    fn();
+  }
+  simd::UseIsa(simd::SupportedIsa());
+}
+
+}
+
+TEST(SimdMathTest, DoubleKeepsErrorBounds) {
+  ForEachIsa([] { ExpectBounds<double>(std::uint64_t{1} << 16); });
+}
+
+TEST(SimdMathTest, FloatKeepsErrorBounds) {
+  ForEachIsa([] { ExpectBounds<float>(std::uint32_t{1} << 16); });
+}
+
+TEST(SimdMathTest, KeepsSpecialValues) {
+  double const inf = INFINITY;
+  std::vector<double> const special{0.0, -0.0, inf, -inf, NAN, 1.0, -1.0, 1e300, -1e-300};
+  ForEachIsa([&] {
+    for (double const y : special) {
+      std::vector<double> const ys(special.size(), y);
+      std::vector<double> out(special.size());
+      simd::Atan2(gsl::span<double const>(ys), gsl::span<double const>(special), gsl::span<double>(out));
+      for (std::size_t i = 0; i < special.size(); ++i)
+        ASSERT_LE(Ulps(out[i], std::atan2(y, special[i])), Bounds<double>::kAtan2) << y << ' ' << special[i];
+    }
+
+    // A tail shorter than a vector, and arguments beyond the reduction as libm gives them.
+    std::vector<double> const x{-0.0, 1e6, -3e15};
+    std::vector<double> sin(x.size()), cos(x.size());
+    simd::SinCos(gsl::span<double const>(x), gsl::span<double>(sin), gsl::span<double>(cos));
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      ASSERT_EQ(0.0, Ulps(sin[i], std::sin(x[i])));
+      ASSERT_EQ(0.0, Ulps(cos[i], std::cos(x[i])));
+    }
+  });
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/simdmath.hxx"
+#include "the/lib/common/starstore.hxx"
+
+using namespace the;
+
+namespace {
+
+CompactStar MakeStar(std::uint32_t const i) {
+  PPMXLReader::Row row;
+  row.RaJ2000  = (i % 3600) * 0.1;
+  row.DecJ2000 = (i % 1800) * 0.1 - 90.0;
+  row.PmRA     = 0.0;
+  row.PmDE     = 0.0;
+  // Every 7th star misses the magnitude.
+  row.Jmag     = i % 7 == 0 ? std::nan("") : (i % 20) * 1.0;
+  row.Kmag     = 0.0;
+  auto star = CompactStar::FromRow(row);
+  // Tells stars of equal magnitude apart.
+  star.Colour = static_cast<std::int16_t>(i % 30000);
+  return star;
+}
+
+/// Runs a test with every instruction set the CPU has.
+template <typename Fn>
+void ForEachIsa(Fn &&fn) {
+  for (auto const isa : {simd::Isa::Scalar, simd::Isa::SSE2, simd::Isa::AVX2}) {
+    if (isa > simd::SupportedIsa())
+      continue;
+    simd::UseIsa(isa);
+    SCOPED_TRACE(static_cast<int>(isa));
+    fn();
+  }
+  simd::UseIsa(simd::SupportedIsa());
+}
+
+}
+
+TEST(StarStoreTest, GrowsAlignedColumns) {
+  StarStore store;
+  std::uint32_t const n = kStarStoreBatch * 2 + 123;
+  for (std::uint32_t i = 0; i < n; ++i)
+    store.Append(MakeStar(i));
+
+  ASSERT_EQ(n, store.Size());
+  ASSERT_EQ(0u, store.Capacity() % kStarStoreBatch);
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(store.Ra().data()) % kStarStoreAlignment);
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(store.Mag().data()) % kStarStoreAlignment);
+  ASSERT_EQ(static_cast<std::ptrdiff_t>(n), store.Dec().size());
+  for (std::uint32_t i = 0; i < n; ++i) {
+    auto const expected = MakeStar(i);
+    ASSERT_EQ(expected.Ra, store.Ra()[i]);
+    ASSERT_EQ(expected.Dec, store.Dec()[i]);
+    ASSERT_EQ(expected.Mag, store[i].Mag);
+  }
+
+  StarStore moved = std::move(store);
+  ASSERT_EQ(n, moved.Size());
+  ASSERT_TRUE(store.Empty());
+}
+
+TEST(StarStoreTest, SortsByMagnitude) {
+  StarStore store;
+  std::uint32_t const n = 10000;
+  for (std::uint32_t i = 0; i < n; ++i)
+    store.Append(MakeStar(i));
+  store.SortByMagnitude();
+
+  auto const mags = store.Mag();
+  for (std::uint32_t i = 1; i < n; ++i) {
+    ASSERT_LE(mags[i - 1], mags[i]);
+    if (mags[i - 1] == mags[i]) {
+      ASSERT_LT(store.Colour()[i - 1], store.Colour()[i]);
+    }
+  }
+  ASSERT_TRUE(std::isnan(store[n - 1].Jmag()));
+
+  std::size_t brighter = 0;
+  for (std::uint32_t i = 0; i < n; ++i)
+    brighter += i % 7 != 0 && i % 20 <= 5;
+  ASSERT_EQ(brighter, store.CountBrighter(5.0));
+  ASSERT_EQ(0u, store.CountBrighter(-1.0));
+  ASSERT_EQ(n - (n + 6) / 7, store.CountBrighter(INFINITY));
+}
+
+TEST(StarVectorsTest, RotatesIntoQuadruples) {
+  auto const rotation = Mat3::RotateY(0.3) * Mat3::RotateX(-1.1) * Mat3::RotateX(2.0).Transpose();
+  Mat3f rotationf;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      rotationf[i][j] = float(rotation[i][j]);
+  }
+
+  ForEachIsa([&] {
+    // Sizes not divisible by the widths of vectors leave tails to the scalar loop.
+    for (std::size_t const n : {0, 3, 8, 1003}) {
+      StarVectors vectors;
+      for (std::size_t i = 0; i < n; ++i)
+        vectors.Append(double(i) * 0.37, std::asin(double(i % 200) / 100.0 - 1.0), float(i));
+      ASSERT_EQ(n, vectors.Size());
+
+      std::vector<float> out(4 * n);
+      vectors.Rotate(rotationf, out);
+      for (std::size_t i = 0; i < n; ++i) {
+        double const ra  = double(i) * 0.37;
+        double const dec = std::asin(double(i % 200) / 100.0 - 1.0);
+        auto const v = rotation * Vec3{std::cos(dec) * std::cos(ra), std::cos(dec) * std::sin(ra), std::sin(dec)};
+        for (int k = 0; k < 3; ++k)
+          ASSERT_NEAR(v[k], out[4 * i + k], 1e-6);
+        ASSERT_EQ(float(i), out[4 * i + 3]);
+      }
+
+      // Ranges starting off the alignment of vectors give the same quadruples,
+      // up to the rounding of fused multiply-adds.
+      std::vector<float> pieces(4 * n);
+      for (std::size_t begin = 0; begin < n; begin += 13) {
+        auto const end = std::min(n, begin + 13);
+        auto const slice = gsl::span<float>(pieces).subspan(static_cast<std::ptrdiff_t>(4 * begin),
+                                                            static_cast<std::ptrdiff_t>(4 * (end - begin)));
+        vectors.Rotate(rotationf, slice, begin, end);
+      }
+      for (std::size_t i = 0; i < 4 * n; ++i)
+        ASSERT_NEAR(out[i], pieces[i], 1e-6);
+    }
+  });
+}
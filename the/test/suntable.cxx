@@ -0,0 +1,86 @@
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/consts.hxx"
+#include "the/lib/common/spheric.hxx"
+#include "the/lib/common/sun.hxx"
+#include "the/lib/common/suntable.hxx"
+#include "the/lib/common/textbuffer.hxx"
+
+using namespace the;
+
+TEST(TextBufferTest, FormatsWithoutGrowing) {
+  char buffer[16];
+  TextBuffer text{buffer};
+  text.Fixed(3.14159, 3).Put(',').Fixed(-0.5, 0).Put(";");
+  ASSERT_FALSE(text.Overflowed());
+  ASSERT_EQ("3.142,-0;", std::string(text.data(), text.size()));
+
+  // What does not fit is dropped whole.
+  text.Fixed(123456.789, 2);
+  ASSERT_TRUE(text.Overflowed());
+  ASSERT_EQ("3.142,-0;", std::string(text.data(), text.size()));
+  text.Put("0123456789");
+  ASSERT_EQ(9u, text.size());
+
+  text.Clear();
+  ASSERT_FALSE(text.Overflowed());
+  ASSERT_EQ(0u, text.size());
+}
+
+TEST(SunTableTest, MatchesSunPos) {
+  // A size not divisible by the batches leaves a tail.
+  std::size_t const n = 700, first = 13;
+  double const begin = 60000.0, step = 1.0 / 24.0;
+  std::vector<SunRow> rows(n);
+  SunTable(begin, step, first, rows);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    auto const &row = rows[i];
+    ASSERT_EQ(begin + step * double(first + i), row.MJD);
+    double const T = (row.MJD - kMJD_J2000) / 36525.0;
+    auto const ecl = SunPos(T);
+    auto const equ = MakePolar(Ecl2EquMatrix(T) * ecl);
+    ASSERT_NEAR(std::remainder(kDeg * MakePolar(ecl).Phi - row.L, 360.0), 0.0, 1e-9);
+    ASSERT_NEAR(kDeg * MakePolar(ecl).Theta, row.B, 1e-9);
+    ASSERT_NEAR(MakePolar(ecl).R, row.R, 1e-12);
+    ASSERT_NEAR(std::remainder(kDeg * equ.Phi - row.RA, 360.0), 0.0, 1e-9);
+    ASSERT_NEAR(kDeg * equ.Theta, row.Dec, 1e-9);
+    ASSERT_GE(row.L, 0.0);
+    ASSERT_LT(row.L, 360.0);
+    ASSERT_GE(row.RA, 0.0);
+    ASSERT_LT(row.RA, 360.0);
+  }
+}
+
+TEST(SunTableTest, FormatsCsv) {
+  SunRow rows[2];
+  SunTable(51544.5, 0.25, 0, rows);
+  std::vector<char> buffer(2 * kSunCsvRowSize);
+  TextBuffer text{{buffer.data(), static_cast<std::ptrdiff_t>(buffer.size())}};
+  for (auto const &row : rows)
+    FormatCsv(row, text);
+  ASSERT_FALSE(text.Overflowed());
+
+  std::string const csv(text.data(), text.size());
+  char const *p = csv.c_str();
+  for (auto const &row : rows) {
+    double fields[6];
+    for (int i = 0; i < 6; ++i) {
+      char *end;
+      fields[i] = std::strtod(p, &end);
+      ASSERT_EQ(i < 5 ? ',' : '\n', *end);
+      p = end + 1;
+    }
+    ASSERT_NEAR(row.MJD, fields[0], 1e-8);
+    ASSERT_NEAR(row.L, fields[1], 1e-8);
+    ASSERT_NEAR(row.B, fields[2], 1e-8);
+    ASSERT_NEAR(row.R, fields[3], 1e-10);
+    ASSERT_NEAR(row.RA, fields[4], 1e-8);
+    ASSERT_NEAR(row.Dec, fields[5], 1e-8);
+  }
+  ASSERT_EQ('\0', *p);
+}
@@ -0,0 +1,45 @@
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/threadpool.hxx"
+
+using namespace the;
+
+TEST(ThreadPoolTest, CoversRangesOnce) {
+  for (unsigned const threads : {1u, 2u, 4u}) {
+    ThreadPool pool{threads};
+    ASSERT_EQ(threads, pool.Size());
+    for (std::size_t const n : {0, 1, 7, 1000, 100003}) {
+      std::vector<int> hits(n);
+      std::atomic<std::size_t> calls{0};
+      pool.ParallelFor(0, n, 64, [&](std::size_t const first, std::size_t const last) {
+        ASSERT_LT(first, last);
+        ASSERT_LE(last - first, 64u);
+        for (auto i = first; i < last; ++i)
+          ++hits[i];
+        ++calls;
+      });
+      for (std::size_t i = 0; i < n; ++i)
+        ASSERT_EQ(1, hits[i]) << i;
+      ASSERT_GE(calls.load(), (n + 63) / 64);
+    }
+  }
+}
+
+TEST(ThreadPoolTest, NestsLoops) {
+  ThreadPool pool{4};
+  std::size_t const n = 300;
+  std::vector<std::atomic<int>> hits(n * n);
+  pool.ParallelFor(0, n, 1, [&](std::size_t const first, std::size_t const last) {
+    for (auto i = first; i < last; ++i) {
+      pool.ParallelFor(0, n, 16, [&](std::size_t const innerFirst, std::size_t const innerLast) {
+        for (auto j = innerFirst; j < innerLast; ++j)
+          ++hits[i * n + j];
+      });
+    }
+  });
+  for (auto const &hit : hits)
+    ASSERT_EQ(1, hit.load());
+}
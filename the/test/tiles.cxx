@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/consts.hxx"
+#include "the/lib/common/lod.hxx"
+#include "the/lib/common/tilecache.hxx"
+#include "the/lib/common/tiles.hxx"
+
+using namespace the;
+
+namespace {
+
+unsigned constexpr kDepth = 2;
+
+// Stars on a grid over the whole sky, with Ipix made up so that a tile
+// holds a band of 30 degrees of RA in one hemisphere.
+std::string WriteGrid(std::string const &fpath) {
+  PPMXLColumn const columns[] = {
+    PPMXLColumn::Ipix, PPMXLColumn::RaJ2000, PPMXLColumn::DecJ2000, PPMXLColumn::Jmag,
+  };
+  auto writer = CatalogueWriter::Create(fpath.c_str(), columns);
+  EXPECT_TRUE(writer);
+
+  PPMXLReader::Row row;
+  for (int ra = 0; ra < 360; ra += 5) {
+    for (int dec = -85; dec <= 85; dec += 10) {
+      std::uint64_t const key = (dec > 0 ? 0 : 48) + static_cast<std::uint64_t>(ra / 30);
+      row.Ipix     = (key << (2 * (kQ3CDepth - kDepth))) + static_cast<std::uint64_t>(ra * 1000 + dec + 90);
+      row.RaJ2000  = ra + 0.5;
+      row.DecJ2000 = dec;
+      row.Jmag     = (ra + dec + 90) % 17;
+      writer->Append(row);
+    }
+  }
+  EXPECT_TRUE(writer->Finish());
+  return fpath;
+}
+
+}
+
+TEST(TilesTest, SortsRowsByTile) {
+  auto const input = WriteGrid(::testing::TempDir() + "tiles-test-input.cat");
+  auto const output = ::testing::TempDir() + "tiles-test.cat";
+
+  auto cat = Catalogue::Open(input.c_str());
+  ASSERT_TRUE(cat);
+  ASSERT_TRUE(WriteTiledCatalogue(*cat, output.c_str(), kDepth));
+
+  auto tiled = Catalogue::Open(output.c_str());
+  ASSERT_TRUE(tiled);
+  auto index = TileIndex::Open(TileDirectoryPath(output.c_str()).c_str());
+  ASSERT_TRUE(index);
+  ASSERT_EQ(kDepth, index->Depth());
+  ASSERT_EQ(cat->Rows(), index->Rows());
+  ASSERT_EQ(24, index->Tiles().size());
+
+  std::uint64_t rows = 0;
+  for (auto const &tile : index->Tiles()) {
+    ASSERT_EQ(rows, tile.Begin);
+    for (auto i = tile.Begin; i < tile.Begin + tile.Count; ++i) {
+      ASSERT_EQ(tile.Key, TileKey(tiled->Ipix()[i], kDepth));
+      auto const star = SkyVector(tiled->RaJ2000()[i], tiled->DecJ2000()[i]);
+      ASSERT_LE(SkyAngle(Vec3{tile.Axis[0], tile.Axis[1], tile.Axis[2]}, star), tile.Radius);
+    }
+    rows += tile.Count;
+  }
+  ASSERT_EQ(cat->Rows(), rows);
+
+  std::remove(input.c_str());
+  std::remove(output.c_str());
+  std::remove(TileDirectoryPath(output.c_str()).c_str());
+}
+
+TEST(TilesTest, FindsStarsInConeAndPlanes) {
+  auto const input = WriteGrid(::testing::TempDir() + "tiles-test-input.cat");
+  auto const output = ::testing::TempDir() + "tiles-test.cat";
+  {
+    auto cat = Catalogue::Open(input.c_str());
+    ASSERT_TRUE(cat);
+    ASSERT_TRUE(WriteTiledCatalogue(*cat, output.c_str(), kDepth));
+  }
+  auto cat = Catalogue::Open(output.c_str());
+  ASSERT_TRUE(cat);
+  auto index = TileIndex::Open(TileDirectoryPath(output.c_str()).c_str());
+  ASSERT_TRUE(index);
+
+  auto const ra  = cat->RaJ2000();
+  auto const dec = cat->DecJ2000();
+
+  for (auto const &cone : {Vec3{100.0, 20.0, 12.0}, Vec3{359.0, -80.0, 25.0}, Vec3{0.0, 0.0, 1.0}}) {
+    auto const axis = SkyVector(cone[0], cone[1]);
+    auto const radius = cone[2] * kRad;
+
+    std::set<std::ptrdiff_t> expected, found;
+    for (std::ptrdiff_t i = 0; i < ra.size(); ++i) {
+      if (SkyAngle(axis, SkyVector(ra[i], dec[i])) <= radius)
+        expected.insert(i);
+    }
+    std::size_t tiles = 0;
+    index->ForEachInCone(axis, radius, [&](CatalogueTile const &tile) {
+      ++tiles;
+      for (auto i = tile.Begin; i < tile.Begin + tile.Count; ++i) {
+        if (SkyAngle(axis, SkyVector(ra[i], dec[i])) <= radius)
+          found.insert(static_cast<std::ptrdiff_t>(i));
+      }
+    });
+    ASSERT_EQ(expected, found);
+    ASSERT_LT(tiles, index->Tiles().size());
+  }
+
+  // Quarter of the sky with x > 0 and y > 0.
+  Vec3 const normals[] = {Vec3{1.0, 0.0, 0.0}, Vec3{0.0, 1.0, 0.0}};
+  std::size_t inside = 0;
+  index->ForEachInPlanes(normals, [&](CatalogueTile const &tile) {
+    for (auto i = tile.Begin; i < tile.Begin + tile.Count; ++i)
+      inside += ra[i] < 90.0;
+  });
+  std::size_t expected = 0;
+  for (auto const value : ra)
+    expected += value < 90.0;
+  ASSERT_EQ(expected, inside);
+
+  std::remove(input.c_str());
+  std::remove(output.c_str());
+  std::remove(TileDirectoryPath(output.c_str()).c_str());
+}
+
+TEST(TilesTest, RejectsForeignFiles) {
+  auto const fpath = WriteGrid(::testing::TempDir() + "tiles-test-input.cat");
+  ASSERT_FALSE(TileIndex::Open(fpath.c_str()));
+  std::remove(fpath.c_str());
+}
+
+TEST(TilesTest, RejectsTilesOutsideCatalogue) {
+  auto const input = WriteGrid(::testing::TempDir() + "tiles-test-input.cat");
+  auto const output = ::testing::TempDir() + "tiles-test.cat";
+  auto cat = Catalogue::Open(input.c_str());
+  ASSERT_TRUE(cat);
+  ASSERT_TRUE(WriteTiledCatalogue(*cat, output.c_str(), kDepth));
+  auto const directory = TileDirectoryPath(output.c_str());
+  ASSERT_TRUE(TileIndex::Open(directory.c_str()));
+
+  // Overwrites a field of a tile, then puts it back.
+  auto const corrupt = [&directory](std::size_t const tile, std::size_t const offset,
+                                    std::uint64_t const value) {
+    auto *file = std::fopen(directory.c_str(), "r+b");
+    EXPECT_TRUE(file);
+    if (!file)
+      return false;
+    auto const at = static_cast<long>(sizeof(TileDirectoryHeader) + tile * sizeof(CatalogueTile) + offset);
+    std::uint64_t old = 0;
+    std::fseek(file, at, SEEK_SET);
+    EXPECT_EQ(1u, std::fread(&old, sizeof(old), 1, file));
+    std::fseek(file, at, SEEK_SET);
+    std::fwrite(&value, sizeof(value), 1, file);
+    std::fflush(file);
+    bool const opened = bool(TileIndex::Open(directory.c_str()));
+    std::fseek(file, at, SEEK_SET);
+    std::fwrite(&old, sizeof(old), 1, file);
+    std::fclose(file);
+    return opened;
+  };
+
+  std::uint64_t const rows = cat->Rows();
+  // Rows past the end of the catalogue, a count that would wrap, a gap between
+  // tiles, and a key beyond the six faces.
+  EXPECT_FALSE(corrupt(1, offsetof(CatalogueTile, Count), rows));
+  EXPECT_FALSE(corrupt(1, offsetof(CatalogueTile, Count), ~std::uint64_t{0}));
+  EXPECT_FALSE(corrupt(1, offsetof(CatalogueTile, Begin), 1000));
+  EXPECT_FALSE(corrupt(23, offsetof(CatalogueTile, Key), std::uint64_t{6} << (2 * kDepth)));
+  ASSERT_TRUE(TileIndex::Open(directory.c_str()));
+
+  std::remove(input.c_str());
+  std::remove(output.c_str());
+  std::remove(directory.c_str());
+}
+
+TEST(TilesTest, OrdersTilesByMagnitude) {
+  auto const input = WriteGrid(::testing::TempDir() + "tiles-test-input.cat");
+  auto const output = ::testing::TempDir() + "tiles-test.cat";
+  {
+    auto cat = Catalogue::Open(input.c_str());
+    ASSERT_TRUE(cat);
+    ASSERT_TRUE(WriteTiledCatalogue(*cat, output.c_str(), kDepth));
+  }
+  auto cat = Catalogue::Open(output.c_str());
+  ASSERT_TRUE(cat);
+  auto index = TileIndex::Open(TileDirectoryPath(output.c_str()).c_str());
+  ASSERT_TRUE(index);
+  ASSERT_EQ(PPMXLColumn::Jmag, index->Band());
+
+  MagnitudeLod const lod{*cat, *index};
+  ASSERT_FALSE(lod.Empty());
+  auto const jmag = cat->Jmag();
+
+  for (auto const &tile : index->Tiles()) {
+    for (auto i = tile.Begin + 1; i < tile.Begin + tile.Count; ++i)
+      ASSERT_LE(jmag[i - 1], jmag[i]);
+    ASSERT_LE(tile.Brightest, jmag[tile.Begin]);
+    ASSERT_GE(tile.Faintest, jmag[tile.Begin + tile.Count - 1]);
+
+    auto const mags = lod.Magnitudes(tile, 5.0);
+    for (auto const m : mags)
+      ASSERT_LE(m, 5.0);
+    if (mags.size() < static_cast<std::ptrdiff_t>(tile.Count)) {
+      ASSERT_GT(jmag[tile.Begin + mags.size()], 5.0);
+    }
+  }
+
+  std::uint64_t brighter = 0;
+  for (auto const m : jmag)
+    brighter += m <= 5.0;
+  ASSERT_EQ(brighter, lod.Count(5.0));
+  ASSERT_EQ(cat->Rows(), lod.Count(INFINITY));
+
+  // Magnitudes are whole numbers, so the limit for N stars falls just below a magnitude.
+  auto const limit = lod.LimitForCount(brighter + 1);
+  ASSERT_EQ(brighter, lod.Count(limit));
+  ASSERT_GE(limit, 5.0);
+  ASSERT_LT(limit, 6.0);
+  ASSERT_EQ(0u, lod.Count(lod.LimitForCount(0)));
+
+  std::remove(input.c_str());
+  std::remove(output.c_str());
+  std::remove(TileDirectoryPath(output.c_str()).c_str());
+}
+
+TEST(TilesTest, StreamsTilesWithinBudget) {
+  auto const input = WriteGrid(::testing::TempDir() + "tiles-test-input.cat");
+  auto const output = ::testing::TempDir() + "tiles-test.cat";
+  {
+    auto cat = Catalogue::Open(input.c_str());
+    ASSERT_TRUE(cat);
+    ASSERT_TRUE(WriteTiledCatalogue(*cat, output.c_str(), kDepth));
+  }
+  auto cat = Catalogue::Open(output.c_str());
+  ASSERT_TRUE(cat);
+  auto index = TileIndex::Open(TileDirectoryPath(output.c_str()).c_str());
+  ASSERT_TRUE(index);
+  auto const tiles = index->Tiles();
+
+  // The whole catalogue fits.
+  {
+    TileCache cache{*cat, *index, std::size_t{1} << 20};
+    ASSERT_TRUE(cache.Start(output.c_str()));
+    cache.SetView(SkyVector(0.0, 90.0), kPi, INFINITY);
+    cache.Wait();
+
+    auto const resident = cache.Resident();
+    ASSERT_EQ(tiles.size(), resident.size());
+    std::size_t rows = 0;
+    for (auto const &data : resident) {
+      auto const &tile = tiles[data->Tile];
+      ASSERT_EQ(tile.Count, data->Rows());
+      for (std::size_t i = 0; i < data->Rows(); ++i) {
+        ASSERT_EQ(cat->RaJ2000()[tile.Begin + i], data->RaJ2000[i]);
+        ASSERT_EQ(cat->DecJ2000()[tile.Begin + i], data->DecJ2000[i]);
+        ASSERT_EQ(cat->Jmag()[tile.Begin + i], data->Mag[i]);
+      }
+      rows += data->Rows();
+    }
+    ASSERT_EQ(cat->Rows(), rows);
+  }
+
+  // Only stars brighter than the limit are read.
+  {
+    TileCache cache{*cat, *index, std::size_t{1} << 20};
+    ASSERT_TRUE(cache.Start(output.c_str()));
+    cache.SetView(SkyVector(0.0, 90.0), kPi, 5.0);
+    cache.Wait();
+    MagnitudeLod const lod{*cat, *index};
+    std::size_t rows = 0;
+    for (auto const &data : cache.Resident()) {
+      for (auto const m : data->Mag)
+        ASSERT_LE(m, 5.0);
+      rows += data->Rows();
+    }
+    ASSERT_EQ(lod.Count(5.0), rows);
+  }
+
+  // A few tiles fit, the nearest to the view.
+  auto const distance = [&](Vec3 const &axis, std::uint32_t const i) {
+    auto const &tile = tiles[i];
+    return std::max(0.0, SkyAngle(axis, Vec3{tile.Axis[0], tile.Axis[1], tile.Axis[2]}) - tile.Radius);
+  };
+  std::size_t const budget = 6 * (sizeof(TileData) + 60 * 3 * sizeof(double));
+  TileCache cache{*cat, *index, budget};
+  ASSERT_TRUE(cache.Start(output.c_str()));
+  for (auto const &view : {SkyVector(45.0, 45.0), SkyVector(225.0, -45.0)}) {
+    cache.SetView(view, kPi, INFINITY);
+    cache.Wait();
+    auto const stats = cache.Stats();
+    ASSERT_LE(stats.Bytes, budget);
+    ASSERT_GT(stats.Tiles, 0u);
+    ASSERT_LT(stats.Tiles, static_cast<std::size_t>(tiles.size()));
+
+    std::set<std::uint32_t> resident;
+    for (auto const &data : cache.Resident())
+      resident.insert(data->Tile);
+    double farthest = 0.0;
+    for (auto const i : resident)
+      farthest = std::max(farthest, distance(view, i));
+    for (std::uint32_t i = 0; i < tiles.size(); ++i) {
+      if (!resident.count(i)) {
+        ASSERT_GE(distance(view, i), farthest);
+      }
+    }
+  }
+  ASSERT_GT(cache.Stats().Evictions, 0u);
+  cache.Stop();
+
+  // Stopped, the cache starts again and follows a new view.
+  ASSERT_TRUE(cache.Start(output.c_str()));
+  ASSERT_FALSE(cache.Start(output.c_str()));
+  auto const view = SkyVector(135.0, 0.0);
+  cache.SetView(view, kPi, INFINITY);
+  cache.Wait();
+  std::set<std::uint32_t> resident;
+  for (auto const &data : cache.Resident())
+    resident.insert(data->Tile);
+  ASSERT_FALSE(resident.empty());
+  double farthest = 0.0;
+  for (auto const i : resident)
+    farthest = std::max(farthest, distance(view, i));
+  for (std::uint32_t i = 0; i < tiles.size(); ++i) {
+    if (!resident.count(i)) {
+      ASSERT_GE(distance(view, i), farthest);
+    }
+  }
+  cache.Stop();
+
+  std::remove(output.c_str());
+  std::remove(TileDirectoryPath(output.c_str()).c_str());
+  std::remove(input.c_str());
+}
+
+TEST(TilesTest, StreamsTilesWhileViewMoves) {
+  // A star a tile at the default depth, so that ranking the tiles of the whole
+  // sky takes longer than a view lasts.
+  auto const input = ::testing::TempDir() + "tiles-test-input.cat";
+  auto const output = ::testing::TempDir() + "tiles-test.cat";
+  std::uint64_t constexpr kStars = 50000;
+  {
+    PPMXLColumn const columns[] = {
+      PPMXLColumn::Ipix, PPMXLColumn::RaJ2000, PPMXLColumn::DecJ2000, PPMXLColumn::Jmag,
+    };
+    auto writer = CatalogueWriter::Create(input.c_str(), columns);
+    ASSERT_TRUE(writer);
+    PPMXLReader::Row row;
+    for (std::uint64_t i = 0; i < kStars; ++i) {
+      row.Ipix     = 7 * i << (2 * (kQ3CDepth - kDefaultTileDepth));
+      row.RaJ2000  = double(i) * 360.0 / kStars;
+      row.DecJ2000 = double(i % 179) - 89.0;
+      row.Jmag     = double(i % 17);
+      writer->Append(row);
+    }
+    ASSERT_TRUE(writer->Finish());
+    auto cat = Catalogue::Open(input.c_str());
+    ASSERT_TRUE(cat);
+    ASSERT_TRUE(WriteTiledCatalogue(*cat, output.c_str(), kDefaultTileDepth));
+  }
+  auto cat = Catalogue::Open(output.c_str());
+  ASSERT_TRUE(cat);
+  auto index = TileIndex::Open(TileDirectoryPath(output.c_str()).c_str());
+  ASSERT_TRUE(index);
+  ASSERT_EQ(static_cast<std::ptrdiff_t>(kStars), index->Tiles().size());
+
+  // Every view is new, yet every pass reads tiles before it gives way to the next.
+  TileCache cache{*cat, *index, std::size_t{1} << 30};
+  ASSERT_TRUE(cache.Start(output.c_str()));
+  for (int i = 0; i < 400; ++i) {
+    cache.SetView(SkyVector(double(i % 360), 0.0), kPi, INFINITY);
+    std::this_thread::sleep_for(std::chrono::microseconds{500});
+  }
+  auto const stats = cache.Stats();
+  cache.Stop();
+  ASSERT_GT(stats.Loads, 0u);
+  ASSERT_EQ(stats.Loads, stats.Tiles);
+
+  std::remove(output.c_str());
+  std::remove(TileDirectoryPath(output.c_str()).c_str());
+  std::remove(input.c_str());
+}
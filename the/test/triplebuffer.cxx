@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "the/lib/common/triplebuffer.hxx"
+
+using namespace the;
+
+TEST(TripleBufferTest, HandsOverLatestValue) {
+  TripleBuffer<int> buffer;
+  ASSERT_FALSE(buffer.Update());
+  ASSERT_EQ(0, buffer.Front());
+
+  buffer.Back() = 1;
+  ASSERT_FALSE(buffer.Publish());
+  buffer.Back() = 2;
+  // 1 has not been taken, and comes back to the producer.
+  ASSERT_TRUE(buffer.Publish());
+  ASSERT_EQ(1, buffer.Back());
+  ASSERT_TRUE(buffer.Update());
+  ASSERT_EQ(2, buffer.Front());
+  // Nothing newer has been published.
+  ASSERT_FALSE(buffer.Update());
+  ASSERT_EQ(2, buffer.Front());
+
+  buffer.Back() = 3;
+  ASSERT_FALSE(buffer.Publish());
+  ASSERT_TRUE(buffer.Update());
+  ASSERT_EQ(3, buffer.Front());
+}
+
+TEST(TripleBufferTest, KeepsValuesWholeAcrossThreads) {
+  // Every value published is a vector of one number repeated, so a torn
+  // value would mix numbers.
+  TripleBuffer<std::vector<std::uint32_t>> buffer;
+  std::uint32_t constexpr kValues = 20000;
+  std::thread producer([&buffer] {
+    for (std::uint32_t i = 1; i <= kValues; ++i) {
+      auto &value = buffer.Back();
+      value.assign(64 + i % 64, i);
+      buffer.Publish();
+    }
+  });
+
+  // Failures break out rather than return, so that the producer is joined.
+  std::uint32_t last = 0;
+  while (last < kValues) {
+    if (!buffer.Update())
+      continue;
+    auto const &value = buffer.Front();
+    EXPECT_FALSE(value.empty());
+    if (value.empty())
+      break;
+    EXPECT_GT(value.front(), last);
+    EXPECT_EQ(64 + value.front() % 64, value.size());
+    auto const whole = std::all_of(value.begin(), value.end(), [&value](auto const v) {
+      return v == value.front();
+    });
+    EXPECT_TRUE(whole);
+    if (value.front() <= last || !whole)
+      break;
+    last = value.front();
+  }
+  producer.join();
+}